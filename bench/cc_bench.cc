@@ -0,0 +1,224 @@
+//
+// Created by Chengke Wong on 2020/5/24.
+//
+// Congestion control simulation: bulk flows over a bottleneck with a
+// drop-tail queue, comparing the congestion controllers on long fat and
+// lossy paths, and the queueing delay they cause on a shared bottleneck.
+//
+// The flows run in the network simulator of sim/, as quic_sim runs them:
+// each is a SimSender with its LossRecovery, controller and Pacer, and a
+// SimReceiver that acknowledges through a ReceivedPacketTracker. The
+// bottleneck is a Link with a drop-tail queue, which loses the datagrams
+// at random with the given probability before they are queued. The
+// reverse link carries the ACKs and is never the bottleneck.
+//
+// The bottleneck may run a step AQM instead, which marks CE the
+// ECN-capable datagrams that find a queueing delay above a threshold,
+// and drops the others. ECT(1) datagrams have a threshold of their own,
+// as in an L4S AQM.
+//
+// The queueing delay of a flow is the time its datagrams wait at the
+// bottleneck, over all but the first tenth of the simulation.
+//
+// usage: cc_bench [rate in Mbps] [RTT in ms] [queue in BDP] [seconds]
+//                 [random loss in %]
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "recovery/cc_copa.h"
+#include "recovery/cc_registry.h"
+#include "sim/dumbbell.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+namespace {
+
+struct Bench {
+    LinkConfig bottleneck;
+    Duration length;
+    // the stream bytes per second the bottleneck can carry
+    double capacity;
+};
+
+// in milliseconds
+double to_ms(Duration duration) {
+    return duration.to_microseconds() * 1e-3;
+}
+
+void report(Dumbbell &dumbbell, size_t flow, const Bench &bench) {
+    const char *name =
+        dumbbell.sender(flow).config().congestion_control.c_str();
+    size_t payload = kMaxDatagramSize - kSimPacketOverhead;
+    std::vector<const TimelineSample *> samples;
+    for (auto &sample : dumbbell.timeline()) {
+        if (sample.flow == flow) {
+            samples.push_back(&sample);
+        }
+    }
+
+    double total = 0;
+    printf("%-8s utilization", name);
+    for (auto sample : samples) {
+        printf(" %5.1f%%", sample->goodput * 100.0 / bench.capacity);
+        total += sample->goodput;
+    }
+    printf("   total %5.1f%%\n",
+           total * 100.0 / bench.capacity / samples.size());
+
+    printf("%-8s window     ", name);
+    for (auto sample : samples) {
+        printf(" %6lu", static_cast<unsigned long>(
+            sample->congestion_window / kMaxDatagramSize));
+    }
+    uint64_t lost = 0;
+    printf("\n%-8s lost       ", name);
+    for (auto sample : samples) {
+        printf(" %6lu", static_cast<unsigned long>(
+            sample->bytes_lost / payload));
+        lost += sample->bytes_lost / payload;
+    }
+    printf("   total %lu\n", static_cast<unsigned long>(lost));
+
+    const RttHistogram &delays = dumbbell.queueing_delays(flow);
+    printf("%-8s queueing delay p50 %.1f ms, p99 %.1f ms\n", name,
+           to_ms(delays.percentile(0.5)), to_ms(delays.percentile(0.99)));
+}
+
+// one line per flow sharing the bottleneck
+void report_shared(Dumbbell &dumbbell, size_t flow, const Bench &bench) {
+    double total = 0;
+    size_t samples = 0;
+    for (auto &sample : dumbbell.timeline()) {
+        if (sample.flow == flow) {
+            total += sample.goodput;
+            samples += 1;
+        }
+    }
+    const RttHistogram &delays = dumbbell.queueing_delays(flow);
+    printf("  %-10s share %5.1f%%  queueing delay p50 %6.1f ms,"
+           " p99 %6.1f ms\n",
+           dumbbell.sender(flow).config().congestion_control.c_str(),
+           total * 100.0 / bench.capacity / samples,
+           to_ms(delays.percentile(0.5)), to_ms(delays.percentile(0.99)));
+}
+
+// Run a flow of each of |controllers| from the start, over |bottleneck|,
+// and report on every flow at the end.
+void simulate(const Bench &bench, const LinkConfig &bottleneck,
+              std::vector<const char *> controllers,
+              void (*report)(Dumbbell &, size_t, const Bench &)) {
+    Simulator sim;
+    Dumbbell dumbbell(sim, bottleneck, Dumbbell::reverse_of(bottleneck));
+    for (const char *name : controllers) {
+        QuicConfig config;
+        config.congestion_control = name;
+        dumbbell.add_flow(config);
+    }
+
+    Duration tenth = Duration::from_microseconds(
+        bench.length.to_microseconds() / 10);
+    dumbbell.sample_every(tenth);
+    sim.run_for(tenth);
+    dumbbell.record_queueing_delays();
+    sim.run_for(bench.length - tenth);
+
+    for (size_t flow = 0; flow < dumbbell.flows(); flow++) {
+        report(dumbbell, flow, bench);
+    }
+}
+
+void simulate(const Bench &bench, std::vector<const char *> controllers,
+              void (*report)(Dumbbell &, size_t, const Bench &)) {
+    simulate(bench, bench.bottleneck, std::move(controllers), report);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    double rate_mbps = 1000;
+    int64_t rtt_ms = 100;
+    double queue_bdp = 0.1;
+    int64_t seconds = 120;
+    double random_loss = 0;
+    if (argc > 1) {
+        rate_mbps = strtod(argv[1], nullptr);
+    }
+    if (argc > 2) {
+        rtt_ms = strtoll(argv[2], nullptr, 10);
+    }
+    if (argc > 3) {
+        queue_bdp = strtod(argv[3], nullptr);
+    }
+    if (argc > 4) {
+        seconds = strtoll(argv[4], nullptr, 10);
+    }
+    if (argc > 5) {
+        random_loss = strtod(argv[5], nullptr) / 100;
+    }
+
+    LinkConfig bottleneck;
+    bottleneck.bandwidth = static_cast<uint64_t>(rate_mbps * 1e6 / 8);
+    bottleneck.propagation_delay =
+        Duration::from_microseconds(rtt_ms * 1000 / 2);
+    uint64_t bdp = bottleneck.bandwidth * rtt_ms / 1000;
+    bottleneck.buffer = std::max<size_t>(
+        kMaxDatagramSize, static_cast<size_t>(queue_bdp * bdp));
+    bottleneck.random_loss = random_loss;
+    Bench bench = {
+        bottleneck,
+        Duration::from_seconds(seconds),
+        bottleneck.bandwidth
+            * static_cast<double>(kMaxDatagramSize - kSimPacketOverhead)
+            / kMaxDatagramSize,
+    };
+
+    printf("%.0f Mbps, %ld ms RTT, queue of %.2f BDP, %.2f%% random loss,"
+           " %ld s; BDP %lu datagrams\n",
+           rate_mbps, static_cast<long>(rtt_ms), queue_bdp,
+           random_loss * 100, static_cast<long>(seconds),
+           static_cast<unsigned long>(bdp / kMaxDatagramSize));
+    printf("every tenth of the simulation:\n");
+
+    for (const char *name : {"reno", "cubic", "bbr", "copa"}) {
+        simulate(bench, {name}, report);
+    }
+
+    CongestionControlRegistry::instance().add("copa-5ms", [] {
+        return unique_ptr<CongestionControl>(
+            new CcCopa(Duration::from_milliseconds(5)));
+    });
+
+    printf("\ntwo flows sharing the bottleneck:\n");
+    printf("cubic + cubic\n");
+    simulate(bench, {"cubic", "cubic"}, report_shared);
+    printf("bbr + bbr\n");
+    simulate(bench, {"bbr", "bbr"}, report_shared);
+    printf("copa + copa\n");
+    simulate(bench, {"copa", "copa"}, report_shared);
+    printf("copa + copa, 5 ms target\n");
+    simulate(bench, {"copa-5ms", "copa-5ms"}, report_shared);
+    printf("copa + cubic\n");
+    simulate(bench, {"copa", "cubic"}, report_shared);
+
+    printf("\nstep AQM:\n");
+    LinkConfig l4s = bottleneck;
+    l4s.l4s_ce_threshold = Duration::from_milliseconds(1);
+    LinkConfig classic = bottleneck;
+    classic.ce_threshold = Duration::from_milliseconds(5);
+    classic.l4s_ce_threshold = Duration::from_milliseconds(5);
+
+    printf("prague, L4S marking at 1 ms\n");
+    simulate(bench, l4s, {"prague"}, report_shared);
+    printf("prague + prague, L4S marking at 1 ms\n");
+    simulate(bench, l4s, {"prague", "prague"}, report_shared);
+    printf("cubic, classic AQM at 5 ms\n");
+    simulate(bench, classic, {"cubic"}, report_shared);
+    printf("prague, classic AQM at 5 ms\n");
+    simulate(bench, classic, {"prague"}, report_shared);
+
+    return 0;
+}
@@ -0,0 +1,420 @@
+//
+// Created by Chengke Wong on 2020/5/19.
+//
+// Wire codec benchmark: replays a corpus of packets through the header
+// parser, header protection removal and the frame decoder, and measures
+// variable-length integer coding.
+//
+// 1-RTT corpus entries are wrapped in short header packets and are parsed
+// both by PacketHeader and by the ShortPacketHeader fast path.
+//
+// usage: codec_bench [iterations]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "common/frame.h"
+#include "crypto/hp.h"
+#include "transport/packet_header.h"
+#include "transport/received_packet_tracker.h"
+#include "util/stopwatch.h"
+#include "util/string_reader.h"
+#include "util/string_writer.h"
+#include "util/utility.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+// Every heap allocation made by the process is counted, so that the
+// allocations per packet of each code path can be reported. The
+// replacements are kept out of line: once inlined, the compiler sees
+// malloc() paired with operator delete and warns of a mismatch.
+static size_t allocation_count = 0;
+
+__attribute__((noinline)) void *operator new(size_t size) {
+    allocation_count += 1;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+namespace {
+
+constexpr Version kBenchVersion = 0xff00001b;
+
+const char *kHpKey = "a980b8b4fb7d9fbc13e814c23164253d";
+
+struct CorpusEntry {
+    const char *name;
+    PacketType type;
+
+    // the header is protected, the payload is left in plaintext
+    String packet;
+
+    size_t payload_offset;
+    size_t payload_length;
+
+    size_t frames;
+};
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-long-header-packets
+// Wrap |payload| into an Initial packet with a 2-byte packet number and
+// apply header protection.
+String make_initial_packet(StringRef payload, StringRef hp,
+                           size_t &payload_offset) {
+    const size_t kPnLength = 2;
+    const size_t kTagLength = 16;
+
+    String packet(64 + payload.size() + kTagLength);
+    StringWriter writer(packet);
+
+    writer.write_u8(0xc0 | (kPnLength - 1));
+    writer.write_u32(kBenchVersion);
+    writer.write_u8(8);
+    writer.write(String::from_hex("8394c8f03e515708"));
+    writer.write_u8(8);
+    writer.write(String::from_hex("f067a5502a4262b5"));
+    // token length
+    writer.write_with_variant_length(0);
+    // always use the 2-byte encoding for the Length field
+    writer.write_u16(0x4000 | (kPnLength + payload.size() + kTagLength));
+
+    size_t pn_offset = writer.position();
+    writer.write_u16(2);
+    payload_offset = writer.position();
+    writer.write(payload);
+    // the AEAD tag is not computed; only its length matters here
+    for (size_t i = 0; i < kTagLength; i++) {
+        writer.write_u8(0);
+    }
+
+    String mask = crypto::aes_128_ecb_encrypt(
+        hp, packet.sub_string(pn_offset + 4, pn_offset + 4 + 16));
+    packet[0] ^= mask[0] & 0x0f;
+    for (size_t i = 0; i < kPnLength; i++) {
+        packet[pn_offset + i] ^= mask[1 + i];
+    }
+
+    return String(packet.data(), writer.position());
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-short-header-packets
+// Wrap |payload| into a 1-RTT packet with a 2-byte packet number and
+// apply header protection.
+String make_short_packet(StringRef payload, StringRef hp,
+                         size_t &payload_offset) {
+    const size_t kPnLength = 2;
+    const size_t kTagLength = 16;
+
+    String packet(16 + payload.size() + kTagLength);
+    StringWriter writer(packet);
+
+    writer.write_u8(0x40 | (kPnLength - 1));
+    writer.write(String::from_hex("8394c8f03e515708"));
+
+    size_t pn_offset = writer.position();
+    writer.write_u16(2);
+    payload_offset = writer.position();
+    writer.write(payload);
+    for (size_t i = 0; i < kTagLength; i++) {
+        writer.write_u8(0);
+    }
+
+    String mask = crypto::aes_128_ecb_encrypt(
+        hp, packet.sub_string(pn_offset + 4, pn_offset + 4 + 16));
+    packet[0] ^= mask[0] & 0x1f;
+    for (size_t i = 0; i < kPnLength; i++) {
+        packet[pn_offset + i] ^= mask[1 + i];
+    }
+
+    return String(packet.data(), writer.position());
+}
+
+// a CRYPTO frame carrying a ClientHello, padded to a 1162-byte payload
+String make_padded_initial_payload(size_t &frames) {
+    String payload(1162);
+    memset(payload.data(), 0, payload.size());
+    StringWriter writer(payload);
+
+    String client_hello = String::random(241);
+    writer.write_u8(FRAME_TYPE_CRYPTO);
+    writer.write_with_variant_length(0);
+    writer.write_with_variant_length(client_hello.size());
+    writer.write(client_hello);
+
+    // a CRYPTO frame followed by a single run of PADDING frames
+    frames = 2;
+    return payload;
+}
+
+// an ACK frame with many ranges, as sent by a receiver on a lossy path,
+// followed by a few flow control updates
+String make_ack_heavy_payload(size_t &frames) {
+    AlarmManager alarms;
+    ReceivedPacketTracker tracker(PNSpace::Application, alarms,
+                                  kDefaultMaxAckDelay);
+    Instant now(1000000);
+    for (uint64_t pn = 0; pn < 1000; pn++) {
+        if (pn % 17 != 3 && pn % 29 != 5) {
+            tracker.on_packet_received(pn, true, now);
+        }
+    }
+
+    String buffer(1200);
+    StringWriter writer(buffer);
+    tracker.write_ack_frame(writer, now + Duration::from_milliseconds(3));
+
+    writer.write_u8(FRAME_TYPE_MAX_DATA);
+    writer.write_with_variant_length(1 << 20);
+    writer.write_u8(FRAME_TYPE_MAX_STREAM_DATA);
+    writer.write_with_variant_length(4);
+    writer.write_with_variant_length(1 << 18);
+    writer.write_u8(FRAME_TYPE_MAX_STREAMS_BIDI);
+    writer.write_with_variant_length(100);
+
+    frames = 4;
+    return String(buffer.data(), writer.position());
+}
+
+void write_stream_frame(StringWriter &writer, uint64_t stream_id,
+                        uint64_t offset, StringRef data, bool has_length) {
+    FrameType type = FRAME_TYPE_STREAM | STREAM_FRAME_BIT_OFF;
+    if (has_length) {
+        type |= STREAM_FRAME_BIT_LEN;
+    }
+    writer.write_u8(type);
+    writer.write_with_variant_length(stream_id);
+    writer.write_with_variant_length(offset);
+    if (has_length) {
+        writer.write_with_variant_length(data.size());
+    }
+    writer.write(data);
+}
+
+// many small STREAM frames, e.g. RPC requests multiplexed on streams
+String make_small_streams_payload(size_t &frames) {
+    String buffer(1200);
+    StringWriter writer(buffer);
+    String data = String::random(40);
+
+    frames = 0;
+    for (uint64_t stream_id = 0; writer.remaining() > 60; stream_id += 4) {
+        write_stream_frame(writer, stream_id, 1000 * stream_id, data, true);
+        frames += 1;
+    }
+    return String(buffer.data(), writer.position());
+}
+
+// one STREAM frame filling the packet, as in a bulk transfer
+String make_large_stream_payload(size_t &frames) {
+    String buffer(1200);
+    StringWriter writer(buffer);
+    String data = String::random(1180);
+
+    write_stream_frame(writer, 4, 1 << 20, data, false);
+    frames = 1;
+    return String(buffer.data(), writer.position());
+}
+
+std::vector<CorpusEntry> make_corpus() {
+    String hp = String::from_hex(kHpKey);
+    std::vector<CorpusEntry> corpus;
+
+    using MakePayload = String (*)(size_t &frames);
+    struct {
+        const char *name;
+        PacketType type;
+        MakePayload make_payload;
+    } recipes[] = {
+        {"padded_initial", PacketType::Initial, make_padded_initial_payload},
+        {"ack_heavy", PacketType::OneRTT, make_ack_heavy_payload},
+        {"small_streams", PacketType::OneRTT, make_small_streams_payload},
+        {"large_stream", PacketType::OneRTT, make_large_stream_payload},
+    };
+
+    for (auto &recipe : recipes) {
+        size_t frames;
+        String payload = recipe.make_payload(frames);
+        size_t payload_offset;
+        String packet = recipe.type == PacketType::Initial
+            ? make_initial_packet(payload, hp, payload_offset)
+            : make_short_packet(payload, hp, payload_offset);
+        corpus.push_back(CorpusEntry {
+            .name = recipe.name,
+            .type = recipe.type,
+            .packet = std::move(packet),
+            .payload_offset = payload_offset,
+            .payload_length = payload.size(),
+            .frames = frames,
+        });
+    }
+    return corpus;
+}
+
+struct BenchResult {
+    uint64_t elapsed_us;
+    size_t allocations;
+};
+
+template<typename Function>
+BenchResult run(size_t iterations, Function function) {
+    // warm up
+    for (size_t i = 0; i < iterations / 10 + 1; i++) {
+        function();
+    }
+
+    size_t allocations = allocation_count;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < iterations; i++) {
+        function();
+    }
+    return BenchResult {
+        .elapsed_us = stopwatch.getElapsedInMicroseconds(),
+        .allocations = allocation_count - allocations,
+    };
+}
+
+void report(const char *bench, const char *corpus, size_t iterations,
+            size_t frames_per_packet, BenchResult result) {
+    double seconds = std::max<double>(result.elapsed_us, 1) / 1e6;
+    double packets_per_second = iterations / seconds;
+    double ns_per_frame =
+        seconds * 1e9 / (iterations * std::max<size_t>(frames_per_packet, 1));
+    double allocations_per_packet =
+        static_cast<double>(result.allocations) / iterations;
+
+    printf("%-16s %-16s %14.0f %12.1f %12.2f\n", bench, corpus,
+           packets_per_second, ns_per_frame, allocations_per_packet);
+}
+
+// PacketHeader::from_reader + PacketHeader::decrypt. The packet is copied
+// first since removing header protection modifies it in place.
+void bench_header(const CorpusEntry &entry, size_t iterations) {
+    String hp = String::from_hex(kHpKey);
+    String scratch(entry.packet.size());
+
+    BenchResult result = run(iterations, [&]() {
+        memcpy(scratch.data(), entry.packet.data(), entry.packet.size());
+        StringReader reader(scratch);
+        PacketHeader header = PacketHeader::from_reader(reader);
+        header.decrypt(hp, scratch);
+    });
+
+    report("header+hp", entry.name, iterations, 1, result);
+}
+
+// ShortPacketHeader::from_reader + ShortPacketHeader::decrypt
+void bench_short_header(const CorpusEntry &entry, size_t iterations) {
+    String hp = String::from_hex(kHpKey);
+    String scratch(entry.packet.size());
+
+    BenchResult result = run(iterations, [&]() {
+        memcpy(scratch.data(), entry.packet.data(), entry.packet.size());
+        StringReader reader(scratch);
+        ShortPacketHeader header =
+            ShortPacketHeader::from_reader(reader, kDefaultCidLength);
+        header.decrypt(hp, scratch);
+    });
+
+    report("short+hp", entry.name, iterations, 1, result);
+}
+
+void bench_frames(const CorpusEntry &entry, size_t iterations) {
+    StringRef payload = entry.packet.sub_string(
+        entry.payload_offset, entry.payload_offset + entry.payload_length);
+
+    BenchResult result = run(iterations, [&]() {
+        StringReader reader(payload.data(), payload.size());
+        Frames frames = Frame::from_reader(reader, entry.type);
+        if (frames.size() != entry.frames) {
+            fprintf(stderr, "%s: decoded %lu frames, expected %lu\n",
+                    entry.name, static_cast<unsigned long>(frames.size()),
+                    static_cast<unsigned long>(entry.frames));
+            exit(1);
+        }
+        for (Frame &frame : frames) {
+            frame.delete_frame();
+        }
+    });
+
+    report("frames", entry.name, iterations, entry.frames, result);
+}
+
+// one value of each encoded length: 1, 2, 4 and 8 bytes
+const uint64_t kVarints[] = {37, 15293, 494878333, 151288809941952652};
+constexpr size_t kNumOfVarints = sizeof(kVarints) / sizeof(kVarints[0]);
+
+void bench_varint(size_t iterations) {
+    String buffer(kNumOfVarints * 8);
+
+    BenchResult result = run(iterations, [&]() {
+        StringWriter writer(buffer);
+        for (uint64_t value : kVarints) {
+            writer.write_with_variant_length(value);
+        }
+    });
+    report("varint_write", "1/2/4/8 bytes", iterations, kNumOfVarints, result);
+
+    size_t length;
+    {
+        StringWriter writer(buffer);
+        for (uint64_t value : kVarints) {
+            writer.write_with_variant_length(value);
+        }
+        length = writer.position();
+    }
+
+    volatile uint64_t sink = 0;
+    result = run(iterations, [&]() {
+        StringReader reader(buffer.data(), length);
+        while (!reader.empty()) {
+            sink = sink + reader.read_with_variant_length();
+        }
+    });
+    report("varint_read", "1/2/4/8 bytes", iterations, kNumOfVarints, result);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    size_t iterations = 100000;
+    if (argc > 1) {
+        iterations = strtoul(argv[1], nullptr, 10);
+    }
+
+    std::vector<CorpusEntry> corpus = make_corpus();
+
+    printf("%-16s %-16s %14s %12s %12s\n", "bench", "corpus",
+           "packets/s", "ns/frame", "allocs/pkt");
+
+    for (const CorpusEntry &entry : corpus) {
+        bench_header(entry, iterations);
+    }
+    for (const CorpusEntry &entry : corpus) {
+        if (entry.type == PacketType::OneRTT) {
+            bench_short_header(entry, iterations);
+        }
+    }
+    for (const CorpusEntry &entry : corpus) {
+        bench_frames(entry, iterations);
+    }
+    bench_varint(iterations);
+
+    return 0;
+}
@@ -0,0 +1,320 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+// Sent packet history benchmark: keeps a window of packets in flight and
+// replays the sender side of a lossy transfer through SentPacketHistory
+// and, as a baseline, the std::map it replaces.
+//
+// Each round acknowledges the oldest kBatch packets in flight except
+// every kLossInterval-th one, runs loss detection up to the largest
+// acknowledged packet and sends kBatch new packets. Like a real ACK
+// frame, the ACK of each round repeats the ranges of the previous
+// kAckSpan packets.
+//
+// ACKs are processed either by looking up every packet number of every
+// range, or by walking the ranges along the history (SentPacketHistory
+// only; this is what LossRecoverySpace does).
+//
+// At last, the cost of allocating SentPackets and their frame records
+// from SentPacketPool is compared with new and delete.
+//
+// usage: recovery_bench [packets in flight] [rounds]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "recovery/sent_packet_history.h"
+#include "util/stopwatch.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+namespace {
+
+constexpr uint64_t kBatch = 1000;
+
+constexpr uint64_t kLossInterval = 50;
+
+constexpr uint64_t kPacketThreshold = 3;
+
+constexpr uint64_t kAckSpan = 10000;
+
+// closed interval [first, last]
+struct Range {
+    uint64_t first;
+    uint64_t last;
+};
+
+using SentPacketMap = std::map<PacketNumber, SentPacketPtr>;
+
+SentPacketPtr make_packet(SentPacketPool &pool) {
+    return pool.new_packet(Instant(1000000), 1200, true, true);
+}
+
+void insert(SentPacketHistory &history, PacketNumber pn,
+            SentPacketPtr packet) {
+    history.insert(pn, std::move(packet));
+}
+
+void insert(SentPacketMap &map, PacketNumber pn,
+            SentPacketPtr packet) {
+    map.insert(std::make_pair(pn, std::move(packet)));
+}
+
+SentPacketPtr remove(SentPacketHistory &history, PacketNumber pn) {
+    return history.remove(pn);
+}
+
+SentPacketPtr remove(SentPacketMap &map, PacketNumber pn) {
+    auto iter = map.find(pn);
+    if (iter == map.end()) {
+        return nullptr;
+    }
+    SentPacketPtr packet = std::move(iter->second);
+    map.erase(iter);
+    return packet;
+}
+
+// look up every packet number of |ranges|
+template<typename History>
+void ack_each(History &history, const std::vector<Range> &ranges,
+              std::vector<SentPacketPtr> &acked) {
+    for (const Range &range : ranges) {
+        for (uint64_t pn = range.first; pn <= range.last; pn++) {
+            SentPacketPtr packet = remove(history, pn);
+            if (packet) {
+                acked.push_back(std::move(packet));
+            }
+        }
+    }
+}
+
+// as in LossRecoverySpace::detect_and_remove_acked_packets
+void ack_walk(SentPacketHistory &history, const std::vector<Range> &ranges,
+              std::vector<SentPacketPtr> &acked) {
+    for (const Range &range : ranges) {
+        uint64_t end = std::min(range.last + 1, history.end_packet_number());
+        for (uint64_t pn = history.next_packet_number(range.first);
+             pn < end; pn = history.next_packet_number(pn + 1)) {
+            acked.push_back(history.remove(pn));
+        }
+    }
+}
+
+// packet threshold loss detection, as in LossRecoverySpace
+void detect_lost(SentPacketHistory &history, uint64_t largest_acked,
+                 std::vector<SentPacketPtr> &lost) {
+    uint64_t end = std::min(history.end_packet_number(), largest_acked + 1);
+    for (uint64_t pn = history.first_packet_number(); pn < end;
+         pn = history.next_packet_number(pn + 1)) {
+        if (largest_acked >= pn + kPacketThreshold) {
+            lost.push_back(history.remove(pn));
+        }
+    }
+}
+
+void detect_lost(SentPacketMap &map, uint64_t largest_acked,
+                 std::vector<SentPacketPtr> &lost) {
+    auto iter = map.begin();
+    while (iter != map.end() && iter->first.value <= largest_acked) {
+        if (largest_acked >= iter->first.value + kPacketThreshold) {
+            lost.push_back(std::move(iter->second));
+            iter = map.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+struct BenchResult {
+    uint64_t send_us = 0;
+    uint64_t ack_us = 0;
+    uint64_t loss_us = 0;
+    uint64_t packets = 0;
+    uint64_t lost = 0;
+};
+
+template<typename History, bool kWalk>
+struct Ack;
+
+template<typename History>
+struct Ack<History, false> {
+    static void process(History &history, const std::vector<Range> &ranges,
+                        std::vector<SentPacketPtr> &acked) {
+        ack_each(history, ranges, acked);
+    }
+};
+
+template<>
+struct Ack<SentPacketHistory, true> {
+    static void process(SentPacketHistory &history,
+                        const std::vector<Range> &ranges,
+                        std::vector<SentPacketPtr> &acked) {
+        ack_walk(history, ranges, acked);
+    }
+};
+
+// the ranges received up to |largest|, oldest first, going back at most
+// kAckSpan packets
+std::vector<Range> make_ack_ranges(uint64_t largest) {
+    std::vector<Range> ranges;
+    uint64_t first = largest + 1 > kAckSpan ? largest + 1 - kAckSpan : 0;
+    for (uint64_t pn = first; pn <= largest; pn++) {
+        if (pn % kLossInterval == 0) {
+            continue;
+        }
+        if (!ranges.empty() && ranges.back().last + 1 == pn) {
+            ranges.back().last = pn;
+        } else {
+            ranges.push_back(Range{pn, pn});
+        }
+    }
+    return ranges;
+}
+
+template<typename History, bool kWalk>
+BenchResult run(uint64_t in_flight, uint64_t rounds) {
+    SentPacketPool pool;
+    History history;
+    BenchResult result;
+
+    // The SentPackets are allocated up front, so that only the cost of
+    // the history itself is measured.
+    std::vector<SentPacketPtr> packets;
+    auto refill = [&](uint64_t count) {
+        while (packets.size() < count) {
+            packets.push_back(make_packet(pool));
+        }
+    };
+
+    uint64_t next_pn = 0;
+    refill(in_flight);
+    {
+        Stopwatch stopwatch;
+        for (uint64_t i = 0; i < in_flight; i++) {
+            insert(history, next_pn++, std::move(packets.back()));
+            packets.pop_back();
+        }
+        result.send_us += stopwatch.getElapsedInMicroseconds();
+        result.packets += in_flight;
+    }
+
+    std::vector<SentPacketPtr> acked;
+    std::vector<SentPacketPtr> lost;
+    acked.reserve(kBatch);
+    lost.reserve(kBatch);
+
+    uint64_t next_to_ack = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+        std::vector<Range> ranges = make_ack_ranges(next_to_ack + kBatch - 1);
+        Stopwatch ack_stopwatch;
+        Ack<History, kWalk>::process(history, ranges, acked);
+        next_to_ack += kBatch;
+        result.ack_us += ack_stopwatch.getElapsedInMicroseconds();
+
+        Stopwatch loss_stopwatch;
+        detect_lost(history, next_to_ack - 1, lost);
+        result.loss_us += loss_stopwatch.getElapsedInMicroseconds();
+        result.lost += lost.size();
+
+        // recycle the packets
+        for (auto &packet : acked) {
+            packets.push_back(std::move(packet));
+        }
+        for (auto &packet : lost) {
+            packets.push_back(std::move(packet));
+        }
+        acked.clear();
+        lost.clear();
+        refill(kBatch);
+
+        Stopwatch send_stopwatch;
+        for (uint64_t i = 0; i < kBatch; i++) {
+            insert(history, next_pn++, std::move(packets.back()));
+            packets.pop_back();
+        }
+        result.send_us += send_stopwatch.getElapsedInMicroseconds();
+        result.packets += kBatch;
+    }
+
+    return result;
+}
+
+// A SentPacket carrying two STREAM frames, allocated and freed the way
+// the send and ACK paths do: kept in flight for |in_flight| packets.
+struct HeapPacket {
+    Instant time_sent;
+    size_t sent_bytes;
+    std::vector<unique_ptr<StreamRecord>> frames;
+};
+
+void bench_allocation(uint64_t in_flight, uint64_t packets) {
+    std::vector<unique_ptr<HeapPacket>> heap(in_flight);
+    Stopwatch heap_stopwatch;
+    for (uint64_t i = 0; i < packets; i++) {
+        unique_ptr<HeapPacket> packet(new HeapPacket{Instant(1000000), 1200, {}});
+        packet->frames.emplace_back(new StreamRecord{4, i * 1200, 600, false});
+        packet->frames.emplace_back(new StreamRecord{8, i * 600, 600, false});
+        heap[i % in_flight] = std::move(packet);
+    }
+    uint64_t heap_us = heap_stopwatch.getElapsedInMicroseconds();
+    heap.clear();
+
+    SentPacketPool pool;
+    std::vector<SentPacketPtr> slab(in_flight);
+    Stopwatch slab_stopwatch;
+    for (uint64_t i = 0; i < packets; i++) {
+        SentPacketPtr packet = make_packet(pool);
+        pool.add_frame(*packet, FrameRecord::stream_frame(4, i * 1200, 600, false));
+        pool.add_frame(*packet, FrameRecord::stream_frame(8, i * 600, 600, false));
+        slab[i % in_flight] = std::move(packet);
+    }
+    uint64_t slab_us = slab_stopwatch.getElapsedInMicroseconds();
+    slab.clear();
+
+    printf("\nSentPacket with 2 frames, allocate and free (ns/pkt)\n");
+    printf("%-22s %12.1f\n", "new/delete", heap_us * 1e3 / packets);
+    printf("%-22s %12.1f\n", "SentPacketPool", slab_us * 1e3 / packets);
+}
+
+void report(const char *name, uint64_t rounds, BenchResult result) {
+    double acked = static_cast<double>(rounds) * kBatch;
+    printf("%-22s %12.1f %12.1f %12.1f %10lu\n", name,
+           result.send_us * 1e3 / result.packets,
+           result.ack_us * 1e3 / acked,
+           result.loss_us * 1e3 / acked,
+           static_cast<unsigned long>(result.lost));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    uint64_t in_flight = 100000;
+    uint64_t rounds = 1000;
+    if (argc > 1) {
+        in_flight = strtoull(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        rounds = strtoull(argv[2], nullptr, 10);
+    }
+
+    printf("%lu packets in flight, %lu rounds of %lu packets\n",
+           static_cast<unsigned long>(in_flight),
+           static_cast<unsigned long>(rounds),
+           static_cast<unsigned long>(kBatch));
+    printf("%-22s %12s %12s %12s %10s\n", "history",
+           "send ns/pkt", "ack ns/pkt", "loss ns/pkt", "lost");
+
+    report("history, range walk", rounds,
+           run<SentPacketHistory, true>(in_flight, rounds));
+    report("history, per-pn", rounds,
+           run<SentPacketHistory, false>(in_flight, rounds));
+    report("std::map, per-pn", rounds,
+           run<SentPacketMap, false>(in_flight, rounds));
+
+    bench_allocation(in_flight, rounds * kBatch);
+
+    return 0;
+}
@@ -6,12 +6,17 @@
 #define QUIC_CONFIG_H
 
 #include <cstdint>
+#include <string>
 
 #include "util/instant.h"
 
 // Timer granularity. This is a system-dependent value
 constexpr Duration kTimerGranularity = Duration::from_milliseconds(1);
 
+// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-initial-rtt
+// The RTT used before an RTT sample is taken.
+constexpr Duration kInitialRtt = Duration::from_milliseconds(333);
+
 // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-path-maximum-transmission-u
 // The PMTU is the maximum size of the entire IP packet including the IP header, UDP header, and UDP payload.
 // The UDP payload includes the QUIC packet header, protected payload, and any authentication fields.
@@ -23,9 +28,38 @@ constexpr Duration kTimerGranularity = Duration::from_milliseconds(1);
 // and 1252 bytes for IPv4.
 constexpr size_t kMaxDatagramSize = 1280;
 
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-initial-datagram-size
+// A client MUST expand the payload of all UDP datagrams carrying Initial
+// packets to at least 1200 bytes.
+constexpr size_t kMinInitialDatagramSize = 1200;
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-transport-parameter-definit
+// The maximum amount of time by which the endpoint will delay sending
+// acknowledgments, and the exponent used to decode the ACK Delay field.
+constexpr Duration kDefaultMaxAckDelay = Duration::from_milliseconds(25);
+constexpr size_t kDefaultAckDelayExponent = 3;
+
+// The length of the connection IDs we issue. Short headers do not carry
+// the length of the Destination Connection ID, so all our CIDs have the
+// same length.
+constexpr size_t kDefaultCidLength = 8;
+
+// the congestion controller of a connection unless configured otherwise
+constexpr const char *kDefaultCongestionControl = "cubic";
+
 struct QuicConfig {
     // sending buffer size
     size_t tx_buffer_size = 64 * 1024; // 64 KB
+
+    // how long we may hold back an ACK for ack-eliciting packets
+    Duration max_ack_delay = kDefaultMaxAckDelay;
+
+    size_t cid_length = kDefaultCidLength;
+
+    // the name of the congestion controller in CongestionControlRegistry.
+    // A listener hands a copy of its config to each connection, which
+    // may override it, e.g. by traffic class.
+    std::string congestion_control = kDefaultCongestionControl;
 };
 
 extern QuicConfig default_quic_config;
@@ -4,72 +4,230 @@
 
 #include "common/frame.h"
 
-Frames Frame::from_reader(StringReader &reader) {
+#include <array>
+
+#include "util/simd.h"
+
+namespace {
+
+// All the decoders share one signature so that they can be stored in a
+// table. |type_id| is the frame type read from the wire; the decoder
+// stores the normalized type into |frame.type|.
+using FrameDecodeFunction = void (*)(Frame &frame, StringReader &reader,
+                                     FrameType type_id);
+
+struct FrameDecoder {
+    FrameDecodeFunction decode;
+
+    // the packet types in which this frame may appear
+    PacketTypes packet_types;
+};
+
+void decode_padding(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_PADDING;
+    frame.padding = PaddingFrame::from_reader(reader);
+}
+
+void decode_ping(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_PING;
+    frame.ping = PingFrame::from_reader(reader);
+}
+
+void decode_ack(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_ACK;
+    frame.ack = AckFrame::from_reader(reader,
+                                      type_id == FRAME_TYPE_ACK_ECN);
+}
+
+void decode_reset(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_RST_STREAM;
+    frame.reset = ResetFrame::from_reader(reader);
+}
+
+void decode_stop_sending(Frame &frame, StringReader &reader,
+                         FrameType type_id) {
+    frame.type = FRAME_TYPE_STOP_SENDING;
+    frame.stop_sending = StopSendingFrame::from_reader(reader);
+}
+
+void decode_crypto(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_CRYPTO;
+    frame.crypto = CryptoFrame::from_reader(reader);
+}
+
+void decode_new_token(Frame &frame, StringReader &reader,
+                      FrameType type_id) {
+    frame.type = FRAME_TYPE_NEW_TOKEN;
+    frame.new_token = NewTokenFrame::from_reader(reader);
+}
+
+void decode_stream(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_STREAM;
+    frame.stream = StreamFrame::from_reader(reader, type_id);
+}
+
+void decode_max_data(Frame &frame, StringReader &reader, FrameType type_id) {
+    frame.type = FRAME_TYPE_MAX_DATA;
+    frame.max_data = MaxDataFrame::from_reader(reader, type_id);
+}
+
+void decode_max_streams(Frame &frame, StringReader &reader,
+                        FrameType type_id) {
+    frame.type = FRAME_TYPE_MAX_STREAMS_BIDI;
+    frame.max_stream = MaxStreamFrame::from_reader(reader, type_id);
+}
+
+void decode_new_connection_id(Frame &frame, StringReader &reader,
+                              FrameType type_id) {
+    frame.type = FRAME_TYPE_NEW_CONNECTION_ID;
+    frame.new_connection_id = NewConnectionIdFrame::from_reader(reader);
+}
+
+void decode_retire_connection_id(Frame &frame, StringReader &reader,
+                                 FrameType type_id) {
+    frame.type = FRAME_TYPE_RETIRE_CONNECTION_ID;
+    frame.retire_connection_id = RetireConnectionIdFrame::from_reader(reader);
+}
+
+void decode_path(Frame &frame, StringReader &reader, FrameType type_id) {
+    // PATH_CHALLENGE and PATH_RESPONSE keep their own types
+    frame.type = type_id;
+    frame.path = PathFrame::from_reader(reader);
+}
+
+void decode_connection_close(Frame &frame, StringReader &reader,
+                             FrameType type_id) {
+    frame.type = FRAME_TYPE_CONNECTION_CLOSE_TRANSPORT;
+    frame.connection_close = ConnectionCloseFrame::from_reader(reader, type_id);
+}
+
+void decode_handshake_done(Frame &frame, StringReader &reader,
+                           FrameType type_id) {
+    frame.type = FRAME_TYPE_HANDSHAKE_DONE;
+    frame.handshake_done = HandshakeDoneFrame::from_reader(reader);
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-frame-types
+// The "Pkts" column of the frame types table:
+//   I: Initial, H: Handshake, 0: 0-RTT, 1: 1-RTT
+constexpr PacketTypes kPackets_IH01 =
+    packet_type_bit(PacketType::Initial) |
+    packet_type_bit(PacketType::Handshake) |
+    packet_type_bit(PacketType::ZeroRTT) |
+    packet_type_bit(PacketType::OneRTT);
+constexpr PacketTypes kPackets_IH_1 =
+    packet_type_bit(PacketType::Initial) |
+    packet_type_bit(PacketType::Handshake) |
+    packet_type_bit(PacketType::OneRTT);
+constexpr PacketTypes kPackets___01 =
+    packet_type_bit(PacketType::ZeroRTT) |
+    packet_type_bit(PacketType::OneRTT);
+constexpr PacketTypes kPackets____1 =
+    packet_type_bit(PacketType::OneRTT);
+
+constexpr FrameDecoder frame_decoder(FrameType type) {
+    return
+        type == FRAME_TYPE_PADDING ?
+            FrameDecoder{decode_padding, kPackets_IH01} :
+        type == FRAME_TYPE_PING ?
+            FrameDecoder{decode_ping, kPackets_IH01} :
+        type == FRAME_TYPE_ACK || type == FRAME_TYPE_ACK_ECN ?
+            FrameDecoder{decode_ack, kPackets_IH_1} :
+        type == FRAME_TYPE_RST_STREAM ?
+            FrameDecoder{decode_reset, kPackets___01} :
+        type == FRAME_TYPE_STOP_SENDING ?
+            FrameDecoder{decode_stop_sending, kPackets___01} :
+        type == FRAME_TYPE_CRYPTO ?
+            FrameDecoder{decode_crypto, kPackets_IH_1} :
+        type == FRAME_TYPE_NEW_TOKEN ?
+            FrameDecoder{decode_new_token, kPackets____1} :
+        type >= FRAME_TYPE_STREAM && type <= FRAME_TYPE_STREAM_MAX ?
+            FrameDecoder{decode_stream, kPackets___01} :
+        type == FRAME_TYPE_MAX_DATA ||
+        type == FRAME_TYPE_MAX_STREAM_DATA ||
+        type == FRAME_TYPE_DATA_BLOCKED ||
+        type == FRAME_TYPE_STREAM_DATA_BLOCKED ?
+            FrameDecoder{decode_max_data, kPackets___01} :
+        type == FRAME_TYPE_MAX_STREAMS_BIDI ||
+        type == FRAME_TYPE_MAX_STREAMS_UNIDI ||
+        type == FRAME_TYPE_STREAMS_BLOCKED_BIDI ||
+        type == FRAME_TYPE_STREAMS_BLOCKED_UNIDI ?
+            FrameDecoder{decode_max_streams, kPackets___01} :
+        type == FRAME_TYPE_NEW_CONNECTION_ID ?
+            FrameDecoder{decode_new_connection_id, kPackets___01} :
+        type == FRAME_TYPE_RETIRE_CONNECTION_ID ?
+            FrameDecoder{decode_retire_connection_id, kPackets___01} :
+        type == FRAME_TYPE_PATH_CHALLENGE ?
+            FrameDecoder{decode_path, kPackets___01} :
+        type == FRAME_TYPE_PATH_RESPONSE ?
+            FrameDecoder{decode_path, kPackets____1} :
+        type == FRAME_TYPE_CONNECTION_CLOSE_TRANSPORT ?
+            FrameDecoder{decode_connection_close, kPackets_IH01} :
+        type == FRAME_TYPE_CONNECTION_CLOSE_APPLICATION ?
+            FrameDecoder{decode_connection_close, kPackets___01} :
+        type == FRAME_TYPE_HANDSHAKE_DONE ?
+            FrameDecoder{decode_handshake_done, kPackets____1} :
+        FrameDecoder{nullptr, 0};
+}
+
+// std::index_sequence is not available in C++11
+template<size_t... I>
+struct IndexSequence {};
+
+template<size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template<size_t... I>
+struct MakeIndexSequence<0, I...> {
+    using type = IndexSequence<I...>;
+};
+
+template<size_t... I>
+constexpr std::array<FrameDecoder, sizeof...(I)>
+make_frame_decoders(IndexSequence<I...>) {
+    return {{ frame_decoder(static_cast<FrameType>(I))... }};
+}
+
+constexpr std::array<FrameDecoder, kNumOfFrameTypes> kFrameDecoders =
+    make_frame_decoders(MakeIndexSequence<kNumOfFrameTypes>::type());
+
+} // namespace
+
+bool Frame::is_allowed(uint64_t type_id, PacketType packet_type) {
+    return type_id < kNumOfFrameTypes &&
+           (kFrameDecoders[type_id].packet_types &
+            packet_type_bit(packet_type)) != 0;
+}
+
+Frames Frame::from_reader(StringReader &reader, PacketType packet_type) {
 
     Frames result;
+    PacketTypes packet_type_mask = packet_type_bit(packet_type);
+
+    try {
+        while (!reader.empty()) {
+            uint64_t type_id = reader.read_with_variant_length();
 
-    while (!reader.empty()) {
-        Frame frame;
-        FrameType type_id = reader.read_with_variant_length();
-
-        frame.type = type_id;
-
-        switch (type_id) {
-            case FRAME_TYPE_PADDING:
-                frame.padding = PaddingFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_PING:
-                frame.ping = PingFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_ACK:
-                frame.ack = AckFrame::from_reader(reader, false);
-                break;
-            case FRAME_TYPE_ACK_ECN:
-                frame.type = FRAME_TYPE_ACK;
-                frame.ack = AckFrame::from_reader(reader, true);
-                break;
-            case FRAME_TYPE_RST_STREAM:
-                frame.reset = ResetFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_STOP_SENDING:
-                frame.stop_sending = StopSendingFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_CRYPTO:
-                frame.crypto = CryptoFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_NEW_TOKEN:
-                frame.new_token = NewTokenFrame::from_reader(reader);
-                break;
-            case FRAME_TYPE_STREAM ... FRAME_TYPE_STREAM_MAX:
-                frame.type = FRAME_TYPE_STREAM;
-                frame.stream = StreamFrame::from_reader(reader, type_id);
-                break;
-
-            case FRAME_TYPE_MAX_DATA:
-            case FRAME_TYPE_MAX_STREAM_DATA:
-
-            case FRAME_TYPE_DATA_BLOCKED:
-            case FRAME_TYPE_STREAM_DATA_BLOCKED:
-                frame.type = FRAME_TYPE_MAX_DATA;
-                frame.max_data = MaxDataFrame::from_reader(reader, type_id);
-
-            case FRAME_TYPE_MAX_STREAMS_BIDI:
-            case FRAME_TYPE_MAX_STREAMS_UNIDI:
-
-            case FRAME_TYPE_STREAMS_BLOCKED_BIDI:
-            case FRAME_TYPE_STREAMS_BLOCKED_UNIDI:
-                frame.type = FRAME_TYPE_MAX_STREAMS_BIDI;
-                frame.max_stream = MaxStreamFrame::from_reader(reader, type_id);
-                break;
-
-            case FRAME_TYPE_HANDSHAKE_DONE:
-                frame.handshake_done = HandshakeDoneFrame::from_reader(reader);
-                break;
-            default:
+            if (type_id >= kNumOfFrameTypes) {
                 throw quic_error(QuicError::FRAME_ENCODING_ERROR);
-        }
+            }
+
+            const FrameDecoder &decoder = kFrameDecoders[type_id];
+
+            if ((decoder.packet_types & packet_type_mask) == 0) {
+                throw quic_error(QuicError::PROTOCOL_VIOLATION);
+            }
 
-        result.push_back(frame);
+            Frame frame;
+            decoder.decode(frame, reader, static_cast<FrameType>(type_id));
+            result.push_back(frame);
+        }
+    } catch (...) {
+        // the caller never sees the frames decoded so far
+        for (Frame &frame : result) {
+            frame.delete_frame();
+        }
+        throw;
     }
 
     return result;
@@ -79,24 +237,33 @@ void Frame::delete_frame() {
     switch (type) {
         case FRAME_TYPE_ACK:
             delete ack;
+            break;
         case FRAME_TYPE_NEW_TOKEN:
             delete new_token;
+            break;
         case FRAME_TYPE_STREAM:
             delete stream;
+            break;
+        case FRAME_TYPE_NEW_CONNECTION_ID:
+            delete new_connection_id;
+            break;
+        case FRAME_TYPE_CONNECTION_CLOSE_TRANSPORT:
+            delete connection_close;
+            break;
         default:
             return;
     }
 }
 
 PaddingFrame PaddingFrame::from_reader(StringReader &reader) {
-    size_t size = 1;
-
-    while (!reader.empty() && reader.peek_u8() == 0) {
-        reader.skip(1);
-        size += 1;
-    }
-
-    return PaddingFrame{size};
+    // The type byte has been consumed. A run of PADDING frames is
+    // skipped at once; Initial packets are padded to 1200 bytes and
+    // PMTU probes consist of little else.
+    size_t run = simd::find_first_nonzero(reader.peek_data(),
+                                          reader.remaining());
+    reader.skip(run);
+
+    return PaddingFrame{run + 1};
 }
 
 CryptoFrame CryptoFrame::from_reader(StringReader &reader) {
@@ -234,5 +401,59 @@ MaxStreamFrame MaxStreamFrame::from_reader(StringReader &reader, FrameType type_
     };
 }
 
+NewConnectionIdFrame *NewConnectionIdFrame::from_reader(StringReader &reader) {
+    uint64_t sequence_number = reader.read_with_variant_length();
+    uint64_t retire_prior_to = reader.read_with_variant_length();
+    if (retire_prior_to > sequence_number) {
+        throw quic_error(QuicError::FRAME_ENCODING_ERROR);
+    }
+
+    // Values less than 1 and greater than 20 are invalid: the zero
+    // length is rejected here, and Cid::from_reader() rejects the longer.
+    if (reader.peek_u8() == 0) {
+        throw quic_error(QuicError::FRAME_ENCODING_ERROR);
+    }
+    Cid cid = Cid::from_reader(reader);
+
+    StringRef token = {reader.peek_data(), 16};
+    reader.skip(16);
+
+    return new NewConnectionIdFrame {
+        .sequence_number = sequence_number,
+        .retire_prior_to = retire_prior_to,
+        .cid = cid,
+        .stateless_reset_token = token,
+    };
+}
+
+RetireConnectionIdFrame RetireConnectionIdFrame::from_reader(StringReader &reader) {
+    return RetireConnectionIdFrame {
+        .sequence_number = reader.read_with_variant_length(),
+    };
+}
 
+PathFrame PathFrame::from_reader(StringReader &reader) {
+    PathFrame frame{};
+    reader.read(frame.data, sizeof frame.data);
+    return frame;
+}
 
+ConnectionCloseFrame *ConnectionCloseFrame::from_reader(StringReader &reader,
+                                                        FrameType type_id) {
+    bool is_application = type_id == FRAME_TYPE_CONNECTION_CLOSE_APPLICATION;
+    uint64_t error_code = reader.read_with_variant_length();
+    uint64_t frame_type = 0;
+    if (!is_application) {
+        frame_type = reader.read_with_variant_length();
+    }
+    uint64_t length = reader.read_with_variant_length();
+    StringRef reason = {reader.peek_data(), length};
+    reader.skip(length);
+
+    return new ConnectionCloseFrame {
+        .is_application = is_application,
+        .error_code = error_code,
+        .frame_type = frame_type,
+        .reason = reason,
+    };
+}
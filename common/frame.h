@@ -10,8 +10,6 @@
 #include "util/optional.h"
 #include "common/quic_types.h"
 
-constexpr int kNumOfFrameTypes = 21;
-
 using FrameType = uint8_t;
 
 constexpr FrameType FRAME_TYPE_PADDING = 0x0;
@@ -55,6 +53,10 @@ constexpr FrameType FRAME_TYPE_CONNECTION_CLOSE_TRANSPORT = 0x1c;
 constexpr FrameType FRAME_TYPE_CONNECTION_CLOSE_APPLICATION = 0x1d;
 constexpr FrameType FRAME_TYPE_HANDSHAKE_DONE = 0x1e;
 
+// Frame types are numbered from 0x00 to 0x1e without holes; the decoder
+// table has one entry for each of them.
+constexpr int kNumOfFrameTypes = FRAME_TYPE_HANDSHAKE_DONE + 1;
+
 using std::experimental::optional;
 
 struct PaddingFrame {
@@ -155,6 +157,49 @@ struct MaxStreamFrame {
             FrameType type_id);
 };
 
+struct NewConnectionIdFrame {
+    uint64_t sequence_number;
+    uint64_t retire_prior_to;
+    Cid cid;
+
+    // 16 bytes
+    StringRef stateless_reset_token;
+
+    static NewConnectionIdFrame *from_reader(StringReader &reader);
+};
+
+struct RetireConnectionIdFrame {
+    uint64_t sequence_number;
+
+    static RetireConnectionIdFrame from_reader(StringReader &reader);
+};
+
+// the following two types are stored in the same `struct PathFrame`:
+// PATH_CHALLENGE and PATH_RESPONSE
+struct PathFrame {
+    // 8 bytes of arbitrary data, kept in network byte order
+    uint8_t data[8];
+
+    static PathFrame from_reader(StringReader &reader);
+};
+
+// the following two types are stored in the same `struct ConnectionCloseFrame`
+struct ConnectionCloseFrame {
+    // the error is a transport error (QuicError) unless the frame is sent
+    // by the application
+    bool is_application;
+    uint64_t error_code;
+
+    // the type of frame that triggered the error, 0 if unknown; only
+    // present in the transport variant
+    uint64_t frame_type;
+
+    StringRef reason;
+
+    static ConnectionCloseFrame *from_reader(StringReader &reader,
+            FrameType type_id);
+};
+
 struct HandshakeDoneFrame {
     /* empty */
 
@@ -181,12 +226,21 @@ struct Frame {
         StreamFrame *stream;
         MaxDataFrame max_data;
         MaxStreamFrame max_stream;
+        NewConnectionIdFrame *new_connection_id;
+        RetireConnectionIdFrame retire_connection_id;
+        PathFrame path;
+        ConnectionCloseFrame *connection_close;
         HandshakeDoneFrame handshake_done;
     };
 
     void delete_frame();
 
-    static Frames from_reader(StringReader &reader);
+    // Decode all the frames in the payload of a packet of type
+    // |packet_type|. A frame that is not allowed in that packet type is
+    // a connection error of type PROTOCOL_VIOLATION.
+    static Frames from_reader(StringReader &reader, PacketType packet_type);
+
+    static bool is_allowed(uint64_t type_id, PacketType packet_type);
 };
 
 static_assert(sizeof(Frame) <= 32, 
@@ -0,0 +1,131 @@
+//
+// Created by Chengke Wong on 2020/5/18.
+//
+
+#include "gtest/gtest.h"
+#include "common/frame.h"
+
+class FrameTest : public ::testing::Test {
+protected:
+    FrameTest() = default;
+
+    ~FrameTest() override = default;
+
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+        for (Frame &frame : frames) {
+            frame.delete_frame();
+        }
+    }
+
+    void decode(const char *hex, PacketType type = PacketType::OneRTT) {
+        payload = String::from_hex(hex);
+        StringReader reader(payload);
+        frames = Frame::from_reader(reader, type);
+    }
+
+    QuicError decode_error(const char *hex, PacketType type) {
+        try {
+            decode(hex, type);
+        } catch (const quic_error &e) {
+            return e.error();
+        }
+        return QuicError::INTERNAL_ERROR;
+    }
+
+    String payload{0};
+    Frames frames;
+};
+
+TEST_F(FrameTest, Padding) {
+    decode("01 0000000000000000000000000000000000000000 01 00",
+           PacketType::Initial);
+    ASSERT_EQ(frames.size(), 4);
+    EXPECT_EQ(frames[0].type, FRAME_TYPE_PING);
+    EXPECT_EQ(frames[1].type, FRAME_TYPE_PADDING);
+    EXPECT_EQ(frames[1].padding.size, 20);
+    EXPECT_EQ(frames[2].type, FRAME_TYPE_PING);
+    EXPECT_EQ(frames[3].padding.size, 1);
+}
+
+TEST_F(FrameTest, MaxData) {
+    // MAX_STREAM_DATA followed by MAX_STREAMS
+    decode("11 04 4100 12 0a");
+    ASSERT_EQ(frames.size(), 2);
+    EXPECT_EQ(frames[0].type, FRAME_TYPE_MAX_DATA);
+    EXPECT_FALSE(frames[0].max_data.is_connection_level);
+    EXPECT_EQ(frames[0].max_data.max_data, 0x100);
+    EXPECT_EQ(frames[1].type, FRAME_TYPE_MAX_STREAMS_BIDI);
+    EXPECT_EQ(frames[1].max_stream.max_stream, 10);
+}
+
+TEST_F(FrameTest, ConnectionId) {
+    decode("18 05 02 04 01020304 00112233445566778899aabbccddeeff"
+           "19 03");
+    ASSERT_EQ(frames.size(), 2);
+    ASSERT_EQ(frames[0].type, FRAME_TYPE_NEW_CONNECTION_ID);
+    EXPECT_EQ(frames[0].new_connection_id->sequence_number, 5);
+    EXPECT_EQ(frames[0].new_connection_id->retire_prior_to, 2);
+    EXPECT_EQ(frames[0].new_connection_id->cid.to_hex(), "01020304");
+    EXPECT_EQ(frames[0].new_connection_id->stateless_reset_token.to_hex(),
+              "00112233445566778899aabbccddeeff");
+    ASSERT_EQ(frames[1].type, FRAME_TYPE_RETIRE_CONNECTION_ID);
+    EXPECT_EQ(frames[1].retire_connection_id.sequence_number, 3);
+}
+
+TEST_F(FrameTest, Path) {
+    decode("1a 0102030405060708 1b 0807060504030201");
+    ASSERT_EQ(frames.size(), 2);
+    EXPECT_EQ(frames[0].type, FRAME_TYPE_PATH_CHALLENGE);
+    EXPECT_EQ(frames[0].path.data[0], 1);
+    EXPECT_EQ(frames[1].type, FRAME_TYPE_PATH_RESPONSE);
+    EXPECT_EQ(frames[1].path.data[0], 8);
+}
+
+TEST_F(FrameTest, ConnectionClose) {
+    decode("1c 0a 08 03 626164", PacketType::Handshake);
+    ASSERT_EQ(frames.size(), 1);
+    ASSERT_EQ(frames[0].type, FRAME_TYPE_CONNECTION_CLOSE_TRANSPORT);
+    EXPECT_FALSE(frames[0].connection_close->is_application);
+    EXPECT_EQ(frames[0].connection_close->error_code, 0xa);
+    EXPECT_EQ(frames[0].connection_close->frame_type, FRAME_TYPE_STREAM);
+    EXPECT_EQ(frames[0].connection_close->reason.to_hex(), "626164");
+
+    for (Frame &frame : frames) {
+        frame.delete_frame();
+    }
+    decode("1d 4001 00");
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_TRUE(frames[0].connection_close->is_application);
+    EXPECT_EQ(frames[0].connection_close->error_code, 1);
+    EXPECT_EQ(frames[0].connection_close->reason.size(), 0);
+}
+
+TEST_F(FrameTest, PacketTypes) {
+    // STREAM in an Initial packet
+    EXPECT_EQ(decode_error("08 00 00", PacketType::Initial),
+              QuicError::PROTOCOL_VIOLATION);
+    // ACK in a 0-RTT packet
+    EXPECT_EQ(decode_error("02 00 00 00 00", PacketType::ZeroRTT),
+              QuicError::PROTOCOL_VIOLATION);
+    // HANDSHAKE_DONE in a Handshake packet
+    EXPECT_EQ(decode_error("1e", PacketType::Handshake),
+              QuicError::PROTOCOL_VIOLATION);
+    // unknown frame type
+    EXPECT_EQ(decode_error("1f", PacketType::OneRTT),
+              QuicError::FRAME_ENCODING_ERROR);
+    EXPECT_EQ(decode_error("4108", PacketType::OneRTT),
+              QuicError::FRAME_ENCODING_ERROR);
+
+    // ACK and NEW_TOKEN are freed when a later frame is disallowed
+    EXPECT_EQ(decode_error("02 00 00 00 00 08 00 00", PacketType::Initial),
+              QuicError::PROTOCOL_VIOLATION);
+    EXPECT_EQ(decode_error("07 02 abcd 1f", PacketType::OneRTT),
+              QuicError::FRAME_ENCODING_ERROR);
+    EXPECT_TRUE(frames.empty());
+
+    EXPECT_TRUE(Frame::is_allowed(FRAME_TYPE_CRYPTO, PacketType::Initial));
+    EXPECT_FALSE(Frame::is_allowed(FRAME_TYPE_CRYPTO, PacketType::ZeroRTT));
+}
@@ -4,18 +4,32 @@
 
 #include "common/quic_types.h"
 
+#include <random>
+
 Cid Cid::from_reader(StringReader &reader)  {
     uint8_t length = reader.read_u8();
     if (length > 20) {
         throw error_discard_packet("the CID is longer than 20 bytes");
     }
 
-    Cid result(length);
-    reader.read(result);
+    if (reader.remaining() < length) {
+        throw error_discard_packet("the CID is truncated");
+    }
+
+    Cid result(reader.peek_data(), length);
+    reader.skip(length);
 
     return result;
 }
 
+uint64_t CidHash::default_seed() {
+    static const uint64_t seed = [] {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) | device();
+    }();
+    return seed;
+}
+
 Token Token::from_reader(StringReader &reader) {
     uint64_t length = reader.read_with_variant_length();
 
@@ -30,17 +44,26 @@ PacketNumber::dtype PacketNumber::from_string(StringRef s, size_t length) {
         throw std::overflow_error("string is too short to get a packet number");
     }
 
+    PacketNumber::dtype result = 0;
     switch (length) {
         case 1:
-            return s[0];
         case 2:
-            return (s[0] << 8) | s[1];
         case 3:
-            return (s[0] << 16) | (s[1] << 8) | s[2];
         case 4:
-            return (s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3];
+            for (size_t i = 0; i < length; i++) {
+                result = (result << 8) | s[i];
+            }
+            return result;
         default:
             throw std::invalid_argument(
                 "the packet number length should no more than 32 bit");
     }
 }
+
+void PacketNumber::to_writer(StringWriter &writer, dtype full_pn,
+                             size_t length) {
+    DCHECK(length >= 1 && length <= 4);
+    for (size_t i = length; i > 0; i--) {
+        writer.write_u8(static_cast<uint8_t>(full_pn >> ((i - 1) * 8)));
+    }
+}
@@ -5,9 +5,17 @@
 #ifndef TRANSPORT_TYPES_H
 #define TRANSPORT_TYPES_H
 
+#include <cstring>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "util/string_raw.h"
 #include "util/utility.h"
 #include "util/string_reader.h"
+#include "util/string_writer.h"
 
 #include "transport/exception.h"
 
@@ -48,16 +56,123 @@ private:
  *    2. the CID [0..20] bytes in length (i.e. [0..160] bits)
  */
 
-class Cid : public String {
+class Cid {
 
 public:
 
-    template<typename... Args>
-    explicit Cid(Args&&... args)
-        : String(std::forward<Args>(args)...)
-        {}
+    static constexpr size_t kMaxLength = 20;
+
+    // an empty CID
+    Cid() : bytes_{} {}
+
+    Cid(const uint8_t *data, size_t length)
+        : bytes_{} {
+        if (length > kMaxLength) {
+            throw error_discard_packet("the CID is longer than 20 bytes");
+        }
+        bytes_[0] = static_cast<uint8_t>(length);
+        memcpy(bytes_ + 1, data, length);
+    }
+
+    explicit Cid(StringRef s)
+        : Cid(s.data(), s.size()) {}
+
+    inline size_t size() const {
+        return bytes_[0];
+    }
+
+    inline bool empty() const {
+        return size() == 0;
+    }
+
+    inline const uint8_t *data() const {
+        return bytes_ + 1;
+    }
+
+    // a view of the CID, valid as long as the CID itself
+    inline StringRef as_string_ref() const {
+        return StringRef(const_cast<uint8_t *>(data()), size());
+    }
+
+    inline std::string to_hex() const {
+        return as_string_ref().to_hex();
+    }
+
+    // The unused bytes are always zero, so two CIDs are equal iff all
+    // their kStorageSize bytes, the length included, are equal.
+    inline bool operator == (const Cid &other) const {
+#ifdef __SSE2__
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes_));
+        __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(other.bytes_));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xffff) {
+            return false;
+        }
+        return word(16) == other.word(16);
+#else
+        return word(0) == other.word(0) && word(8) == other.word(8) &&
+               word(16) == other.word(16);
+#endif
+    }
+
+    inline bool operator != (const Cid &other) const {
+        return !(*this == other);
+    }
 
     static Cid from_reader(StringReader &reader);
+
+private:
+
+    friend class CidHash;
+
+    // the length byte, the CID and zero padding up to three 8-byte words
+    static constexpr size_t kStorageSize = 24;
+
+    inline uint64_t word(size_t offset) const {
+        uint64_t result;
+        memcpy(&result, bytes_ + offset, sizeof(result));
+        return result;
+    }
+
+    uint8_t bytes_[kStorageSize];
+
+};
+
+// A seeded hash of CIDs, e.g. for the connection table of a server. The
+// CIDs are chosen by the peer, so a per-process random seed keeps an
+// attacker from forcing collisions.
+class CidHash {
+
+public:
+
+    CidHash() : seed_(default_seed()) {}
+
+    explicit CidHash(uint64_t seed) : seed_(seed) {}
+
+    inline size_t operator () (const Cid &cid) const {
+        uint64_t h = seed_;
+        h = mix(h ^ cid.word(0));
+        h = mix(h ^ cid.word(8));
+        h = mix(h ^ cid.word(16));
+        return static_cast<size_t>(h);
+    }
+
+private:
+
+    // the finalizer of MurmurHash3
+    static inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint64_t default_seed();
+
+    uint64_t seed_;
+
 };
 
 class Token : public String {
@@ -83,8 +198,38 @@ public:
 
     dtype value;
 
+    // Packet numbers are integers in the range 0 to 2^62-1.
+    static constexpr dtype kMaxValue = (dtype(1) << 62) - 1;
+
+    // return the truncated packet number of |length| bytes
     static PacketNumber::dtype from_string(StringRef s, size_t length);
 
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-sample-packet-number-decodi
+    // Reconstruct the full packet number from the |length|-byte |truncated|
+    // one. The result is the packet number closest to |expected|, i.e. one
+    // more than the largest packet number received in this space.
+    static constexpr dtype decode(dtype expected, dtype truncated,
+                                  size_t length) {
+        return decode_candidate(
+            expected, (expected & ~(window(length) - 1)) | truncated,
+            window(length));
+    }
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-sample-packet-number-encodi
+    // The sender MUST use a packet number size able to represent more
+    // than twice as large a range than the difference between the largest
+    // acknowledged packet and packet number being sent.
+    //
+    // |peer_expected| is one more than the largest acknowledged packet,
+    // or 0 if nothing has been acknowledged in this space.
+    static constexpr size_t encoded_length(dtype full_pn,
+                                           dtype peer_expected) {
+        return encoded_length_of_range(full_pn + 1 - peer_expected);
+    }
+
+    // write the lowest |length| bytes of |full_pn|
+    static void to_writer(StringWriter &writer, dtype full_pn, size_t length);
+
     inline bool operator< (const PacketNumber &o) const {
         return value < o.value;
     }
@@ -93,10 +238,51 @@ public:
         return value > o.value;
     }
 
+private:
+
+    static constexpr dtype window(size_t length) {
+        return dtype(1) << (length * 8);
+    }
+
+    static constexpr dtype decode_candidate(dtype expected, dtype candidate,
+                                            dtype win) {
+        return (candidate + win / 2 <= expected &&
+                candidate < kMaxValue + 1 - win) ? candidate + win
+            : (candidate > expected + win / 2 && candidate >= win)
+                ? candidate - win
+            : candidate;
+    }
+
+    static constexpr size_t encoded_length_of_range(dtype num_unacked) {
+        return num_unacked <= (dtype(1) << 7) ? 1
+            : num_unacked <= (dtype(1) << 15) ? 2
+            : num_unacked <= (dtype(1) << 23) ? 3
+            : 4;
+    }
+
 };
 
 using Version = uint32_t;
 
+enum class PacketType {
+    // Long Header Packet Types
+    Initial = 0,
+    ZeroRTT = 1,
+    Handshake = 2,
+    Retry = 3,
+    // Version Negotiation
+    VersionNegotiation = 4,
+    // Short Header Packet Types
+    OneRTT = 5,
+};
+
+// a set of PacketTypes
+using PacketTypes = uint8_t;
+
+constexpr PacketTypes packet_type_bit(PacketType type) {
+    return static_cast<PacketTypes>(1u << static_cast<uint8_t>(type));
+}
+
 // packet number spaces
 constexpr size_t kNumOfPNSpaces = 3;
 enum class PNSpace {
@@ -105,4 +291,15 @@ enum class PNSpace {
     Application = 2,
 };
 
+// the ECN field of the IP header
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-explicit-congestion-notific
+enum class EcnCodepoint : uint8_t {
+    NotEct = 0b00,
+    // ECT(1), for L4S congestion controllers (RFC 9331)
+    Ect1 = 0b01,
+    Ect0 = 0b10,
+    // Congestion Experienced
+    Ce = 0b11,
+};
+
 #endif //TRANSPORT_TYPES_H
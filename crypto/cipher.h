@@ -37,6 +37,22 @@ public:
         return hp_;
     }
 
+    StringRef key() const {
+        return key_;
+    }
+
+    StringRef iv() const {
+        return iv_;
+    }
+
+    AeadAlgorithm aead_algorithm() const {
+        return get_aead_algorithm(suite_);
+    }
+
+    HpAlgorithm hp_algorithm() const {
+        return get_hp_algorithm(suite_);
+    }
+
 private:
 
     // return the corresponding AEAD algorithms
@@ -146,6 +146,11 @@ void UDPSocket::set_timestamps(void) {
 #endif
 }
 
+/* the ECN field is the two low bits of the TOS byte */
+void UDPSocket::set_ecn(uint8_t codepoint) {
+    setsockopt(IPPROTO_IP, IP_TOS, int(codepoint & 0b11));
+}
+
 std::tuple<SockAddr, size_t> UDPSocket::recvfrom(StringRef data) {
     static const ssize_t RECEIVE_MTU = 65536;
 
@@ -65,6 +65,9 @@ public:
 
     /* turn on timestamps on receipt */
     void set_timestamps();
+
+    /* set the ECN field of the datagrams sent, e.g. 0b01 for ECT(1) */
+    void set_ecn(uint8_t codepoint);
 };
 
 /* TCP socket */
@@ -7,8 +7,39 @@
 
 #include <ostream>
 
+#include "common/quic_types.h"
+#include "recovery/delivery_rate.h"
+#include "recovery/rtt_time.h"
 #include "recovery/sent_packet.h"
 
+// the ECN counts of an ACK frame, or their increase since the last one
+struct EcnCounts {
+    uint64_t ect0;
+    uint64_t ect1;
+    uint64_t ce;
+};
+
+// A snapshot of a controller, the same for all of them, for logging and
+// monitoring; see CongestionControl::info().
+struct CongestionControlInfo {
+    // the name the controller is registered with
+    const char *name;
+    // the phase the algorithm is in, e.g. "slow_start"
+    const char *state;
+    // in bytes
+    size_t congestion_window;
+    size_t bytes_in_flight;
+    // in bytes per second, 0 if the packets are not paced
+    uint64_t pacing_rate;
+};
+
+inline std::ostream& operator<< (std::ostream& os,
+                                 const CongestionControlInfo& info) {
+    return os << info.name << " " << info.state << " "
+              << info.bytes_in_flight << "/" << info.congestion_window
+              << " pacing " << info.pacing_rate;
+}
+
 // CC interface
 class CongestionControl {
 
@@ -16,20 +47,64 @@ public:
 
     virtual ~CongestionControl() = default;
 
-    virtual void on_packet_sent(unique_ptr<SentPacket> &packet) = 0;
+    virtual void on_packet_sent(SentPacketPtr &packet) = 0;
+
+    virtual void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) = 0;
+
+    // |packets| are in packet number order
+    virtual void on_packet_acked(Instant now, const RttTime &rtt,
+                                 std::vector<SentPacketPtr> &packets) = 0;
+
+    // |newly| is the increase in the ECN counts reported by an ACK frame,
+    // called before the packets it acknowledges are passed to
+    // on_packet_acked(). |largest_acked_time_sent| is the time the
+    // largest packet newly acknowledged was sent.
+    virtual void on_ecn_counts(Instant now, const EcnCounts &newly,
+                               Instant largest_acked_time_sent) {}
 
-    virtual void on_packet_lost(Instant now, std::vector<unique_ptr<SentPacket>> &packets) = 0;
+    // the delivery rate sample of an ACK, called before the packets it
+    // acknowledges are passed to on_packet_acked(). The packets carry the
+    // DeliveryState of the same DeliveryRateSampler; see LossRecovery.
+    virtual void on_rate_sample(Instant now, const RateSample &rs) {}
 
-    virtual void on_packet_acked(std::vector<unique_ptr<SentPacket>> &packets) = 0;
+    // the ECN codepoint the packets should be sent with
+    virtual EcnCodepoint ecn_codepoint() const {
+        return EcnCodepoint::NotEct;
+    }
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-pacing
+    // in bytes per second, or 0 if the packets need not be paced. By
+    // default, kPacingGain times the window per smoothed RTT, so that the
+    // window rather than the pacer limits the sending rate.
+    virtual uint64_t pacing_rate(const RttTime &rtt) const {
+        int64_t smoothed_rtt = rtt.smoothed_rtt().to_microseconds();
+        if (smoothed_rtt == 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(
+            kPacingGain * congestion_window() * 1000000 / smoothed_rtt);
+    }
+
+    // in bytes
+    virtual size_t congestion_window() const = 0;
 
-    virtual void print(std::ostream& os) {
-    	os << "unknown cc";
+    virtual size_t bytes_in_flight() const = 0;
+
+    // the name the controller is registered with; see cc_registry.h
+    virtual const char *name() const = 0;
+
+    // the phase the algorithm is in, e.g. "slow_start"
+    virtual const char *state_name() const = 0;
+
+    inline CongestionControlInfo info(const RttTime &rtt) const {
+        return CongestionControlInfo{name(), state_name(),
+                                     congestion_window(), bytes_in_flight(),
+                                     pacing_rate(rtt)};
     }
 
-    friend std::ostream& operator<< (std::ostream& out, CongestionControl& self) {
-	    self.print(out);
-	    return out;
-	}
+protected:
+
+    static constexpr double kPacingGain = 1.25;
 
 };
 
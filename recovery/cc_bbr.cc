@@ -0,0 +1,529 @@
+//
+// Created by Chengke Wong on 2020/5/26.
+//
+
+#include "recovery/cc_bbr.h"
+
+#include <limits>
+
+namespace {
+
+constexpr Duration kMinRttFilterLen = Duration::from_seconds(10);
+
+constexpr Duration kProbeRttInterval = Duration::from_seconds(5);
+
+constexpr Duration kProbeRttDuration = Duration::from_milliseconds(200);
+
+// ProbeBW probes for bandwidth after 2 to 3 seconds
+constexpr Duration kProbeBwWaitBase = Duration::from_seconds(2);
+
+constexpr int64_t kProbeBwWaitRandomUs = 1000000;
+
+// the rounds between probes never exceed this, so that BBR probes at
+// least as often as a Reno flow with a window of 63 packets
+constexpr uint64_t kMaxRenoRounds = 63;
+
+constexpr uint64_t kUnbounded = std::numeric_limits<uint64_t>::max();
+
+constexpr size_t kUnboundedInflight = std::numeric_limits<size_t>::max();
+
+} // namespace
+
+constexpr size_t CcBbr::kMinPipeCwnd;
+
+CcBbr::CcBbr()
+    : state_(State::Startup),
+      pacing_gain_(kStartupPacingGain),
+      cwnd_gain_(kDefaultCwndGain),
+      cwnd_(kInitialWindow),
+      bytes_in_flight_(0),
+      pacing_rate_(0),
+      delivered_(0),
+      lost_(0),
+      bw_hi_{0, 0},
+      max_bw_(0),
+      bw_lo_(kUnbounded),
+      bw_latest_(0),
+      inflight_hi_(kUnboundedInflight),
+      inflight_lo_(kUnboundedInflight),
+      inflight_latest_(0),
+      min_rtt_(Duration::infinite()),
+      min_rtt_stamp_(Instant::zero()),
+      probe_rtt_min_delay_(Duration::infinite()),
+      probe_rtt_min_stamp_(Instant::zero()),
+      probe_rtt_expired_(false),
+      probe_rtt_done_stamp_(Instant::infinite()),
+      probe_rtt_round_done_(false),
+      filled_pipe_(false),
+      full_bw_(0),
+      full_bw_count_(0),
+      round_count_(0),
+      next_round_delivered_(0),
+      round_start_(false),
+      round_lost_start_(0),
+      round_delivered_start_(0),
+      loss_events_in_round_(0),
+      round_had_loss_(false),
+      round_high_loss_(false),
+      round_ect_packets_(0),
+      round_ce_packets_(0),
+      round_had_ecn_(false),
+      ecn_alpha_(1.0),
+      startup_ecn_rounds_(0),
+      cycle_stamp_(Instant::zero()),
+      bw_probe_wait_(Duration::zero()),
+      rounds_since_bw_probe_(0),
+      bw_probe_up_rounds_(0),
+      bw_probe_up_acks_(0),
+      bw_probe_up_count_(kUnboundedInflight),
+      bw_probe_samples_(false),
+      prior_cwnd_(0),
+      random_(1)
+{}
+
+const char *CcBbr::state_name() const {
+    static const char *kStateNames[] = {
+        "startup", "drain", "probe_bw_down", "probe_bw_cruise",
+        "probe_bw_refill", "probe_bw_up", "probe_rtt",
+    };
+    return kStateNames[static_cast<int>(state_)];
+}
+
+void CcBbr::on_packet_sent(SentPacketPtr &packet) {
+    if (pacing_rate_ == 0) {
+        // No RTT yet; assume 1 ms.
+        pacing_rate_ = static_cast<uint64_t>(
+            kStartupPacingGain * kInitialWindow * 1000);
+    }
+    bytes_in_flight_ += packet->sent_bytes;
+}
+
+void CcBbr::on_rate_sample(Instant now, const RateSample &rs) {
+    rate_sample_ = rs;
+}
+
+void CcBbr::on_ecn_counts(Instant now, const EcnCounts &newly,
+                          Instant largest_acked_time_sent) {
+    // the round is told apart in on_packet_acked(), which follows
+    round_ect_packets_ += newly.ect0 + newly.ect1 + newly.ce;
+    round_ce_packets_ += newly.ce;
+}
+
+void CcBbr::on_packet_acked(Instant now, const RttTime &rtt,
+                            std::vector<SentPacketPtr> &packets) {
+    if (packets.empty()) {
+        return;
+    }
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        delivered_ += packet->sent_bytes;
+    }
+
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-per-ack-steps
+    const RateSample &rs = rate_sample_;
+    bool valid = rs.delivery_rate > 0;
+
+    update_round(rs);
+    update_max_bandwidth(rs, valid);
+    update_min_rtt(now, rs.rtt);
+    if (round_start_) {
+        update_ecn(now, rs);
+        update_lower_bounds();
+    }
+    bw_latest_ = std::max(bw_latest_, rs.delivery_rate);
+    inflight_latest_ = std::max<size_t>(inflight_latest_, rs.delivered);
+
+    check_startup_done(rs);
+    check_drain(now);
+    update_probe_bw_cycle(now, rs);
+    check_probe_rtt(now);
+
+    set_pacing_rate(pacing_gain_);
+    set_cwnd(rs);
+}
+
+void CcBbr::on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) {
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        lost_ += packet->sent_bytes;
+        loss_events_in_round_ += 1;
+
+        // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-probe_bw-and-loss
+        const DeliveryState &state = packet->delivery;
+        uint64_t lost = lost_ - state.lost;
+        if (bw_probe_samples_ && lost > state.tx_in_flight * kLossThresh) {
+            handle_inflight_too_high(now, state.is_app_limited,
+                                     state.tx_in_flight);
+        }
+    }
+}
+
+void CcBbr::update_round(const RateSample &rs) {
+    round_start_ = false;
+    if (rs.prior_delivered < next_round_delivered_) {
+        return;
+    }
+    round_start_ = true;
+    round_count_ += 1;
+    rounds_since_bw_probe_ += 1;
+    next_round_delivered_ = delivered_;
+
+    uint64_t lost = lost_ - round_lost_start_;
+    uint64_t delivered = delivered_ - round_delivered_start_;
+    round_had_loss_ = lost > 0;
+    round_high_loss_ = loss_events_in_round_ >= kStartupFullLossCount &&
+        lost > (lost + delivered) * kLossThresh;
+    round_lost_start_ = lost_;
+    round_delivered_start_ = delivered_;
+    loss_events_in_round_ = 0;
+}
+
+void CcBbr::update_ecn(Instant now, const RateSample &rs) {
+    uint64_t ect = round_ect_packets_;
+    uint64_t ce = round_ce_packets_;
+    round_ect_packets_ = 0;
+    round_ce_packets_ = 0;
+    round_had_ecn_ = ce > 0;
+    if (ect == 0) {
+        // no ECN feedback in the round
+        return;
+    }
+
+    double ce_ratio = static_cast<double>(ce) / ect;
+    ecn_alpha_ = (1 - kEcnAlphaGain) * ecn_alpha_ + kEcnAlphaGain * ce_ratio;
+    bool too_high = ce_ratio > kEcnThresh;
+
+    if (!filled_pipe_) {
+        startup_ecn_rounds_ = too_high ? startup_ecn_rounds_ + 1 : 0;
+        if (startup_ecn_rounds_ >= kStartupFullEcnRounds) {
+            // as check_startup_done() does on a high loss round
+            filled_pipe_ = true;
+            inflight_hi_ = std::max(bdp(1.0), inflight_latest_);
+            if (state_ == State::Startup) {
+                set_state(State::Drain, kDrainPacingGain, kDefaultCwndGain);
+            }
+        }
+    } else if (too_high && bw_probe_samples_) {
+        handle_inflight_too_high(now, rs.is_app_limited, rs.tx_in_flight);
+    }
+}
+
+void CcBbr::update_max_bandwidth(const RateSample &rs, bool valid) {
+    // An app-limited sample only counts if it shows a higher bandwidth.
+    if (!valid || (rs.is_app_limited && rs.delivery_rate < max_bw_)) {
+        return;
+    }
+    bw_hi_[1] = std::max(bw_hi_[1], rs.delivery_rate);
+    max_bw_ = std::max(bw_hi_[0], bw_hi_[1]);
+}
+
+void CcBbr::update_min_rtt(Instant now, Duration rtt) {
+    probe_rtt_expired_ = now > probe_rtt_min_stamp_ + kProbeRttInterval;
+    if (rtt <= probe_rtt_min_delay_ || probe_rtt_expired_) {
+        probe_rtt_min_delay_ = rtt;
+        probe_rtt_min_stamp_ = now;
+    }
+
+    bool min_rtt_expired = now > min_rtt_stamp_ + kMinRttFilterLen;
+    if (probe_rtt_min_delay_ < min_rtt_ || min_rtt_expired) {
+        min_rtt_ = probe_rtt_min_delay_;
+        min_rtt_stamp_ = probe_rtt_min_stamp_;
+    }
+}
+
+void CcBbr::update_lower_bounds() {
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-updating-the-model-upon-pac
+    // A round with losses or CE marks outside of bandwidth probing
+    // lowers the short-term model.
+    if ((round_had_loss_ || round_had_ecn_) &&
+        (state_ == State::ProbeBwDown || state_ == State::ProbeBwCruise)) {
+        if (bw_lo_ == kUnbounded) {
+            bw_lo_ = max_bw_;
+        }
+        if (inflight_lo_ == kUnboundedInflight) {
+            inflight_lo_ = cwnd_;
+        }
+        // the marks lower inflight_lo only, by the share of them
+        size_t ecn_inflight_lo = kUnboundedInflight;
+        if (round_had_ecn_) {
+            ecn_inflight_lo = static_cast<size_t>(
+                inflight_lo_ * (1 - ecn_alpha_ * kEcnFactor));
+        }
+        if (round_had_loss_) {
+            bw_lo_ = std::max(bw_latest_,
+                              static_cast<uint64_t>(bw_lo_ * kBeta));
+            inflight_lo_ = std::max(inflight_latest_,
+                                    static_cast<size_t>(inflight_lo_ * kBeta));
+        }
+        inflight_lo_ = std::min(inflight_lo_, ecn_inflight_lo);
+    }
+    bw_latest_ = 0;
+    inflight_latest_ = 0;
+}
+
+void CcBbr::reset_lower_bounds() {
+    bw_lo_ = kUnbounded;
+    inflight_lo_ = kUnboundedInflight;
+}
+
+void CcBbr::check_startup_done(const RateSample &rs) {
+    if (filled_pipe_ || !round_start_) {
+        return;
+    }
+
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-exiting-startup-based-on-ba
+    if (!rs.is_app_limited) {
+        if (max_bw_ >= full_bw_ * kStartupFullBwThresh) {
+            full_bw_ = max_bw_;
+            full_bw_count_ = 0;
+        } else if (++full_bw_count_ >= kStartupFullBwRounds) {
+            filled_pipe_ = true;
+        }
+    }
+
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-exiting-startup-based-on-pa
+    if (round_high_loss_) {
+        filled_pipe_ = true;
+        inflight_hi_ = std::max(bdp(1.0), inflight_latest_);
+    }
+
+    if (filled_pipe_ && state_ == State::Startup) {
+        set_state(State::Drain, kDrainPacingGain, kDefaultCwndGain);
+    }
+}
+
+void CcBbr::check_drain(Instant now) {
+    if (state_ == State::Drain && bytes_in_flight_ <= bdp(1.0)) {
+        enter_probe_bw_down(now);
+    }
+}
+
+bool CcBbr::is_time_to_probe_bw(Instant now) const {
+    if (now - cycle_stamp_ > bw_probe_wait_) {
+        return true;
+    }
+    // Probe as often as a Reno flow with the same BDP would.
+    uint64_t reno_rounds = std::min<uint64_t>(
+        target_inflight() / kMaxDatagramSize, kMaxRenoRounds);
+    return rounds_since_bw_probe_ >= reno_rounds;
+}
+
+void CcBbr::update_probe_bw_cycle(Instant now, const RateSample &rs) {
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-probebw-algorithm-details
+    if (!filled_pipe_) {
+        return;
+    }
+    probe_inflight_hi_upward(rs);
+
+    switch (state_) {
+        case State::ProbeBwDown:
+            if (is_time_to_probe_bw(now)) {
+                enter_probe_bw_refill();
+            } else if (bytes_in_flight_ <= inflight_with_headroom() &&
+                       bytes_in_flight_ <= bdp(1.0)) {
+                enter_probe_bw_cruise();
+            }
+            break;
+        case State::ProbeBwCruise:
+            if (is_time_to_probe_bw(now)) {
+                enter_probe_bw_refill();
+            }
+            break;
+        case State::ProbeBwRefill:
+            // refill the pipe for a round before probing
+            if (round_start_) {
+                bw_probe_samples_ = true;
+                enter_probe_bw_up(now);
+            }
+            break;
+        case State::ProbeBwUp:
+            if (now - cycle_stamp_ > min_rtt_ &&
+                bytes_in_flight_ > bdp(pacing_gain_)) {
+                enter_probe_bw_down(now);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CcBbr::probe_inflight_hi_upward(const RateSample &rs) {
+    if (state_ != State::ProbeBwUp) {
+        return;
+    }
+    if (round_start_) {
+        // double the growth every round
+        size_t growth = kMaxDatagramSize << bw_probe_up_rounds_;
+        bw_probe_up_rounds_ = std::min<size_t>(bw_probe_up_rounds_ + 1, 30);
+        bw_probe_up_count_ = std::max<size_t>(cwnd_ / growth, 1) * kMaxDatagramSize;
+    }
+    // only grow while the window is actually used
+    if (inflight_hi_ == kUnboundedInflight ||
+        bytes_in_flight_ + rs.newly_acked + kMaxDatagramSize < cwnd_) {
+        return;
+    }
+    bw_probe_up_acks_ += rs.newly_acked;
+    if (bw_probe_up_acks_ >= bw_probe_up_count_) {
+        size_t delta = bw_probe_up_acks_ / bw_probe_up_count_;
+        bw_probe_up_acks_ -= delta * bw_probe_up_count_;
+        inflight_hi_ += delta * kMaxDatagramSize;
+    }
+}
+
+void CcBbr::handle_inflight_too_high(Instant now, bool is_app_limited,
+                                     size_t tx_in_flight) {
+    bw_probe_samples_ = false;
+    if (!is_app_limited) {
+        inflight_hi_ = std::max(tx_in_flight,
+                                static_cast<size_t>(target_inflight() * kBeta));
+    }
+    if (state_ == State::ProbeBwUp) {
+        enter_probe_bw_down(now);
+    }
+}
+
+void CcBbr::enter_probe_bw_down(Instant now) {
+    // a new cycle; forget the bandwidth of the cycle before the last
+    bw_hi_[0] = bw_hi_[1];
+    bw_hi_[1] = 0;
+    max_bw_ = bw_hi_[0];
+
+    bw_probe_samples_ = false;
+    rounds_since_bw_probe_ = 0;
+    bw_probe_wait_ = kProbeBwWaitBase + Duration::from_microseconds(
+        static_cast<int64_t>(random_() % kProbeBwWaitRandomUs));
+    cycle_stamp_ = now;
+    set_state(State::ProbeBwDown, 0.9, kDefaultCwndGain);
+}
+
+void CcBbr::enter_probe_bw_cruise() {
+    set_state(State::ProbeBwCruise, 1.0, kDefaultCwndGain);
+}
+
+void CcBbr::enter_probe_bw_refill() {
+    reset_lower_bounds();
+    bw_probe_up_rounds_ = 0;
+    bw_probe_up_acks_ = 0;
+    set_state(State::ProbeBwRefill, 1.0, kDefaultCwndGain);
+}
+
+void CcBbr::enter_probe_bw_up(Instant now) {
+    cycle_stamp_ = now;
+    bw_probe_up_count_ = kUnboundedInflight;
+    set_state(State::ProbeBwUp, 1.25, 2.25);
+}
+
+void CcBbr::check_probe_rtt(Instant now) {
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-probertt
+    if (state_ != State::ProbeRtt && probe_rtt_expired_) {
+        enter_probe_rtt(now);
+    }
+    if (state_ != State::ProbeRtt) {
+        return;
+    }
+
+    if (probe_rtt_done_stamp_.is_infinite()) {
+        if (bytes_in_flight_ <= std::max(bdp(kProbeRttCwndGain), kMinPipeCwnd)) {
+            // Hold the low inflight for kProbeRttDuration and a round.
+            probe_rtt_done_stamp_ = now + kProbeRttDuration;
+            probe_rtt_round_done_ = false;
+            next_round_delivered_ = delivered_;
+        }
+        return;
+    }
+    if (round_start_) {
+        probe_rtt_round_done_ = true;
+    }
+    if (probe_rtt_round_done_ && now >= probe_rtt_done_stamp_) {
+        probe_rtt_min_stamp_ = now;
+        exit_probe_rtt(now);
+    }
+}
+
+void CcBbr::enter_probe_rtt(Instant now) {
+    prior_cwnd_ = std::max(prior_cwnd_, cwnd_);
+    probe_rtt_done_stamp_ = Instant::infinite();
+    set_state(State::ProbeRtt, 1.0, kDefaultCwndGain);
+}
+
+void CcBbr::exit_probe_rtt(Instant now) {
+    reset_lower_bounds();
+    cwnd_ = std::max(cwnd_, prior_cwnd_);
+    prior_cwnd_ = 0;
+    if (filled_pipe_) {
+        enter_probe_bw_down(now);
+        enter_probe_bw_cruise();
+    } else {
+        set_state(State::Startup, kStartupPacingGain, kDefaultCwndGain);
+    }
+}
+
+void CcBbr::set_state(State state, double pacing_gain, double cwnd_gain) {
+    state_ = state;
+    pacing_gain_ = pacing_gain;
+    cwnd_gain_ = cwnd_gain;
+}
+
+size_t CcBbr::bdp(double gain) const {
+    if (min_rtt_.is_infinite()) {
+        return kInitialWindow;
+    }
+    return static_cast<size_t>(
+        gain * bandwidth() * min_rtt_.to_microseconds() / 1e6);
+}
+
+size_t CcBbr::target_inflight() const {
+    return std::min(bdp(1.0), inflight_hi_);
+}
+
+size_t CcBbr::inflight_with_headroom() const {
+    if (inflight_hi_ == kUnboundedInflight) {
+        return kUnboundedInflight;
+    }
+    size_t headroom = std::max(kMaxDatagramSize,
+                               static_cast<size_t>(kHeadroom * inflight_hi_));
+    return std::max(inflight_hi_ > headroom ? inflight_hi_ - headroom : 0,
+                    kMinPipeCwnd);
+}
+
+void CcBbr::set_pacing_rate(double gain) {
+    if (max_bw_ == 0) {
+        return;
+    }
+    auto rate = static_cast<uint64_t>(gain * bandwidth() * kPacingMargin);
+    // Startup never lowers the initial rate before the pipe is full.
+    if (filled_pipe_ || rate > pacing_rate_) {
+        pacing_rate_ = rate;
+    }
+}
+
+void CcBbr::set_cwnd(const RateSample &rs) {
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-core-cwnd-adjustment-mechan
+    size_t max_inflight = std::max(bdp(cwnd_gain_), 3 * kMaxDatagramSize);
+    if (state_ == State::ProbeBwUp) {
+        max_inflight += 2 * kMaxDatagramSize;
+    }
+
+    if (filled_pipe_) {
+        cwnd_ = std::min(cwnd_ + rs.newly_acked, max_inflight);
+    } else if (cwnd_ < max_inflight || delivered_ < kInitialWindow) {
+        cwnd_ += rs.newly_acked;
+    }
+    cwnd_ = std::max(cwnd_, kMinPipeCwnd);
+
+    // https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control#name-modulating-cwnd-in-probertt
+    if (state_ == State::ProbeRtt) {
+        cwnd_ = std::min(cwnd_, std::max(bdp(kProbeRttCwndGain), kMinPipeCwnd));
+    }
+
+    // bound by the model
+    size_t cap = kUnboundedInflight;
+    if (state_ == State::ProbeBwDown || state_ == State::ProbeBwRefill ||
+        state_ == State::ProbeBwUp) {
+        cap = inflight_hi_;
+    } else if (state_ == State::ProbeBwCruise || state_ == State::ProbeRtt) {
+        cap = inflight_with_headroom();
+    }
+    cap = std::max(std::min(cap, inflight_lo_), kMinPipeCwnd);
+    cwnd_ = std::min(cwnd_, cap);
+}
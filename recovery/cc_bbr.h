@@ -0,0 +1,339 @@
+//
+// Created by Chengke Wong on 2020/5/26.
+//
+
+#ifndef RECOVERY_CC_BBR_H
+#define RECOVERY_CC_BBR_H
+
+#include <random>
+
+#include "common/config.h"
+#include "recovery/cc.h"
+#include "recovery/delivery_rate.h"
+#include "util/instant.h"
+
+// BBR: model-based congestion control
+// https://datatracker.ietf.org/doc/html/draft-cardwell-iccrg-bbr-congestion-control
+//
+// The sender keeps a model of the path: its bottleneck bandwidth (the
+// maximum delivery rate over the last two bandwidth probing cycles) and
+// its round-trip propagation delay (the minimum RTT over 10 seconds). It
+// paces at about the bandwidth and keeps about one BDP in flight:
+//
+//   Startup   pacing gain 2.77 until the bandwidth stops growing by 25%
+//             in three rounds, or the loss rate of a round exceeds 2%
+//   Drain     drain the queue built in Startup
+//   ProbeBW   cycle DOWN (0.9) -> CRUISE (1.0) -> REFILL (1.0) -> UP
+//             (1.25), probing for more bandwidth every 2-3 seconds
+//   ProbeRTT  every 5 seconds, cut the data in flight to half a BDP for
+//             200 ms, so that the minimum RTT can be refreshed
+//
+// Unlike loss-based control, random loss alone does not reduce the
+// sending rate. Losses of more than 2% of the data in flight set
+// inflight_hi, an upper bound on the data in flight that is probed
+// upwards in UP. Losses in a round also lower the short-term bounds
+// bw_lo and inflight_lo by 30%, until the next probing cycle.
+//
+// The packets are sent ECT(1), and CE marks are read as in L4S: a round
+// with more than half of its packets marked acts as a high loss round,
+// ending Startup or setting inflight_hi. Any mark in a round outside of
+// probing lowers inflight_lo by ecn_alpha / 3, where ecn_alpha is a
+// moving average of the fraction of packets marked per round, as in
+// BBRv2. An AQM that marks ECT(1) at a classic threshold makes BBR back
+// off only on the rounds marked more than half.
+//
+// The model is fed with the rate samples of on_rate_sample(), which
+// must come before every on_packet_acked().
+class CcBbr : public CongestionControl {
+
+public:
+
+    CcBbr();
+
+    ~CcBbr() override = default;
+
+    void on_packet_sent(SentPacketPtr &packet) override;
+
+    void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) override;
+
+    void on_packet_acked(Instant now, const RttTime &rtt,
+                         std::vector<SentPacketPtr> &packets) override;
+
+    void on_rate_sample(Instant now, const RateSample &rs) override;
+
+    void on_ecn_counts(Instant now, const EcnCounts &newly,
+                       Instant largest_acked_time_sent) override;
+
+    inline EcnCodepoint ecn_codepoint() const override {
+        return EcnCodepoint::Ect1;
+    }
+
+    inline size_t congestion_window() const override {
+        return cwnd_;
+    }
+
+    inline size_t bytes_in_flight() const override {
+        return bytes_in_flight_;
+    }
+
+    // the pacing gain of the current state times the bottleneck bandwidth
+    inline uint64_t pacing_rate(const RttTime &rtt) const override {
+        return pacing_rate_;
+    }
+
+    inline const char *name() const override {
+        return "bbr";
+    }
+
+    const char *state_name() const override;
+
+    enum class State {
+        Startup,
+        Drain,
+        ProbeBwDown,
+        ProbeBwCruise,
+        ProbeBwRefill,
+        ProbeBwUp,
+        ProbeRtt,
+    };
+
+    inline State state() const {
+        return state_;
+    }
+
+    // the estimated bottleneck bandwidth, in bytes per second
+    inline uint64_t max_bandwidth() const {
+        return max_bw_;
+    }
+
+    inline Duration min_rtt() const {
+        return min_rtt_;
+    }
+
+    inline double ecn_alpha() const {
+        return ecn_alpha_;
+    }
+
+private:
+
+    static constexpr size_t kInitialWindow = 10 * kMaxDatagramSize;
+
+    static constexpr size_t kMinPipeCwnd = 4 * kMaxDatagramSize;
+
+    static constexpr double kStartupPacingGain = 2.77;
+
+    static constexpr double kDrainPacingGain = 0.35;
+
+    static constexpr double kDefaultCwndGain = 2.0;
+
+    // leave a margin below the estimated bandwidth
+    static constexpr double kPacingMargin = 0.99;
+
+    static constexpr double kLossThresh = 0.02;
+
+    static constexpr double kBeta = 0.7;
+
+    static constexpr double kHeadroom = 0.15;
+
+    static constexpr double kStartupFullBwThresh = 1.25;
+
+    static constexpr size_t kStartupFullBwRounds = 3;
+
+    static constexpr double kProbeRttCwndGain = 0.5;
+
+    // a round with fewer lost packets does not end Startup
+    static constexpr size_t kStartupFullLossCount = 6;
+
+    // the fraction of CE marked packets of a round above which the data
+    // in flight is too high
+    static constexpr double kEcnThresh = 0.5;
+
+    // of the moving average of the fraction of CE marked packets
+    static constexpr double kEcnAlphaGain = 1.0 / 16;
+
+    // inflight_lo is lowered by ecn_alpha times this on a marked round
+    static constexpr double kEcnFactor = 1.0 / 3;
+
+    // rounds in a row marked above kEcnThresh end Startup
+    static constexpr size_t kStartupFullEcnRounds = 2;
+
+    void update_round(const RateSample &rs);
+
+    void update_ecn(Instant now, const RateSample &rs);
+
+    void update_max_bandwidth(const RateSample &rs, bool valid);
+
+    void update_min_rtt(Instant now, Duration rtt);
+
+    void update_lower_bounds();
+
+    void check_startup_done(const RateSample &rs);
+
+    void check_drain(Instant now);
+
+    void update_probe_bw_cycle(Instant now, const RateSample &rs);
+
+    void probe_inflight_hi_upward(const RateSample &rs);
+
+    void check_probe_rtt(Instant now);
+
+    // with the delivery state of the packet lost, or of the round marked
+    void handle_inflight_too_high(Instant now, bool is_app_limited,
+                                  size_t tx_in_flight);
+
+    void reset_lower_bounds();
+
+    void enter_probe_bw_down(Instant now);
+
+    void enter_probe_bw_cruise();
+
+    void enter_probe_bw_refill();
+
+    void enter_probe_bw_up(Instant now);
+
+    void enter_probe_rtt(Instant now);
+
+    void exit_probe_rtt(Instant now);
+
+    bool is_time_to_probe_bw(Instant now) const;
+
+    void set_state(State state, double pacing_gain, double cwnd_gain);
+
+    void set_pacing_rate(double gain);
+
+    void set_cwnd(const RateSample &rs);
+
+    // the bandwidth the model uses: max_bw_ bounded by bw_lo_
+    inline uint64_t bandwidth() const {
+        return std::min(max_bw_, bw_lo_);
+    }
+
+    // |gain| BDPs, in bytes
+    size_t bdp(double gain) const;
+
+    // the data in flight to aim at in ProbeBW: a BDP, at most inflight_hi
+    // with some headroom left for other flows
+    size_t target_inflight() const;
+
+    size_t inflight_with_headroom() const;
+
+    State state_;
+
+    double pacing_gain_;
+
+    double cwnd_gain_;
+
+    size_t cwnd_;
+
+    size_t bytes_in_flight_;
+
+    uint64_t pacing_rate_;
+
+    // the sample of the ACK being processed
+    RateSample rate_sample_;
+
+    // the bytes acknowledged and declared lost, counted as the sampler
+    // counts them
+    uint64_t delivered_;
+
+    uint64_t lost_;
+
+    // the maxima of the delivery rate in the previous and the current
+    // ProbeBW cycle
+    uint64_t bw_hi_[2];
+
+    uint64_t max_bw_;
+
+    uint64_t bw_lo_;
+
+    // the maximum delivery rate of the current round
+    uint64_t bw_latest_;
+
+    size_t inflight_hi_;
+
+    size_t inflight_lo_;
+
+    // the maximum bytes delivered in an interval of the current round
+    size_t inflight_latest_;
+
+    Duration min_rtt_;
+
+    Instant min_rtt_stamp_;
+
+    // the minimum RTT over the last kProbeRttInterval
+    Duration probe_rtt_min_delay_;
+
+    Instant probe_rtt_min_stamp_;
+
+    bool probe_rtt_expired_;
+
+    Instant probe_rtt_done_stamp_;
+
+    bool probe_rtt_round_done_;
+
+    // Startup has found the bottleneck bandwidth
+    bool filled_pipe_;
+
+    uint64_t full_bw_;
+
+    size_t full_bw_count_;
+
+    // Round trips are counted in delivered bytes: a round ends when the
+    // data sent at its start is acknowledged.
+    uint64_t round_count_;
+
+    uint64_t next_round_delivered_;
+
+    bool round_start_;
+
+    // the lost and delivered counts when the round started
+    uint64_t round_lost_start_;
+
+    uint64_t round_delivered_start_;
+
+    size_t loss_events_in_round_;
+
+    // whether the round that just ended lost any packet, or lost more
+    // than kLossThresh of its data
+    bool round_had_loss_;
+
+    bool round_high_loss_;
+
+    // the ECN counts of the current round, in packets
+    uint64_t round_ect_packets_;
+
+    uint64_t round_ce_packets_;
+
+    // whether the round that just ended had any CE mark
+    bool round_had_ecn_;
+
+    double ecn_alpha_;
+
+    // the rounds in a row marked above kEcnThresh in Startup
+    size_t startup_ecn_rounds_;
+
+    // ProbeBW
+    Instant cycle_stamp_;
+
+    Duration bw_probe_wait_;
+
+    uint64_t rounds_since_bw_probe_;
+
+    size_t bw_probe_up_rounds_;
+
+    size_t bw_probe_up_acks_;
+
+    size_t bw_probe_up_count_;
+
+    // losses are checked against inflight_hi only for packets sent while
+    // probing for bandwidth
+    bool bw_probe_samples_;
+
+    // the window before ProbeRTT, restored after it
+    size_t prior_cwnd_;
+
+    std::minstd_rand random_;
+
+};
+
+#endif //RECOVERY_CC_BBR_H
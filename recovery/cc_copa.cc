@@ -0,0 +1,196 @@
+//
+// Created by Chengke Wong on 2020/5/28.
+//
+
+#include "recovery/cc_copa.h"
+
+#include <algorithm>
+
+constexpr double CcCopa::kDefaultDelta;
+
+CcCopa::CcCopa(Duration target_queueing_delay)
+    : target_queueing_delay_(target_queueing_delay),
+      cwnd_(kInitialWindow),
+      bytes_in_flight_(0),
+      cwnd_limited_(true),
+      pacing_rate_(0),
+      slow_start_(true),
+      competitive_(false),
+      delta_(kDefaultDelta),
+      velocity_(1),
+      direction_(0),
+      same_direction_rounds_(0),
+      round_start_(Instant::infinite()),
+      round_start_cwnd_(kInitialWindow),
+      round_had_loss_(false),
+      max_rtts_{Duration::zero(), Duration::zero(),
+                Duration::zero(), Duration::zero()},
+      max_rtt_index_(0),
+      last_queue_empty_(Instant::infinite())
+{}
+
+const char *CcCopa::state_name() const {
+    if (!cwnd_limited_) {
+        return "application_limited";
+    }
+    if (slow_start_) {
+        return "slow_start";
+    }
+    return competitive_ ? "competitive" : "default";
+}
+
+void CcCopa::on_packet_sent(SentPacketPtr &packet) {
+    bytes_in_flight_ += packet->sent_bytes;
+}
+
+void CcCopa::on_packet_acked(Instant now, const RttTime &rtt,
+                             std::vector<SentPacketPtr> &packets) {
+    size_t acked_bytes = 0;
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        acked_bytes += packet->sent_bytes;
+    }
+
+    Duration standing_rtt = rtt.standing_rtt();
+    if (standing_rtt.is_infinite()) {
+        return;
+    }
+    Duration queueing_delay = standing_rtt - rtt.min_rtt();
+
+    if (round_start_.is_infinite()) {
+        round_start_ = now;
+        last_queue_empty_ = now;
+    } else if (now - round_start_ >= rtt.smoothed_rtt()) {
+        on_round_end(now);
+    }
+    max_rtts_[max_rtt_index_] = std::max(max_rtts_[max_rtt_index_],
+                                         standing_rtt);
+    update_mode(now, queueing_delay, rtt);
+
+    // the current rate cwnd / standing_rtt is at most the target rate
+    // 1 / (delta * dq), in datagrams, with dq counted above the target
+    // queueing delay
+    double cwnd_packets = cwnd_ / kMaxDatagramSize;
+    Duration excess_delay = queueing_delay - target_queueing_delay_;
+    bool increase = excess_delay <= Duration::zero() ||
+        cwnd_packets * delta_ * excess_delay.to_microseconds()
+            <= standing_rtt.to_microseconds();
+
+    // A fast window must not keep moving once the target is crossed.
+    int direction = increase ? 1 : -1;
+    if (velocity_ > 1 && direction != direction_) {
+        change_direction(direction);
+    }
+
+    // The window does not grow while it is not in use.
+    if (slow_start_) {
+        if (increase) {
+            if (cwnd_limited_) {
+                cwnd_ += acked_bytes;
+            }
+        } else {
+            // Slow start overshoots by up to a window in the last RTT;
+            // jump back to the window of the target rate.
+            slow_start_ = false;
+            double target_window = kMaxDatagramSize
+                * standing_rtt.to_microseconds()
+                / (delta_ * excess_delay.to_microseconds());
+            cwnd_ = std::max(std::min(cwnd_, target_window),
+                             static_cast<double>(kMinimumWindow));
+        }
+    }
+    if (!slow_start_) {
+        double change = velocity_ * kMaxDatagramSize * acked_bytes
+            / (delta_ * cwnd_);
+        if (increase) {
+            if (cwnd_limited_) {
+                cwnd_ += change;
+            }
+        } else {
+            cwnd_ = std::max(cwnd_ - change,
+                             static_cast<double>(kMinimumWindow));
+        }
+    }
+
+    pacing_rate_ = static_cast<uint64_t>(
+        2 * cwnd_ * 1000000 / standing_rtt.to_microseconds());
+}
+
+void CcCopa::on_rate_sample(Instant now, const RateSample &rs) {
+    // RFC 7661, with tx_in_flight as pipeACK
+    cwnd_limited_ = rs.tx_in_flight * 2 >= cwnd_;
+}
+
+void CcCopa::on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) {
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+    }
+
+    // at most one multiplicative decrease of 1 / delta per RTT
+    if (competitive_ && !round_had_loss_) {
+        delta_ = std::min(delta_ * 2, kDefaultDelta);
+    }
+    round_had_loss_ = true;
+}
+
+void CcCopa::on_round_end(Instant now) {
+    int direction = cwnd_ > round_start_cwnd_ ? 1 : -1;
+    if (!cwnd_limited_) {
+        // A window not in use holds still; it has no direction.
+        change_direction(0);
+    } else if (direction == direction_) {
+        same_direction_rounds_ += 1;
+        if (same_direction_rounds_ >= kVelocityRounds) {
+            velocity_ *= 2;
+        }
+    } else {
+        change_direction(direction);
+    }
+    // An RTT moves the window by about velocity / delta datagrams; keep
+    // that below an eighth of the window.
+    velocity_ = std::max(1.0, std::min(
+        velocity_, delta_ * cwnd_ / kMaxDatagramSize / 8));
+
+    if (competitive_ && !round_had_loss_) {
+        delta_ = 1 / (1 / delta_ + 1);
+    }
+    round_had_loss_ = false;
+
+    max_rtt_index_ = (max_rtt_index_ + 1) % kMaxRttRounds;
+    max_rtts_[max_rtt_index_] = Duration::zero();
+
+    round_start_ = now;
+    round_start_cwnd_ = cwnd_;
+}
+
+void CcCopa::change_direction(int direction) {
+    direction_ = direction;
+    same_direction_rounds_ = 1;
+    velocity_ = 1;
+    round_start_cwnd_ = cwnd_;
+}
+
+void CcCopa::update_mode(Instant now, Duration queueing_delay,
+                         const RttTime &rtt) {
+    Duration max_rtt = *std::max_element(max_rtts_,
+                                         max_rtts_ + kMaxRttRounds);
+    Duration swing = max_rtt - rtt.min_rtt();
+
+    // The queue is nearly empty if the queueing delay above the target
+    // is within 10% of its recent maximum.
+    if (queueing_delay <= target_queueing_delay_ ||
+        (queueing_delay - target_queueing_delay_) * 10
+            <= swing - target_queueing_delay_) {
+        last_queue_empty_ = now;
+    }
+
+    bool competitive = now - last_queue_empty_
+        > rtt.smoothed_rtt() * kCompetitiveRounds;
+    if (competitive == competitive_) {
+        return;
+    }
+    competitive_ = competitive;
+    if (!competitive_) {
+        delta_ = kDefaultDelta;
+    }
+}
@@ -0,0 +1,153 @@
+//
+// Created by Chengke Wong on 2020/5/28.
+//
+
+#ifndef RECOVERY_CC_COPA_H
+#define RECOVERY_CC_COPA_H
+
+#include "common/config.h"
+#include "recovery/cc.h"
+#include "util/instant.h"
+
+// Copa: delay-based congestion control
+// https://www.usenix.org/conference/nsdi18/presentation/arun
+//
+// The queueing delay is estimated as dq = standing RTT - min RTT, both
+// from RttTime. The sender aims at the rate 1 / (delta * dq) datagrams
+// per second, which keeps about 1 / delta datagrams of each flow in the
+// bottleneck queue, and moves its window towards that rate by
+// velocity / (delta * cwnd) datagrams per datagram acknowledged. The
+// velocity doubles every RTT once the window has moved in the same
+// direction for three RTTs, and falls back to 1 as soon as the window
+// turns. Slow start doubles the window every RTT until the target rate
+// is exceeded, then drops to the window of the target rate. Neither
+// grows the window while less than half of it is in flight, and the
+// velocity falls back to 1 while the sender is app-limited.
+//
+// dq is counted above the target queueing delay given to the
+// constructor, so that each flow keeps the target plus its 1 / delta
+// datagrams queued. A target of zero is plain Copa; a larger one trades
+// latency for throughput, e.g. on paths with noisy RTTs.
+//
+// Losses are ignored in the default mode. Flows of loss-based
+// controllers fill the buffer, so a Copa flow sharing the bottleneck
+// with them never sees the queue drain. When the queue has not been
+// nearly empty for five RTTs, Copa switches to competitive mode: 1 / delta
+// grows by one every RTT without loss and halves on loss, i.e. AIMD on
+// the number of queued datagrams, until the queue drains again.
+class CcCopa : public CongestionControl {
+
+public:
+
+    explicit CcCopa(Duration target_queueing_delay = Duration::zero());
+
+    ~CcCopa() override = default;
+
+    void on_packet_sent(SentPacketPtr &packet) override;
+
+    void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) override;
+
+    void on_packet_acked(Instant now, const RttTime &rtt,
+                         std::vector<SentPacketPtr> &packets) override;
+
+    // congestion window validation, as in CcReno
+    void on_rate_sample(Instant now, const RateSample &rs) override;
+
+    inline size_t congestion_window() const override {
+        return static_cast<size_t>(cwnd_);
+    }
+
+    inline size_t bytes_in_flight() const override {
+        return bytes_in_flight_;
+    }
+
+    // in bytes per second: twice the window per standing RTT, so that
+    // the window rather than the pacer limits the sending rate
+    inline uint64_t pacing_rate(const RttTime &rtt) const override {
+        return pacing_rate_;
+    }
+
+    inline bool competitive_mode() const {
+        return competitive_;
+    }
+
+    inline double delta() const {
+        return delta_;
+    }
+
+    inline const char *name() const override {
+        return "copa";
+    }
+
+    const char *state_name() const override;
+
+private:
+
+    static constexpr size_t kMinimumWindow = kMaxDatagramSize * 2;
+
+    static constexpr size_t kInitialWindow = kMaxDatagramSize * 10;
+
+    static constexpr double kDefaultDelta = 0.5;
+
+    // the RTTs in the same direction before the velocity starts doubling
+    static constexpr size_t kVelocityRounds = 3;
+
+    // the RTTs the queue must stay non-empty before competitive mode
+    static constexpr int kCompetitiveRounds = 5;
+
+    // the RTTs over which the maximum standing RTT is taken
+    static constexpr size_t kMaxRttRounds = 4;
+
+    // called once per RTT
+    void on_round_end(Instant now);
+
+    void change_direction(int direction);
+
+    void update_mode(Instant now, Duration queueing_delay,
+                     const RttTime &rtt);
+
+    Duration target_queueing_delay_;
+
+    // in bytes, fractional so that small increments add up
+    double cwnd_;
+
+    size_t bytes_in_flight_;
+
+    // whether the window is in use; see on_rate_sample()
+    bool cwnd_limited_;
+
+    uint64_t pacing_rate_;
+
+    bool slow_start_;
+
+    bool competitive_;
+
+    double delta_;
+
+    double velocity_;
+
+    // +1 if the window grew in the last RTT, -1 if it shrank, 0 if it
+    // was not in use
+    int direction_;
+
+    size_t same_direction_rounds_;
+
+    Instant round_start_;
+
+    double round_start_cwnd_;
+
+    // whether a packet has been lost in the current RTT
+    bool round_had_loss_;
+
+    // the maximum standing RTT of the current and the previous
+    // kMaxRttRounds - 1 RTTs
+    Duration max_rtts_[kMaxRttRounds];
+
+    size_t max_rtt_index_;
+
+    // the last time the queueing delay was close to its minimum
+    Instant last_queue_empty_;
+
+};
+
+#endif //RECOVERY_CC_COPA_H
@@ -4,25 +4,45 @@
 
 #include "recovery/cc_cubic.h"
 
+#include <cmath>
+
+constexpr size_t CcCubic::kMinimumWindow;
+
 CcCubic::CcCubic()
         : cc_window_(kInitialWindow),
+          ssthresh_(std::numeric_limits<size_t>::max()),
           bytes_in_flight_(0),
+          cwnd_limited_(true),
+          hystart_(),
           congestion_recovery_start_time_(Instant::zero()),
-          ssthresh_(std::numeric_limits<size_t>::max()) {
+          w_max_(0),
+          k_(0),
+          epoch_start_(Instant::infinite()),
+          w_est_(0),
+          cubic_bytes_per_datagram_(0),
+          cubic_acked_bytes_(0),
+          reno_bytes_per_datagram_(0),
+          reno_acked_bytes_(0),
+          next_growth_update_(Instant::zero()) {
 
 }
 
-void CcCubic::print(std::ostream &os) {
-    os << "cubic "
-       << bytes_in_flight_ << "/" << cc_window_
-       << " ssthresh " << ssthresh_;
+const char *CcCubic::state_name() const {
+    if (!cwnd_limited_) {
+        return "application_limited";
+    }
+    return cc_window_ < ssthresh_ ? "slow_start" : "congestion_avoidance";
 }
 
-void CcCubic::on_packet_sent(unique_ptr<SentPacket> &packet) {
+void CcCubic::on_packet_sent(SentPacketPtr &packet) {
     bytes_in_flight_ += packet->sent_bytes;
 }
 
-void CcCubic::on_packet_acked(std::vector<unique_ptr<SentPacket>> &packets) {
+void CcCubic::on_packet_acked(Instant now, const RttTime &rtt,
+                              std::vector<SentPacketPtr> &packets) {
+    size_t slow_start_bytes = 0;
+    Instant slow_start_largest_sent = Instant::zero();
+
     for (auto &packet : packets) {
         bytes_in_flight_ -= packet->sent_bytes;
 
@@ -31,24 +51,106 @@ void CcCubic::on_packet_acked(std::vector<unique_ptr<SentPacket>> &packets) {
             continue;
         }
 
-// TODO:
-        // if (IsAppOrFlowControlLimited()):
-        //          // Do not increase congestion_window if application
-        //          // limited or flow control limited.
-        //          continue
+        if (!cwnd_limited_) {
+            // Do not increase congestion window if application
+            // limited or flow control limited. The time spent so does
+            // not count towards the cubic curve either; the epoch
+            // restarts when the window is in use again.
+            epoch_start_ = Instant::infinite();
+            continue;
+        }
 
         if (cc_window_ < ssthresh_) {
-            // Slow start.
-            cc_window_ += packet->sent_bytes;
-        } else {
-            // Congestion avoidance.
-            // TODO: division operation may be slow
-            cc_window_ += (kMaxDatagramSize * packet->sent_bytes) / cc_window_;
+            // Slow start; the window grows after the loop.
+            slow_start_bytes += packet->sent_bytes;
+            slow_start_largest_sent = packet->time_sent;
+            continue;
+        }
+
+        // Congestion avoidance.
+        if (epoch_start_.is_infinite()) {
+            start_epoch(now);
+        }
+        if (now >= next_growth_update_) {
+            update_growth(now, rtt.smoothed_rtt());
+        }
+
+        // https://www.rfc-editor.org/rfc/rfc9438.html#name-reno-friendly-region
+        reno_acked_bytes_ += packet->sent_bytes;
+        if (reno_acked_bytes_ >= reno_bytes_per_datagram_) {
+            reno_acked_bytes_ -= reno_bytes_per_datagram_;
+            w_est_ += kMaxDatagramSize;
+        }
+
+        // https://www.rfc-editor.org/rfc/rfc9438.html#name-concave-region
+        // https://www.rfc-editor.org/rfc/rfc9438.html#name-convex-region
+        cubic_acked_bytes_ += packet->sent_bytes;
+        if (cubic_acked_bytes_ >= cubic_bytes_per_datagram_) {
+            cubic_acked_bytes_ -= cubic_bytes_per_datagram_;
+            cc_window_ += kMaxDatagramSize;
+            // the growth rate depends on the window
+            next_growth_update_ = now;
+        }
+
+        if (w_est_ > cc_window_) {
+            cc_window_ = w_est_;
+            next_growth_update_ = now;
+        }
+    }
+
+    if (slow_start_bytes > 0) {
+        hystart_.on_ack(now, slow_start_largest_sent, rtt.latest_rtt());
+        cc_window_ += hystart_.window_increase(slow_start_bytes);
+        if (hystart_.should_exit_slow_start()) {
+            ssthresh_ = cc_window_;
         }
     }
 }
 
-void CcCubic::on_packet_lost(Instant now, std::vector<unique_ptr<SentPacket>> &packets) {
+void CcCubic::start_epoch(Instant now) {
+    epoch_start_ = now;
+    if (w_max_ < cc_window_) {
+        // Congestion avoidance was entered without a congestion event, or
+        // the window has been raised above W_max in the meantime.
+        w_max_ = cc_window_;
+    }
+    // K = cubic_root((W_max - cwnd_epoch) / C)
+    k_ = std::cbrt(static_cast<double>(w_max_ - cc_window_)
+                   / kMaxDatagramSize / kC);
+    w_est_ = cc_window_;
+    cubic_acked_bytes_ = 0;
+    reno_acked_bytes_ = 0;
+    next_growth_update_ = now;
+}
+
+void CcCubic::update_growth(Instant now, Duration rtt) {
+    // https://www.rfc-editor.org/rfc/rfc9438.html#name-window-increase-function
+    // The target is the window one RTT ahead, but at most 1.5 times the
+    // current window.
+    double t = static_cast<double>((now - epoch_start_ + rtt).to_microseconds())
+        / 1e6 - k_;
+    double target = kC * t * t * t * kMaxDatagramSize + w_max_;
+    double window = static_cast<double>(cc_window_);
+    target = std::min(target, window * 1.5);
+
+    if (target > window) {
+        // cwnd += (target - cwnd) / cwnd per datagram acknowledged
+        cubic_bytes_per_datagram_ = static_cast<size_t>(
+            window * kMaxDatagramSize / (target - window));
+    } else {
+        // grow very slowly around W_max
+        cubic_bytes_per_datagram_ = cc_window_ * 100;
+    }
+
+    // W_est += alpha * acked / cwnd; alpha becomes 1 once W_est has
+    // passed W_max
+    double alpha = w_est_ >= w_max_ ? 1.0 : kRenoAlpha;
+    reno_bytes_per_datagram_ = static_cast<size_t>(window / alpha);
+
+    next_growth_update_ = now + (rtt >> 4);
+}
+
+void CcCubic::on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) {
     DCHECK(!packets.empty());
 
     Instant lastest = packets.front()->time_sent;
@@ -66,27 +168,52 @@ void CcCubic::on_packet_lost(Instant now, std::vector<unique_ptr<SentPacket>> &p
     //       congestion_window = kMinimumWindow
 }
 
+void CcCubic::on_ecn_counts(Instant now, const EcnCounts &newly,
+                          Instant largest_acked_time_sent) {
+    // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-on-receiving-an-acknowledgm
+    // ProcessECN: the packets stay acknowledged, only the window shrinks.
+    if (newly.ce > 0) {
+        on_congestion_event(now, largest_acked_time_sent);
+    }
+}
+
+void CcCubic::on_rate_sample(Instant now, const RateSample &rs) {
+    // pipeACK is the data in flight when the newest packet acknowledged
+    // was sent
+    cwnd_limited_ = rs.tx_in_flight * 2 >= cc_window_;
+}
+
 bool CcCubic::in_congestion_recovery(Instant sent_time) {
     return sent_time <= congestion_recovery_start_time_;
 }
 
 void CcCubic::on_congestion_event(Instant now, Instant sent_time) {
-    if (not in_congestion_recovery(sent_time)) {
+    // No reaction if already in a recovery period.
+    if (in_congestion_recovery(sent_time)) {
         return;
     }
 
     congestion_recovery_start_time_ = now;
 
-    // congestion_window *= kLossReductionFactor
-    // congestion_window = max(congestion_window, kMinimumWindow)
-    // Here, we let kLossReductionFactor = 0.5
-    cc_window_ = std::max(cc_window_ >> 1, kMinimumWindow);
+    // https://www.rfc-editor.org/rfc/rfc9438.html#name-fast-convergence
+    // A window below the previous W_max means that a new flow is
+    // competing for the bandwidth; release some of it.
+    if (cc_window_ < w_max_) {
+        w_max_ = static_cast<size_t>(cc_window_ * (1 + kBeta) / 2);
+    } else {
+        w_max_ = cc_window_;
+    }
 
+    // https://www.rfc-editor.org/rfc/rfc9438.html#name-multiplicative-decrease
+    cc_window_ = std::max(static_cast<size_t>(cc_window_ * kBeta),
+                          kMinimumWindow);
     ssthresh_ = cc_window_;
+    hystart_.reset();
+
+    // the epoch starts with the first ACK after recovery
+    epoch_start_ = Instant::infinite();
 
     // TODO:
     // A packet can be sent to speed up loss recovery.
     // MaybeSendOnePacket()
 }
-
-
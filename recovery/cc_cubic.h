@@ -7,8 +7,25 @@
 
 #include "common/config.h"
 #include "recovery/cc.h"
+#include "recovery/hystart.h"
 #include "util/instant.h"
 
+// CUBIC for Fast and Long-Distance Networks
+// https://www.rfc-editor.org/rfc/rfc9438.html
+//
+// Slow start is left with HyStart++. Recovery periods and the minimum
+// window are the same as in CcReno. In congestion avoidance, the window follows
+//
+//     W_cubic(t) = C * (t - K)^3 + W_max
+//
+// where t is the time since the epoch started, i.e. since the first ACK
+// after the last congestion event, and W_max is the window just before
+// that event. It is never below the window a Reno sender would have
+// reached in the same time (the Reno-friendly region).
+//
+// The growth rates are recomputed only when the window has grown by a
+// datagram or 1/16 RTT has passed; in between, an ACK costs an addition
+// and a comparison.
 class CcCubic : public CongestionControl {
 
 public:
@@ -17,13 +34,41 @@ public:
 
 	~CcCubic() override = default;
 
-    void on_packet_sent(unique_ptr<SentPacket> &packet) override;
+    void on_packet_sent(SentPacketPtr &packet) override;
+
+    void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) override;
+
+    void on_packet_acked(Instant now, const RttTime &rtt,
+                         std::vector<SentPacketPtr> &packets) override;
 
-    void on_packet_lost(Instant now, std::vector<unique_ptr<SentPacket>> &packets) override;
+    // An increase in the CE count is a congestion event, as a loss would
+    // be, for the largest packet acknowledged.
+    void on_ecn_counts(Instant now, const EcnCounts &newly,
+                       Instant largest_acked_time_sent) override;
 
-    void on_packet_acked(std::vector<unique_ptr<SentPacket>> &packets) override;
+    inline EcnCodepoint ecn_codepoint() const override {
+        return EcnCodepoint::Ect0;
+    }
 
-    void print(std::ostream& os) override;
+    // https://www.rfc-editor.org/rfc/rfc7661.html
+    // Congestion window validation: the window only grows on the ACKs of
+    // packets sent while at least half of it was in flight, so that it
+    // does not inflate while the sender is app- or flow-control-limited.
+    void on_rate_sample(Instant now, const RateSample &rs) override;
+
+    inline size_t congestion_window() const override {
+        return cc_window_;
+    }
+
+    inline size_t bytes_in_flight() const override {
+        return bytes_in_flight_;
+    }
+
+    inline const char *name() const override {
+        return "cubic";
+    }
+
+    const char *state_name() const override;
 
 private:
 
@@ -34,12 +79,25 @@ private:
 	static constexpr size_t kInitialWindow = const_min(kInitialCwndPackets * kMaxDatagramSize,
                                                        const_max(14720ul, kMaxDatagramSize * 2));
 
-	static constexpr size_t kPersistentCongestionThreshold = 3;
+	// the multiplicative decrease factor
+	static constexpr double kBeta = 0.7;
+
+	// in datagrams per second^3
+	static constexpr double kC = 0.4;
+
+	// the additive increase of the Reno-friendly region, in datagrams per
+	// RTT: 3 * (1 - beta) / (1 + beta)
+	static constexpr double kRenoAlpha = 3 * (1 - kBeta) / (1 + kBeta);
 
 	void on_congestion_event(Instant now, Instant sent_time);
 
 	bool in_congestion_recovery(Instant sent_time);
 
+	void start_epoch(Instant now);
+
+	// recompute the bytes to be acknowledged per datagram of growth
+	void update_growth(Instant now, Duration rtt);
+
 	// Congestion window size in bytes.
 	size_t cc_window_;
 
@@ -49,11 +107,40 @@ private:
 
 	size_t bytes_in_flight_;
 
+	// whether the window is in use; see on_rate_sample()
+	bool cwnd_limited_;
+
+	HyStart hystart_;
+
 	// The time when QUIC first detects congestion due to loss or ECN, causing it to 
 	// enter congestion recovery. When a packet sent after this time is acknowledged, 
 	// QUIC exits congestion recovery.
 	Instant congestion_recovery_start_time_;
 
+	// W_max in bytes: the window just before the last reduction, or lower
+	// if fast convergence released some bandwidth
+	size_t w_max_;
+
+	// the time it takes to grow back to W_max, in seconds
+	double k_;
+
+	// the start of the current congestion avoidance epoch, or infinite if
+	// not in congestion avoidance
+	Instant epoch_start_;
+
+	// W_est in bytes: the window of a Reno sender in the same epoch
+	size_t w_est_;
+
+	// the bytes to be acknowledged for the window to grow by a datagram
+	size_t cubic_bytes_per_datagram_;
+	size_t cubic_acked_bytes_;
+
+	// the same for W_est
+	size_t reno_bytes_per_datagram_;
+	size_t reno_acked_bytes_;
+
+	Instant next_growth_update_;
+
 };
 
 #endif //RECOVERY_CC_CUBIC_H
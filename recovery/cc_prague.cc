@@ -0,0 +1,142 @@
+//
+// Created by Chengke Wong on 2020/5/29.
+//
+
+#include "recovery/cc_prague.h"
+
+#include <algorithm>
+#include <limits>
+
+constexpr size_t CcPrague::kMinimumWindow;
+constexpr Duration CcPrague::kClassicQueueingDelay;
+
+CcPrague::CcPrague()
+    : cc_window_(kInitialWindow),
+      ssthresh_(std::numeric_limits<size_t>::max()),
+      bytes_in_flight_(0),
+      cwnd_limited_(true),
+      pacing_rate_(0),
+      bytes_acked_(0),
+      congestion_recovery_start_time_(Instant::zero()),
+      alpha_(0.0),
+      round_start_(Instant::zero()),
+      round_ect_packets_(0),
+      round_ce_packets_(0),
+      queueing_delay_(Duration::zero()),
+      classic_score_(0)
+{}
+
+const char *CcPrague::state_name() const {
+    if (!cwnd_limited_) {
+        return "application_limited";
+    }
+    if (cc_window_ < ssthresh_) {
+        return "slow_start";
+    }
+    return classic_fallback() ? "classic_fallback" : "congestion_avoidance";
+}
+
+void CcPrague::on_packet_sent(SentPacketPtr &packet) {
+    bytes_in_flight_ += packet->sent_bytes;
+}
+
+void CcPrague::on_packet_acked(Instant now, const RttTime &rtt,
+                               std::vector<SentPacketPtr> &packets) {
+    queueing_delay_ = rtt.smoothed_rtt() - rtt.min_rtt();
+
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+
+        if (in_congestion_recovery(packet->time_sent)) {
+            continue;
+        }
+
+        if (!cwnd_limited_) {
+            // Do not increase congestion window if application
+            // limited or flow control limited.
+            continue;
+        }
+
+        if (cc_window_ < ssthresh_) {
+            cc_window_ += packet->sent_bytes;
+        } else {
+            bytes_acked_ += packet->sent_bytes;
+            if (bytes_acked_ >= cc_window_) {
+                bytes_acked_ -= cc_window_;
+                cc_window_ += kMaxDatagramSize;
+            }
+        }
+    }
+
+    double gain = cc_window_ < ssthresh_ ? 2 : 1.2;
+    pacing_rate_ = static_cast<uint64_t>(
+        gain * cc_window_ * 1000000 / rtt.smoothed_rtt().to_microseconds());
+}
+
+void CcPrague::on_ecn_counts(Instant now, const EcnCounts &newly,
+                             Instant largest_acked_time_sent) {
+    if (largest_acked_time_sent >= round_start_) {
+        on_round_end();
+        round_start_ = now;
+    }
+
+    round_ect_packets_ += newly.ect0 + newly.ect1 + newly.ce;
+    round_ce_packets_ += newly.ce;
+
+    if (newly.ce == 0 || in_congestion_recovery(largest_acked_time_sent)) {
+        return;
+    }
+    // Slow start overshoots by up to a window, far more than alpha tells.
+    bool slow_start = cc_window_ < ssthresh_;
+    reduce_window(now, slow_start || classic_fallback()
+                       ? 0.5 : 1 - alpha_ / 2);
+}
+
+void CcPrague::on_rate_sample(Instant now, const RateSample &rs) {
+    // RFC 7661, with tx_in_flight as pipeACK
+    cwnd_limited_ = rs.tx_in_flight * 2 >= cc_window_;
+}
+
+void CcPrague::on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) {
+    DCHECK(!packets.empty());
+
+    Instant lastest = packets.front()->time_sent;
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        lastest = std::max(lastest, packet->time_sent);
+    }
+
+    if (!in_congestion_recovery(lastest)) {
+        reduce_window(now, 0.5);
+    }
+}
+
+void CcPrague::on_round_end() {
+    if (round_ect_packets_ > 0) {
+        double fraction = static_cast<double>(round_ce_packets_)
+            / round_ect_packets_;
+        alpha_ += kAlphaGain * (std::min(fraction, 1.0) - alpha_);
+    }
+
+    if (round_ce_packets_ > 0) {
+        if (queueing_delay_ > kClassicQueueingDelay) {
+            classic_score_ = std::min(classic_score_ + 1, 2 * kClassicRounds);
+        } else {
+            classic_score_ = std::max(classic_score_ - 1, 0);
+        }
+    }
+
+    round_ect_packets_ = 0;
+    round_ce_packets_ = 0;
+}
+
+void CcPrague::reduce_window(Instant now, double factor) {
+    congestion_recovery_start_time_ = now;
+    cc_window_ = std::max(static_cast<size_t>(cc_window_ * factor),
+                          kMinimumWindow);
+    ssthresh_ = cc_window_;
+}
+
+bool CcPrague::in_congestion_recovery(Instant sent_time) const {
+    return sent_time <= congestion_recovery_start_time_;
+}
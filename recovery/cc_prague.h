@@ -0,0 +1,153 @@
+//
+// Created by Chengke Wong on 2020/5/29.
+//
+
+#ifndef RECOVERY_CC_PRAGUE_H
+#define RECOVERY_CC_PRAGUE_H
+
+#include "common/config.h"
+#include "recovery/cc.h"
+#include "util/instant.h"
+
+// Prague: the scalable congestion control of L4S
+// https://datatracker.ietf.org/doc/html/draft-briscoe-iccrg-prague-congestion-control
+//
+// Packets are sent with ECT(1), which an L4S AQM marks CE as soon as its
+// queue exceeds a shallow threshold, often below a millisecond. The
+// sender keeps alpha, an EWMA of the fraction of packets marked per
+// round trip, and reduces the window once per round trip with marks by
+//
+//     cwnd = cwnd * (1 - alpha / 2)
+//
+// so that a few marks per round trip cost a small reduction, instead of
+// the halving of classic ECN (RFC 3168). The window grows by a datagram
+// per round trip otherwise. The first mark ends slow start with a
+// halving, and losses halve the window as in CcReno. As in CcReno, the
+// window does not grow while less than half of it is in flight.
+//
+// The sender paces at twice the window per smoothed RTT in slow start
+// and 1.2 times in congestion avoidance, as Linux does: a shallow
+// threshold marks the bursts of an unpaced sender long before the
+// bottleneck is full.
+//
+// A classic ECN AQM marks ECT(1) like ECT(0), at a much deeper queue,
+// and expects a classic response. Rounds with marks at a queueing delay
+// above kClassicQueueingDelay count as evidence of a classic AQM, rounds
+// with marks below it as evidence against; after kClassicRounds more of
+// the former, the sender halves its window on marks as well, until the
+// evidence is gone.
+class CcPrague : public CongestionControl {
+
+public:
+
+    CcPrague();
+
+    ~CcPrague() override = default;
+
+    void on_packet_sent(SentPacketPtr &packet) override;
+
+    void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) override;
+
+    void on_packet_acked(Instant now, const RttTime &rtt,
+                         std::vector<SentPacketPtr> &packets) override;
+
+    void on_ecn_counts(Instant now, const EcnCounts &newly,
+                       Instant largest_acked_time_sent) override;
+
+    // congestion window validation, as in CcReno
+    void on_rate_sample(Instant now, const RateSample &rs) override;
+
+    inline EcnCodepoint ecn_codepoint() const override {
+        return EcnCodepoint::Ect1;
+    }
+
+    inline size_t congestion_window() const override {
+        return cc_window_;
+    }
+
+    inline size_t bytes_in_flight() const override {
+        return bytes_in_flight_;
+    }
+
+    // twice the window per smoothed RTT in slow start, 1.2 times in
+    // congestion avoidance
+    inline uint64_t pacing_rate(const RttTime &rtt) const override {
+        return pacing_rate_;
+    }
+
+    inline const char *name() const override {
+        return "prague";
+    }
+
+    const char *state_name() const override;
+
+    // the EWMA of the fraction of packets marked CE per round trip
+    inline double alpha() const {
+        return alpha_;
+    }
+
+    // whether marks are answered as in classic ECN
+    inline bool classic_fallback() const {
+        return classic_score_ >= kClassicRounds;
+    }
+
+private:
+
+    static constexpr size_t kMinimumWindow = kMaxDatagramSize * 2;
+
+    static constexpr size_t kInitialWindow = kMaxDatagramSize * 10;
+
+    // the gain of the alpha EWMA
+    static constexpr double kAlphaGain = 1.0 / 16;
+
+    // an L4S AQM keeps its queue well below this
+    static constexpr Duration kClassicQueueingDelay =
+        Duration::from_milliseconds(2);
+
+    static constexpr int kClassicRounds = 4;
+
+    void on_round_end();
+
+    void reduce_window(Instant now, double factor);
+
+    bool in_congestion_recovery(Instant sent_time) const;
+
+    size_t cc_window_;
+
+    size_t ssthresh_;
+
+    size_t bytes_in_flight_;
+
+    // whether the window is in use; see on_rate_sample()
+    bool cwnd_limited_;
+
+    uint64_t pacing_rate_;
+
+    // the bytes acknowledged in congestion avoidance since the window
+    // last grew
+    size_t bytes_acked_;
+
+    // A reduction covers the packets sent before it.
+    Instant congestion_recovery_start_time_;
+
+    double alpha_;
+
+    // A round trip ends when a packet sent after it started is
+    // acknowledged.
+    Instant round_start_;
+
+    // the ECN-capable packets acknowledged in this round trip, and those
+    // of them marked CE
+    uint64_t round_ect_packets_;
+
+    uint64_t round_ce_packets_;
+
+    // smoothed_rtt - min_rtt at the last ACK
+    Duration queueing_delay_;
+
+    // between 0 and 2 * kClassicRounds
+    int classic_score_;
+
+};
+
+#endif //RECOVERY_CC_PRAGUE_H
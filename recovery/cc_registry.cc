@@ -0,0 +1,57 @@
+//
+// Created by Chengke Wong on 2020/5/31.
+//
+
+#include "recovery/cc_registry.h"
+
+#include <stdexcept>
+
+#include "recovery/cc_bbr.h"
+#include "recovery/cc_copa.h"
+#include "recovery/cc_cubic.h"
+#include "recovery/cc_prague.h"
+#include "recovery/cc_reno.h"
+
+namespace {
+
+template<typename Cc>
+unique_ptr<CongestionControl> new_cc() {
+    return std::make_unique<Cc>();
+}
+
+}
+
+CongestionControlRegistry &CongestionControlRegistry::instance() {
+    static CongestionControlRegistry registry;
+    return registry;
+}
+
+CongestionControlRegistry::CongestionControlRegistry() {
+    add("reno", new_cc<CcReno>);
+    add("cubic", new_cc<CcCubic>);
+    add("bbr", new_cc<CcBbr>);
+    add("copa", new_cc<CcCopa>);
+    add("prague", new_cc<CcPrague>);
+}
+
+bool CongestionControlRegistry::add(const std::string &name,
+                                    Factory factory) {
+    return factories_.emplace(name, std::move(factory)).second;
+}
+
+unique_ptr<CongestionControl> CongestionControlRegistry::create(
+    const std::string &name) const {
+    auto it = factories_.find(name);
+    if (it == factories_.end()) {
+        throw std::invalid_argument("unknown congestion control: " + name);
+    }
+    return it->second();
+}
+
+std::vector<std::string> CongestionControlRegistry::names() const {
+    std::vector<std::string> names;
+    for (auto &factory : factories_) {
+        names.push_back(factory.first);
+    }
+    return names;
+}
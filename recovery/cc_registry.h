@@ -0,0 +1,59 @@
+//
+// Created by Chengke Wong on 2020/5/31.
+//
+
+#ifndef RECOVERY_CC_REGISTRY_H
+#define RECOVERY_CC_REGISTRY_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "recovery/cc.h"
+
+// The congestion controllers by name, so that a connection can pick one
+// from its QuicConfig rather than at compile time:
+//
+//     unique_ptr<CongestionControl> cc =
+//         CongestionControlRegistry::instance().create(config.congestion_control);
+//
+// The built-in controllers are "reno", "cubic", "bbr", "copa" and
+// "prague". Others are added with add() at startup, before any
+// connection is created; the registry is not locked, and creating
+// controllers from several threads is safe only once it stops changing.
+class CongestionControlRegistry {
+
+public:
+
+    using Factory = std::function<unique_ptr<CongestionControl>()>;
+
+    // the registry of the process, with the built-in controllers
+    static CongestionControlRegistry &instance();
+
+    // return false if |name| is already taken
+    bool add(const std::string &name, Factory factory);
+
+    // throw std::invalid_argument if |name| is unknown
+    unique_ptr<CongestionControl> create(const std::string &name) const;
+
+    inline bool contains(const std::string &name) const {
+        return factories_.count(name) > 0;
+    }
+
+    // in alphabetical order
+    std::vector<std::string> names() const;
+
+    // disallow copy and assignment
+    CongestionControlRegistry (const CongestionControlRegistry&) = delete;
+    CongestionControlRegistry& operator= (const CongestionControlRegistry&) = delete;
+
+private:
+
+    CongestionControlRegistry();
+
+    std::map<std::string, Factory> factories_;
+
+};
+
+#endif //RECOVERY_CC_REGISTRY_H
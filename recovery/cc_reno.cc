@@ -0,0 +1,130 @@
+//
+// Created by Chengke Wong on 2020/5/24.
+//
+
+#include "recovery/cc_reno.h"
+
+constexpr size_t CcReno::kMinimumWindow;
+
+CcReno::CcReno()
+        : cc_window_(kInitialWindow),
+          ssthresh_(std::numeric_limits<size_t>::max()),
+          bytes_in_flight_(0),
+          cwnd_limited_(true),
+          bytes_acked_(0),
+          congestion_recovery_start_time_(Instant::zero()),
+          persistent_congestion_duration_(Duration::infinite()),
+          largest_acked_time_sent_(Instant::zero()) {
+
+}
+
+const char *CcReno::state_name() const {
+    if (!cwnd_limited_) {
+        return "application_limited";
+    }
+    return cc_window_ < ssthresh_ ? "slow_start" : "congestion_avoidance";
+}
+
+void CcReno::on_packet_sent(SentPacketPtr &packet) {
+    bytes_in_flight_ += packet->sent_bytes;
+}
+
+void CcReno::on_packet_acked(Instant now, const RttTime &rtt,
+                             std::vector<SentPacketPtr> &packets) {
+    persistent_congestion_duration_ =
+        rtt.pto() * kPersistentCongestionThreshold;
+
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        largest_acked_time_sent_ = std::max(largest_acked_time_sent_,
+                                            packet->time_sent);
+
+        if (in_congestion_recovery(packet->time_sent)) {
+            // Do not increase congestion window in recovery period.
+            continue;
+        }
+
+        if (!cwnd_limited_) {
+            // Do not increase congestion window if application
+            // limited or flow control limited.
+            continue;
+        }
+
+        if (cc_window_ < ssthresh_) {
+            // Slow start.
+            cc_window_ += packet->sent_bytes;
+        } else {
+            // Congestion avoidance: one datagram per window acknowledged.
+            // Adding kMaxDatagramSize * sent_bytes / cc_window_ per ACK
+            // would round down to zero once the window is above
+            // kMaxDatagramSize^2 bytes.
+            bytes_acked_ += packet->sent_bytes;
+            if (bytes_acked_ >= cc_window_) {
+                bytes_acked_ -= cc_window_;
+                cc_window_ += kMaxDatagramSize;
+            }
+        }
+    }
+}
+
+void CcReno::on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) {
+    DCHECK(!packets.empty());
+
+    Instant earliest = packets.front()->time_sent;
+    Instant lastest = packets.front()->time_sent;
+
+    for (auto &packet : packets) {
+        bytes_in_flight_ -= packet->sent_bytes;
+        earliest = std::min(earliest, packet->time_sent);
+        lastest = std::max(lastest, packet->time_sent);
+    }
+
+    on_congestion_event(now, lastest);
+
+    // Collapse congestion window if persistent congestion: the packets
+    // lost together span the persistent congestion duration, and none
+    // sent in between has been acknowledged.
+    if (earliest > largest_acked_time_sent_ &&
+        lastest - earliest > persistent_congestion_duration_) {
+        congestion_recovery_start_time_ = Instant::zero();
+        cc_window_ = kMinimumWindow;
+    }
+}
+
+void CcReno::on_ecn_counts(Instant now, const EcnCounts &newly,
+                         Instant largest_acked_time_sent) {
+    // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-on-receiving-an-acknowledgm
+    // ProcessECN: the packets stay acknowledged, only the window shrinks.
+    if (newly.ce > 0) {
+        on_congestion_event(now, largest_acked_time_sent);
+    }
+}
+
+void CcReno::on_rate_sample(Instant now, const RateSample &rs) {
+    // pipeACK is the data in flight when the newest packet acknowledged
+    // was sent
+    cwnd_limited_ = rs.tx_in_flight * 2 >= cc_window_;
+}
+
+bool CcReno::in_congestion_recovery(Instant sent_time) {
+    return sent_time <= congestion_recovery_start_time_;
+}
+
+void CcReno::on_congestion_event(Instant now, Instant sent_time) {
+    // No reaction if already in a recovery period.
+    if (in_congestion_recovery(sent_time)) {
+        return;
+    }
+
+    congestion_recovery_start_time_ = now;
+
+    // congestion_window *= kLossReductionFactor
+    // congestion_window = max(congestion_window, kMinimumWindow)
+    // Here, we let kLossReductionFactor = 0.5
+    cc_window_ = std::max(cc_window_ >> 1, kMinimumWindow);
+
+    ssthresh_ = cc_window_;
+    bytes_acked_ = 0;
+}
+
+
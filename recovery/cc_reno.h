@@ -0,0 +1,104 @@
+//
+// Created by Chengke Wong on 2020/5/24.
+//
+
+#ifndef RECOVERY_CC_RENO_H
+#define RECOVERY_CC_RENO_H
+
+#include "common/config.h"
+#include "recovery/cc.h"
+#include "util/instant.h"
+
+// NewReno: the congestion controller of the recovery draft.
+// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-congestion-control
+class CcReno : public CongestionControl {
+
+public:
+
+    CcReno();
+
+	~CcReno() override = default;
+
+    void on_packet_sent(SentPacketPtr &packet) override;
+
+    void on_packet_lost(Instant now, std::vector<SentPacketPtr> &packets) override;
+
+    void on_packet_acked(Instant now, const RttTime &rtt,
+                         std::vector<SentPacketPtr> &packets) override;
+
+    // An increase in the CE count is a congestion event, as a loss would
+    // be, for the largest packet acknowledged.
+    void on_ecn_counts(Instant now, const EcnCounts &newly,
+                       Instant largest_acked_time_sent) override;
+
+    inline EcnCodepoint ecn_codepoint() const override {
+        return EcnCodepoint::Ect0;
+    }
+
+    // https://www.rfc-editor.org/rfc/rfc7661.html
+    // Congestion window validation: the window only grows on the ACKs of
+    // packets sent while at least half of it was in flight, so that it
+    // does not inflate while the sender is app- or flow-control-limited.
+    void on_rate_sample(Instant now, const RateSample &rs) override;
+
+    inline size_t congestion_window() const override {
+        return cc_window_;
+    }
+
+    inline size_t bytes_in_flight() const override {
+        return bytes_in_flight_;
+    }
+
+    inline const char *name() const override {
+        return "reno";
+    }
+
+    const char *state_name() const override;
+
+private:
+
+	static constexpr size_t kMinimumWindow = kMaxDatagramSize * 2;
+
+	static constexpr size_t kInitialCwndPackets = 10;
+
+	static constexpr size_t kInitialWindow = const_min(kInitialCwndPackets * kMaxDatagramSize,
+                                                       const_max(14720ul, kMaxDatagramSize * 2));
+
+	// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-persistent-congestion
+	static constexpr int kPersistentCongestionThreshold = 3;
+
+	void on_congestion_event(Instant now, Instant sent_time);
+
+	bool in_congestion_recovery(Instant sent_time);
+
+	// Congestion window size in bytes.
+	size_t cc_window_;
+
+	// Slow start threshold in bytes. When the congestion window is below ssthresh, 
+	// the mode is slow start and the window grows by the number of bytes acknowledged.
+	size_t ssthresh_;
+
+	size_t bytes_in_flight_;
+
+	// whether the window is in use; see on_rate_sample()
+	bool cwnd_limited_;
+
+	// the bytes acknowledged in congestion avoidance since the window
+	// last grew
+	size_t bytes_acked_;
+
+	// The time when QUIC first detects congestion due to loss or ECN, causing it to 
+	// enter congestion recovery. When a packet sent after this time is acknowledged, 
+	// QUIC exits congestion recovery.
+	Instant congestion_recovery_start_time_;
+
+	// PTO * kPersistentCongestionThreshold at the last ACK, infinite
+	// before the first RTT sample
+	Duration persistent_congestion_duration_;
+
+	// the time the latest packet acknowledged was sent
+	Instant largest_acked_time_sent_;
+
+};
+
+#endif //RECOVERY_CC_RENO_H
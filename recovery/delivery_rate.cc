@@ -0,0 +1,79 @@
+//
+// Created by Chengke Wong on 2020/5/26.
+//
+
+#include "recovery/delivery_rate.h"
+
+void DeliveryRateSampler::on_packet_sent(SentPacket &packet,
+                                         size_t bytes_in_flight) {
+    if (bytes_in_flight == 0) {
+        // Nothing is in flight; start measuring from now, so that the
+        // idle time is not counted.
+        first_sent_time_ = packet.time_sent;
+        delivered_time_ = packet.time_sent;
+    }
+    packet.delivery = DeliveryState {
+        .delivered = delivered_,
+        .delivered_time = delivered_time_,
+        .first_sent_time = first_sent_time_,
+        .lost = lost_,
+        .tx_in_flight = bytes_in_flight + packet.sent_bytes,
+        .is_app_limited = app_limited_until_ != 0,
+    };
+}
+
+void DeliveryRateSampler::on_packet_acked(Instant now,
+                                          const SentPacket &packet) {
+    const DeliveryState &state = packet.delivery;
+
+    delivered_ += packet.sent_bytes;
+    delivered_time_ = now;
+    newly_acked_ += packet.sent_bytes;
+
+    // Take the sample from the most recently sent packet.
+    if (!has_sample_ || state.delivered > sample_.prior_delivered) {
+        has_sample_ = true;
+        sample_.prior_delivered = state.delivered;
+        sample_.is_app_limited = state.is_app_limited;
+        sample_.tx_in_flight = state.tx_in_flight;
+        sample_.lost = lost_ - state.lost;
+        sample_.rtt = now - packet.time_sent;
+        prior_time_ = state.delivered_time;
+        send_elapsed_ = packet.time_sent - state.first_sent_time;
+        ack_elapsed_ = delivered_time_ - state.delivered_time;
+        first_sent_time_ = packet.time_sent;
+    }
+
+    if (app_limited_until_ != 0 && delivered_ > app_limited_until_) {
+        app_limited_until_ = 0;
+    }
+}
+
+void DeliveryRateSampler::on_packet_lost(const SentPacket &packet) {
+    lost_ += packet.sent_bytes;
+}
+
+bool DeliveryRateSampler::generate_rate_sample(Duration min_rtt,
+                                               RateSample &rs) {
+    if (!has_sample_) {
+        return false;
+    }
+    has_sample_ = false;
+
+    rs = sample_;
+    rs.newly_acked = newly_acked_;
+    newly_acked_ = 0;
+    rs.delivered = delivered_ - rs.prior_delivered;
+
+    // The ACKs may be compressed and the packets may have been sent in a
+    // burst; use the longer of the two intervals, so that the rate is not
+    // overestimated.
+    rs.interval = std::max(send_elapsed_, ack_elapsed_);
+    if (rs.interval < min_rtt || rs.interval.is_zero()) {
+        rs.delivery_rate = 0;
+        return false;
+    }
+    rs.delivery_rate = rs.delivered * 1000000
+        / static_cast<uint64_t>(rs.interval.to_microseconds());
+    return true;
+}
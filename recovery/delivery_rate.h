@@ -0,0 +1,111 @@
+//
+// Created by Chengke Wong on 2020/5/26.
+//
+
+#ifndef RECOVERY_DELIVERY_RATE_H
+#define RECOVERY_DELIVERY_RATE_H
+
+#include "recovery/sent_packet.h"
+#include "util/instant.h"
+
+// What was delivered between sending the newest packet of an ACK and
+// receiving the ACK.
+struct RateSample {
+
+    // in bytes per second, 0 if the sample is not valid
+    uint64_t delivery_rate = 0;
+
+    bool is_app_limited = false;
+
+    // the bytes acknowledged over |interval|
+    uint64_t delivered = 0;
+
+    // the bytes lost between sending the newest packet and acknowledging it
+    uint64_t lost = 0;
+
+    // the connection's delivered count when the newest packet was sent
+    uint64_t prior_delivered = 0;
+
+    Duration interval = Duration::zero();
+
+    // the RTT of the newest packet
+    Duration rtt = Duration::zero();
+
+    // the bytes in flight when the newest packet was sent
+    size_t tx_in_flight = 0;
+
+    // the bytes newly acknowledged by this ACK
+    size_t newly_acked = 0;
+
+};
+
+// Delivery Rate Estimation
+// https://datatracker.ietf.org/doc/html/draft-cheng-iccrg-delivery-rate-estimation
+//
+// Each packet records the connection's delivery state when it is sent;
+// an ACK then yields the rate at which data was delivered while the
+// newest acknowledged packet was in flight:
+//
+//     sampler.on_packet_sent(*packet, bytes_in_flight);
+//     ...
+//     for (auto &packet : acked) sampler.on_packet_acked(now, *packet);
+//     RateSample rs;
+//     sampler.generate_rate_sample(min_rtt, rs);
+class DeliveryRateSampler {
+
+public:
+
+    DeliveryRateSampler() = default;
+
+    // |bytes_in_flight| does not include |packet|
+    void on_packet_sent(SentPacket &packet, size_t bytes_in_flight);
+
+    void on_packet_acked(Instant now, const SentPacket &packet);
+
+    void on_packet_lost(const SentPacket &packet);
+
+    // Fill |rs| with the packets acknowledged since the last call.
+    // return false if none of them makes a valid sample, e.g. when the
+    // interval is shorter than |min_rtt|.
+    bool generate_rate_sample(Duration min_rtt, RateSample &rs);
+
+    // The sender has nothing to send although the window allows it; the
+    // samples taken until the data in flight is acknowledged do not
+    // reflect the path's capacity.
+    inline void on_app_limited(size_t bytes_in_flight) {
+        app_limited_until_ = std::max<uint64_t>(delivered_ + bytes_in_flight, 1);
+    }
+
+    inline uint64_t delivered() const {
+        return delivered_;
+    }
+
+    inline uint64_t lost() const {
+        return lost_;
+    }
+
+private:
+
+    uint64_t delivered_ = 0;
+
+    Instant delivered_time_ = Instant::zero();
+
+    Instant first_sent_time_ = Instant::zero();
+
+    uint64_t lost_ = 0;
+
+    // the data up to this delivered count was sent while app-limited;
+    // 0 if not app-limited
+    uint64_t app_limited_until_ = 0;
+
+    // the sample of the ACK being processed
+    bool has_sample_ = false;
+    RateSample sample_;
+    Instant prior_time_ = Instant::zero();
+    Duration send_elapsed_ = Duration::zero();
+    Duration ack_elapsed_ = Duration::zero();
+    size_t newly_acked_ = 0;
+
+};
+
+#endif //RECOVERY_DELIVERY_RATE_H
@@ -0,0 +1,115 @@
+//
+// Created by Chengke Wong on 2020/5/23.
+//
+
+#ifndef RECOVERY_FRAME_RECORD_H
+#define RECOVERY_FRAME_RECORD_H
+
+#include "common/frame.h"
+#include "common/quic_types.h"
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-sent-packet-fields
+// What a sent packet carried, kept so that the frames can be handled when
+// the packet is acknowledged or declared lost. Each record is a small
+// tagged union; the records of a packet form an intrusive list and are
+// allocated from the per-connection SentPacketPool.
+
+// STREAM: the range of stream data that was sent
+struct StreamRecord {
+    uint64_t stream_id;
+    uint64_t offset;
+    uint32_t length;
+    bool fin;
+};
+
+// CRYPTO: the range of the crypto stream of a packet number space
+struct CryptoRecord {
+    uint64_t offset;
+    uint32_t length;
+    PNSpace space;
+};
+
+// MAX_DATA, MAX_STREAM_DATA, MAX_STREAMS, *_BLOCKED, RESET_STREAM,
+// STOP_SENDING, NEW_CONNECTION_ID and RETIRE_CONNECTION_ID. The fields
+// a frame type does not have are zero.
+struct ControlRecord {
+    // the stream ID, or the sequence number of a connection ID
+    uint64_t id;
+    // the limit, or the final size of RESET_STREAM
+    uint64_t value;
+    uint64_t error_code;
+};
+
+struct FrameRecord {
+
+    // one of FRAME_TYPE_*; all the STREAM frame types are
+    // FRAME_TYPE_STREAM
+    uint8_t type;
+
+    union {
+        StreamRecord stream;
+        CryptoRecord crypto;
+        ControlRecord control;
+    };
+
+    // the next record of the same packet
+    FrameRecord *next;
+
+    static inline FrameRecord stream_frame(uint64_t stream_id, uint64_t offset,
+                                           uint32_t length, bool fin) {
+        FrameRecord record(FRAME_TYPE_STREAM);
+        record.stream = StreamRecord {stream_id, offset, length, fin};
+        return record;
+    }
+
+    static inline FrameRecord crypto_frame(PNSpace space, uint64_t offset,
+                                           uint32_t length) {
+        FrameRecord record(FRAME_TYPE_CRYPTO);
+        record.crypto = CryptoRecord {offset, length, space};
+        return record;
+    }
+
+    static inline FrameRecord control_frame(uint8_t type, uint64_t id = 0,
+                                            uint64_t value = 0,
+                                            uint64_t error_code = 0) {
+        FrameRecord record(type);
+        record.control = ControlRecord {id, value, error_code};
+        return record;
+    }
+
+private:
+
+    explicit FrameRecord(uint8_t type)
+        : type(type),
+          next(nullptr)
+        {}
+
+};
+
+// Receives the frames of the packets that are acknowledged or declared
+// lost, e.g. to release acknowledged stream data or to queue lost data for
+// retransmission. Implemented by the connection.
+class FrameRecordHandler {
+
+public:
+
+    virtual ~FrameRecordHandler() = default;
+
+    virtual void on_stream_acked(const StreamRecord &record) = 0;
+
+    virtual void on_stream_lost(const StreamRecord &record) = 0;
+
+    virtual void on_crypto_acked(const CryptoRecord &record) = 0;
+
+    virtual void on_crypto_lost(const CryptoRecord &record) = 0;
+
+    // PING, HANDSHAKE_DONE and the ControlRecord frames
+    virtual void on_control_frame_acked(const FrameRecord &record) = 0;
+
+    // Control frames are not retransmitted as they were: a new frame with
+    // the current value is sent if it is still needed.
+    virtual void on_control_frame_lost(const FrameRecord &record) = 0;
+
+};
+
+#endif //RECOVERY_FRAME_RECORD_H
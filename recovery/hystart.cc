@@ -0,0 +1,66 @@
+//
+// Created by Chengke Wong on 2020/5/25.
+//
+
+#include "recovery/hystart.h"
+
+#include <algorithm>
+
+constexpr Duration HyStart::kMinRttThresh;
+constexpr Duration HyStart::kMaxRttThresh;
+constexpr size_t HyStart::kBurstLimit;
+
+HyStart::HyStart()
+    : round_start_(Instant::zero()),
+      last_round_min_rtt_(Duration::infinite()),
+      current_round_min_rtt_(Duration::infinite()),
+      css_baseline_min_rtt_(Duration::infinite()),
+      rtt_sample_count_(0),
+      css_rounds_(0),
+      in_css_(false)
+{}
+
+void HyStart::reset() {
+    *this = HyStart();
+}
+
+void HyStart::on_ack(Instant now, Instant largest_sent, Duration latest_rtt) {
+    // https://www.rfc-editor.org/rfc/rfc9406.html#name-algorithm-details
+    if (largest_sent >= round_start_) {
+        // a new round
+        if (in_css_) {
+            css_rounds_ += 1;
+        }
+        round_start_ = now;
+        last_round_min_rtt_ = current_round_min_rtt_;
+        current_round_min_rtt_ = Duration::infinite();
+        rtt_sample_count_ = 0;
+    }
+
+    current_round_min_rtt_ = std::min(current_round_min_rtt_, latest_rtt);
+    rtt_sample_count_ += 1;
+
+    if (rtt_sample_count_ < kNRttSample ||
+        current_round_min_rtt_.is_infinite()) {
+        return;
+    }
+
+    if (!in_css_) {
+        if (last_round_min_rtt_.is_infinite()) {
+            return;
+        }
+        Duration rtt_thresh = std::max(
+            kMinRttThresh,
+            std::min(last_round_min_rtt_ >> kMinRttDivisorShift,
+                     kMaxRttThresh));
+        if (current_round_min_rtt_ >= last_round_min_rtt_ + rtt_thresh) {
+            in_css_ = true;
+            css_rounds_ = 0;
+            css_baseline_min_rtt_ = current_round_min_rtt_;
+        }
+    } else if (current_round_min_rtt_ < css_baseline_min_rtt_) {
+        // The RTT increase was spurious; resume slow start.
+        in_css_ = false;
+        css_baseline_min_rtt_ = Duration::infinite();
+    }
+}
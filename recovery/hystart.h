@@ -0,0 +1,93 @@
+//
+// Created by Chengke Wong on 2020/5/25.
+//
+
+#ifndef RECOVERY_HYSTART_H
+#define RECOVERY_HYSTART_H
+
+#include <algorithm>
+
+#include "common/config.h"
+#include "util/instant.h"
+
+// HyStart++: Modified Slow Start for TCP
+// https://www.rfc-editor.org/rfc/rfc9406.html
+//
+// Leaves slow start before the queue at the bottleneck overflows. Once
+// the minimum RTT of a round is higher than that of the previous round
+// by more than 1/8 (at least 4 ms, at most 16 ms), the window grows at a
+// quarter of the slow start rate for kCssRounds rounds (Conservative
+// Slow Start) and then the sender moves to congestion avoidance. If the
+// RTT drops back during CSS, the increase was spurious and slow start
+// resumes.
+//
+// A round ends when a packet sent after the round started is
+// acknowledged.
+class HyStart {
+
+public:
+
+    static constexpr Duration kMinRttThresh = Duration::from_milliseconds(4);
+
+    static constexpr Duration kMaxRttThresh = Duration::from_milliseconds(16);
+
+    static constexpr size_t kMinRttDivisorShift = 3;
+
+    // the RTT samples needed in a round before it is compared with the
+    // previous one
+    static constexpr size_t kNRttSample = 8;
+
+    static constexpr size_t kCssGrowthDivisor = 4;
+
+    static constexpr size_t kCssRounds = 5;
+
+    // L: the window grows by at most this many datagrams per ACK, as the
+    // packets are not paced
+    static constexpr size_t kBurstLimit = 8;
+
+    HyStart();
+
+    // Called for each ACK that acknowledges packets in slow start.
+    // |largest_sent| is the time the newest of them was sent.
+    void on_ack(Instant now, Instant largest_sent, Duration latest_rtt);
+
+    // the window increase for |acked_bytes| acknowledged by one ACK
+    inline size_t window_increase(size_t acked_bytes) const {
+        size_t increase = std::min(acked_bytes, kBurstLimit * kMaxDatagramSize);
+        return in_css_ ? increase / kCssGrowthDivisor : increase;
+    }
+
+    // CSS has lasted kCssRounds rounds; the sender should set ssthresh to
+    // the window and move to congestion avoidance
+    inline bool should_exit_slow_start() const {
+        return in_css_ && css_rounds_ >= kCssRounds;
+    }
+
+    inline bool in_css() const {
+        return in_css_;
+    }
+
+    // start over, e.g. when slow start is entered again
+    void reset();
+
+private:
+
+    Instant round_start_;
+
+    Duration last_round_min_rtt_;
+
+    Duration current_round_min_rtt_;
+
+    // the minimum RTT of the round CSS was entered in
+    Duration css_baseline_min_rtt_;
+
+    size_t rtt_sample_count_;
+
+    // the rounds finished since CSS was entered
+    size_t css_rounds_;
+
+    bool in_css_;
+
+};
+
+#endif //RECOVERY_HYSTART_H
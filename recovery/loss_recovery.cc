@@ -6,14 +6,18 @@
 
 #include <algorithm>
 
+#include "recovery/cc_registry.h"
+
+constexpr size_t LossRecovery::kMaxProbePackets;
+
 void LossRecoverySpace::on_packet_sent(PacketNumber pn,
-                                       unique_ptr<SentPacket> packet) {
+                                       SentPacketPtr packet) {
     if (packet->ack_eliciting) {
         time_of_last_sent_ack_eliciting_packet_ = packet->time_sent;
         ack_eliciting_outstanding_ += 1;
     }
 
-    sent_packets_.insert(std::make_pair(pn, std::move(packet)));
+    sent_packets_.insert(pn, std::move(packet));
 }
 
 bool LossRecoverySpace::update_largest_acked_packet(AckFrame &ack) {
@@ -30,30 +34,83 @@ bool LossRecoverySpace::update_largest_acked_packet(AckFrame &ack) {
     }
 }
 
-std::vector<unique_ptr<SentPacket>>
-LossRecoverySpace::detect_and_remove_acked_packets(AckFrame &ack) {
-    std::vector<unique_ptr<SentPacket> > acked_packets;
+void LossRecoverySpace::detect_and_remove_acked_packets(
+    AckFrame &ack, std::vector<SentPacketPtr> &acked_packets) {
+    // The ACK ranges come newest first; walk them oldest first along with
+    // the history, so that the packets come out in packet number order
+    // and the largest acknowledged packet is the last one.
+    //
+    // Everything below the first packet of the history has already been
+    // acknowledged or declared lost, and the ranges below it, usually
+    // most of them, are skipped without a lookup. Within a range, only
+    // the packets still in flight are visited.
+    for (auto range = ack.ranges.rbegin(); range != ack.ranges.rend();
+         range++) {
+        PacketNumber::dtype end = std::min(range->start + range->length,
+                                           sent_packets_.end_packet_number());
+        for (PacketNumber::dtype pn =
+                 sent_packets_.next_packet_number(range->start);
+             pn < end; pn = sent_packets_.next_packet_number(pn + 1)) {
+            acked_packets.push_back(sent_packets_.remove(pn));
+            if (acked_packets.back()->ack_eliciting) {
+                ack_eliciting_outstanding_ -= 1;
+            }
+        }
+    }
+}
 
-    for (AckRange range: ack.ranges) {
-        uint64_t pn_start = range.start;
-        uint64_t pn_end = range.start + range.length;
+EcnCounts LossRecoverySpace::update_ecn_counts(const AckFrame &ack) {
+    // The counts only grow, but an ACK frame may arrive out of order and
+    // report smaller ones.
+    EcnCounts newly = {
+        ack.ECT0_count > ecn_counts_.ect0 ? ack.ECT0_count - ecn_counts_.ect0 : 0,
+        ack.ECT1_count > ecn_counts_.ect1 ? ack.ECT1_count - ecn_counts_.ect1 : 0,
+        ack.ECN_CE_count > ecn_counts_.ce ? ack.ECN_CE_count - ecn_counts_.ce : 0,
+    };
+    ecn_counts_.ect0 += newly.ect0;
+    ecn_counts_.ect1 += newly.ect1;
+    ecn_counts_.ce += newly.ce;
+    return newly;
+}
 
-        for (uint64_t pn = pn_start; pn < pn_end; pn++) {
-            auto iter = sent_packets_.find(pn);
-            if (iter != sent_packets_.end()) {
-                acked_packets.push_back(std::move(iter->second));
-                sent_packets_.erase(iter);
-            }
+void LossRecoverySpace::on_ecn_packet_sent(EcnCodepoint ecn) {
+    if (ecn == EcnCodepoint::Ect0) {
+        ecn_sent_.ect0 += 1;
+    } else if (ecn == EcnCodepoint::Ect1) {
+        ecn_sent_.ect1 += 1;
+    }
+}
+
+bool LossRecoverySpace::validate_ecn_counts(
+    const AckFrame &ack, const std::vector<SentPacketPtr> &acked_packets,
+    EcnCounts &newly) {
+    uint64_t ect_acked = 0;
+    for (auto &packet : acked_packets) {
+        if (packet->ecn != EcnCodepoint::NotEct) {
+            ect_acked += 1;
         }
     }
-    return acked_packets;
+
+    // The ECN field is cleared on the path, or the peer does not report it.
+    if (!ack.is_ECN) {
+        newly = EcnCounts{0, 0, 0};
+        return ect_acked == 0;
+    }
+
+    newly = update_ecn_counts(ack);
+    if (newly.ect0 + newly.ect1 + newly.ce < ect_acked) {
+        return false;
+    }
+
+    // ECT(0) rewritten into ECT(1), or the other way round
+    return ecn_counts_.ect0 <= ecn_sent_.ect0 &&
+        ecn_counts_.ect1 <= ecn_sent_.ect1;
 }
 
-std::vector<unique_ptr<SentPacket>>
-LossRecoverySpace::detect_and_remove_lost_packets(Duration loss_delay,
-                                                  Instant now) {
+void LossRecoverySpace::detect_and_remove_lost_packets(
+    Duration loss_delay, Instant now,
+    std::vector<SentPacketPtr> &lost_packets) {
     // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-detecting-lost-packets
-    std::vector<unique_ptr<SentPacket>> lost_packets;
 
     DCHECK(largest_acked_packet_.has_value());
     PacketNumber largest_acked_packet = largest_acked_packet_.value();
@@ -61,36 +118,83 @@ LossRecoverySpace::detect_and_remove_lost_packets(Duration loss_delay,
     Instant lost_send_time = now - loss_delay;
     loss_time_ = Instant::infinite();
 
-    auto iter = sent_packets_.begin();
-    while (iter != sent_packets_.end()) {
-        PacketNumber unacked_packet_number = iter->first;
-        unique_ptr<SentPacket> &unacked = iter->second;
-        if (unacked_packet_number > largest_acked_packet_) {
-            continue;
-        }
+    // Only the packets sent before the largest acknowledged one can be
+    // declared lost; they are scanned in packet number order.
+    PacketNumber::dtype end = std::min(sent_packets_.end_packet_number(),
+                                       largest_acked_packet.value + 1);
+    for (PacketNumber::dtype pn = sent_packets_.first_packet_number();
+         pn < end; pn = sent_packets_.next_packet_number(pn + 1)) {
+        SentPacket *unacked = sent_packets_.find(pn);
 
         // A packet is declared lost
         if (unacked->time_sent <= lost_send_time ||
-            largest_acked_packet_->value >=
-                unacked_packet_number.value + kPacketThreshold) {
+            largest_acked_packet.value >= pn + kPacketThreshold) {
 
-            if (unacked->in_flight) {
-                lost_packets.push_back(std::move(unacked));
+            SentPacketPtr packet = sent_packets_.remove(pn);
+            if (packet->ack_eliciting) {
+                ack_eliciting_outstanding_ -= 1;
+            }
+            if (packet->in_flight) {
+                lost_packets.push_back(std::move(packet));
             }
-
-            auto iter_to_be_erased = iter;
-            iter++;
-            sent_packets_.erase(iter_to_be_erased);
         } else {
             loss_time_ = std::min(loss_time_, unacked->time_sent + loss_delay);
         }
     }
+}
 
-    return lost_packets;
+void LossRecoverySpace::oldest_retransmittable_packets(
+    size_t max, std::vector<SentPacket *> &packets) {
+    for (PacketNumber::dtype pn = sent_packets_.first_packet_number();
+         pn < sent_packets_.end_packet_number() && max > 0;
+         pn = sent_packets_.next_packet_number(pn + 1)) {
+        SentPacket *packet = sent_packets_.find(pn);
+        for (FrameRecord *frame = packet->frames; frame != nullptr;
+             frame = frame->next) {
+            if (frame->type != FRAME_TYPE_PING) {
+                packets.push_back(packet);
+                max -= 1;
+                break;
+            }
+        }
+    }
+}
+
+LossRecovery::LossRecovery(AlarmManager &alarms,
+                           unique_ptr<CongestionControl> cc,
+                           bool is_server, Duration max_ack_delay)
+    : is_server_(is_server),
+      is_handshake_complete_(false),
+      has_received_handshake_ack_(false),
+      rtt_time_(max_ack_delay),
+      pto_count_(0),
+      cc_(std::move(cc)),
+      loss_detection_alarm_(alarms.new_alarm([this](Instant now) {
+          on_loss_detection_timeout(now);
+      }))
+{}
+
+LossRecovery::LossRecovery(AlarmManager &alarms, const QuicConfig &config,
+                           bool is_server)
+    : LossRecovery(alarms,
+                   CongestionControlRegistry::instance().create(
+                       config.congestion_control),
+                   is_server, config.max_ack_delay)
+{}
+
+void LossRecovery::set_handshake_complete(Instant now) {
+    is_handshake_complete_ = true;
+    set_loss_detection_alarm(now);
 }
 
 void LossRecovery::on_packet_sent(PNSpace space, PacketNumber pn,
-                                  unique_ptr<SentPacket> packet) {
+                                  SentPacketPtr packet) {
+    packet->pto = sending_probes_;
+
+    // The sender is expected to set the ECN field to ecn_codepoint().
+    packet->ecn = ecn_codepoint();
+    spaces_[space].on_ecn_packet_sent(packet->ecn);
+
     if (! packet->in_flight) {
         return;
     }
@@ -98,6 +202,7 @@ void LossRecovery::on_packet_sent(PNSpace space, PacketNumber pn,
     Instant now = packet->time_sent;
 
     // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-on-sending-a-packet
+    sampler_.on_packet_sent(*packet, cc_->bytes_in_flight());
     cc_->on_packet_sent(packet);
     spaces_[space].on_packet_sent(pn, std::move(packet));
     set_loss_detection_alarm(now);
@@ -107,39 +212,67 @@ void LossRecovery::on_ack_received(PNSpace space, AckFrame &ack, Instant now) {
     // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-on-receiving-an-acknowledgm
     LossRecoverySpace &recovery_space = spaces_[space];
 
-    auto newly_acked_packets =
-        recovery_space.detect_and_remove_acked_packets(ack);
+    std::vector<SentPacketPtr> &newly_acked_packets = acked_packets_;
+    newly_acked_packets.clear();
+    recovery_space.detect_and_remove_acked_packets(ack, newly_acked_packets);
 
     if (newly_acked_packets.empty()) {
         return;
     }
 
+    if (space != PNSpace::Initial) {
+        has_received_handshake_ack_ = true;
+    }
+
     // If the largest acknowledged is newly acked and
     // at least one ack-eliciting was newly acked, update the RTT.
     bool newly_ack_the_largest = recovery_space.update_largest_acked_packet(ack);
     if (newly_ack_the_largest && includes_ack_eliciting(newly_acked_packets)) {
-        unique_ptr<SentPacket> &largest_acked_pkt = newly_acked_packets.back();
+        SentPacketPtr &largest_acked_pkt = newly_acked_packets.back();
         Duration latest_rtt = now - largest_acked_pkt->time_sent;
         Duration ack_delay = Duration::zero();
 
         if (space == PNSpace::Application) {
-            ack_delay = Duration::from_microseconds(ack.ack_delay);
+            ack_delay = Duration::from_microseconds(
+                ack.ack_delay << kDefaultAckDelayExponent);
         }
-        rtt_time_.update_rtt(latest_rtt, ack_delay);
+        rtt_time_.update_rtt(latest_rtt, ack_delay, now);
     }
 
-    // TODO: Process ECN information if present.
-    //  if (ACK frame contains ECN information):
-    //      ProcessECN(ack, pn_space)
+    // An ACK frame that does not acknowledge a new largest packet may
+    // be reordered and carry stale counts.
+    if (newly_ack_the_largest && !ecn_failed_) {
+        process_ecn(recovery_space, ack, now);
+    }
 
-    auto lost_packets =
-        recovery_space.detect_and_remove_lost_packets(
-            rtt_time_.loss_delay(), now);
+    std::vector<SentPacketPtr> &lost_packets = lost_packets_;
+    lost_packets.clear();
+    recovery_space.detect_and_remove_lost_packets(
+        rtt_time_.loss_delay(), now, lost_packets);
 
     if (!lost_packets.empty()) {
+        for (auto &packet : lost_packets) {
+            sampler_.on_packet_lost(*packet);
+        }
+        dispatch_frames(lost_packets, false);
         cc_->on_packet_lost(now, lost_packets);
     }
-    cc_->on_packet_acked(newly_acked_packets);
+
+    for (auto &packet : newly_acked_packets) {
+        sampler_.on_packet_acked(now, *packet);
+    }
+    RateSample rs;
+    sampler_.generate_rate_sample(rtt_time_.min_rtt(), rs);
+    cc_->on_rate_sample(now, rs);
+
+    dispatch_frames(newly_acked_packets, true);
+    cc_->on_packet_acked(now, rtt_time_, newly_acked_packets);
+
+    // The packets go back to the pool here, rather than when the
+    // vectors are reused, so that the pool does not have to grow for
+    // packets that are long gone.
+    lost_packets.clear();
+    newly_acked_packets.clear();
 
     // Reset pto_count unless the client is unsure if
     // the server has validated the client's address.
@@ -150,8 +283,26 @@ void LossRecovery::on_ack_received(PNSpace space, AckFrame &ack, Instant now) {
     set_loss_detection_alarm(now);
 }
 
+void LossRecovery::process_ecn(LossRecoverySpace &recovery_space,
+                               AckFrame &ack, Instant now) {
+    // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-on-receiving-an-acknowledgm
+    // ProcessECN: the controller decides whether an increase in the
+    // ECN-CE count is a congestion event.
+    std::vector<SentPacketPtr> &newly_acked_packets = acked_packets_;
+    EcnCounts newly;
+    if (!recovery_space.validate_ecn_counts(ack, newly_acked_packets,
+                                            newly)) {
+        ecn_failed_ = true;
+        return;
+    }
+    if (ack.is_ECN) {
+        cc_->on_ecn_counts(now, newly,
+                           newly_acked_packets.back()->time_sent);
+    }
+}
+
 bool LossRecovery::includes_ack_eliciting(
-    std::vector<unique_ptr<SentPacket>> &acked_packet) {
+    std::vector<SentPacketPtr> &acked_packet) {
     for (auto &packet : acked_packet) {
         if (packet->ack_eliciting) {
             return true;
@@ -160,17 +311,24 @@ bool LossRecovery::includes_ack_eliciting(
     return false;
 }
 
+void LossRecovery::dispatch_frames(std::vector<SentPacketPtr> &packets,
+                                   bool acked) {
+    if (frame_handler_ == nullptr) {
+        return;
+    }
+    for (auto &packet : packets) {
+        ::dispatch_frames(*packet, acked, *frame_handler_);
+    }
+}
+
 bool LossRecovery::peer_completed_address_validation() {
-    // TODO
-    //  # Assume clients validate the server's address implicitly.
-    //  if (endpoint is server):
-    //    return true
-    //  # Servers complete address validation when a
-    //  # protected packet is received.
-    //  return has received Handshake ACK ||
-    //       has received 1-RTT ACK ||
-    //       has received HANDSHAKE_DONE
-    return true;
+    // Assume clients validate the server's address implicitly.
+    if (is_server_) {
+        return true;
+    }
+    // Servers complete address validation when a protected packet is
+    // received; HANDSHAKE_DONE completes the handshake of the client.
+    return has_received_handshake_ack_ || is_handshake_complete_;
 }
 
 void LossRecovery::set_loss_detection_alarm(Instant now) {
@@ -191,24 +349,24 @@ void LossRecovery::set_loss_detection_alarm(Instant now) {
     //  loss_detection_timer.cancel()
     //  return
 
-    // TODO:
-    // if (no ack-eliciting packets in flight &&
-    //     PeerCompletedAddressValidation()):
-    //   // There is nothing to detect lost, so no timer is set.
-    //   // However, the client needs to arm the timer if the
-    //   // server might be blocked by the anti-amplification limit.
-    //   loss_detection_timer.cancel()
-    //   return
-
     // Determine which PN space to arm PTO for.
     PNSpace pn_space;
     Instant sent_time = Instant::infinite();
     std::tie(sent_time, pn_space) = get_earliest_time_and_space(
         &LossRecoverySpace::time_of_last_sent_ack_eliciting_packet);
 
+    if (sent_time.is_infinite() && peer_completed_address_validation()) {
+        // There is nothing to detect lost, so no timer is set.
+        // However, the client needs to arm the timer if the
+        // server might be blocked by the anti-amplification limit.
+        loss_detection_alarm_->cancel();
+        return;
+    }
+
     // Don't arm PTO for ApplicationData until handshake complete.
     if (pn_space == PNSpace::Application && !is_handshake_complete_) {
         loss_detection_alarm_->cancel();
+        return;
     }
 
     if (sent_time.is_infinite()) {
@@ -229,39 +387,67 @@ void LossRecovery::on_loss_detection_timeout(Instant now) {
 
     // Time threshold loss Detection
     if (!std::get<0>(earliest_loss).is_infinite()) {
-        auto lost_packets = 
-            spaces_[std::get<1>(earliest_loss)].detect_and_remove_lost_packets(
-                rtt_time_.loss_delay(), now);
-
-        DCHECK(!lost_packets.empty());
-        cc_->on_packet_lost(Instant(0), lost_packets);
+        std::vector<SentPacketPtr> &lost_packets = lost_packets_;
+        lost_packets.clear();
+        spaces_[std::get<1>(earliest_loss)].detect_and_remove_lost_packets(
+            rtt_time_.loss_delay(), now, lost_packets);
+
+        // The packets lost may all have been out of flight.
+        if (!lost_packets.empty()) {
+            for (auto &packet : lost_packets) {
+                sampler_.on_packet_lost(*packet);
+            }
+            dispatch_frames(lost_packets, false);
+            cc_->on_packet_lost(now, lost_packets);
+            lost_packets.clear();
+        }
 
         set_loss_detection_alarm(now);
         return;
     }
 
-    // TODO:
-    //   IMPORTANT:
-    // if (bytes_in_flight > 0):
-    //     // PTO. Send new data if available, else retransmit old data.
-    //     // If neither is available, send a single PING frame.
-    //     _, pn_space = GetEarliestTimeAndSpace(
-    //       time_of_last_sent_ack_eliciting_packet)
-    //     SendOneOrTwoAckElicitingPackets(pn_space)
-    //   else:
-    //     assert(endpoint is client without 1-RTT keys)
-    //     // Client sends an anti-deadlock packet: Initial is padded
-    //     // to earn more anti-amplification credit,
-    //     // a Handshake packet proves address ownership.
-    //     if (has Handshake keys):
-    //       SendOneAckElicitingHandshakePacket()
-    //     else:
-    //       SendOneAckElicitingPaddedInitialPacket()
+    if (probe_sender_ != nullptr) {
+        sending_probes_ = true;
+        if (cc_->bytes_in_flight() > 0) {
+            // PTO. Send new data if available, else retransmit old data.
+            // If neither is available, send a single PING frame.
+            send_probes(std::get<1>(get_earliest_time_and_space(
+                &LossRecoverySpace::time_of_last_sent_ack_eliciting_packet)));
+        } else {
+            DCHECK(!is_server_);
+            probe_sender_->send_anti_deadlock_probe();
+        }
+        sending_probes_ = false;
+    }
 
     pto_count_ += 1;
     set_loss_detection_alarm(now);
 }
 
+void LossRecovery::send_probes(PNSpace space) {
+    // The packets to retransmit are picked before sending anything; the
+    // probes go to the end of the history, and the packets stay there
+    // until an ACK comes.
+    std::vector<SentPacket *> &packets = probe_packets_;
+    packets.clear();
+    spaces_[space].oldest_retransmittable_packets(kMaxProbePackets, packets);
+
+    size_t retransmitted = 0;
+    for (size_t i = 0; i < kMaxProbePackets; i++) {
+        if (probe_sender_->send_new_data_probe(space)) {
+            continue;
+        }
+        if (retransmitted < packets.size()) {
+            probe_sender_->send_retransmission_probe(
+                space, *packets[retransmitted]);
+            retransmitted += 1;
+            continue;
+        }
+        probe_sender_->send_ping_probe(space);
+    }
+    packets.clear();
+}
+
 std::tuple<Instant, PNSpace> 
 LossRecovery::get_earliest_time_and_space(WhatEarliestTime what) {
     PNSpace space = PNSpace::Initial;
@@ -7,10 +7,13 @@
 
 #include <tuple>
 
+#include "common/config.h"
 #include "common/frame.h"
 #include "common/quic_types.h"
 #include "recovery/sent_packet.h"
+#include "recovery/sent_packet_history.h"
 #include "recovery/cc.h"
+#include "recovery/delivery_rate.h"
 #include "recovery/rtt_time.h"
 #include "util/alarm.h"
 
@@ -24,38 +27,82 @@ public:
     // in line with TCP [RFC5681].
     static constexpr size_t kPacketThreshold = 3;
 
-    void on_packet_sent(PacketNumber pn, unique_ptr<SentPacket> packet);
+    void on_packet_sent(PacketNumber pn, SentPacketPtr packet);
 
     // return whether the largest_acked_packet is updated
     bool update_largest_acked_packet(AckFrame &ack);
 
-    // return newly_acked_packets and a boolean indicating whether the newly
-    // acked packets contains a ack-eliciting one
-    std::vector<unique_ptr<SentPacket>>
-    detect_and_remove_acked_packets(AckFrame &ack);
-
-    std::vector<unique_ptr<SentPacket>>
-    detect_and_remove_lost_packets(Duration loss_delay,
-                                   Instant now);
+    // move the newly acknowledged packets into |acked_packets|, in packet
+    // number order
+    void detect_and_remove_acked_packets(
+        AckFrame &ack, std::vector<SentPacketPtr> &acked_packets);
+
+    // return the increase in the ECN counts of |ack| since the largest
+    // counts reported in this space
+    EcnCounts update_ecn_counts(const AckFrame &ack);
+
+    // count a packet sent with |ecn|, in flight or not
+    void on_ecn_packet_sent(EcnCodepoint ecn);
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-ecn-validation
+    // Update the ECN counts with |ack|, which newly acknowledges
+    // |acked_packets| and the largest packet acknowledged so far, and
+    // return the increase in |newly|. Return false if the counts are
+    // inconsistent with the packets sent, i.e. the path or the peer
+    // clears or rewrites the ECN field.
+    bool validate_ecn_counts(const AckFrame &ack,
+                             const std::vector<SentPacketPtr> &acked_packets,
+                             EcnCounts &newly);
+
+    // move the packets declared lost and in flight into |lost_packets|
+    void detect_and_remove_lost_packets(
+        Duration loss_delay, Instant now,
+        std::vector<SentPacketPtr> &lost_packets);
 
     inline Instant loss_time() const {
         return loss_time_;
     }
 
+    // infinite if no ack-eliciting packet is in flight
     inline Instant time_of_last_sent_ack_eliciting_packet() const {
-        return time_of_last_sent_ack_eliciting_packet_;
+        return ack_eliciting_outstanding_ > 0
+            ? time_of_last_sent_ack_eliciting_packet_ : Instant::infinite();
+    }
+
+    inline size_t ack_eliciting_outstanding() const {
+        return ack_eliciting_outstanding_;
+    }
+
+    // append the oldest packets in flight that carry frames worth
+    // retransmitting, i.e. other than PING, to |packets|, at most |max|
+    // of them
+    void oldest_retransmittable_packets(size_t max,
+                                        std::vector<SentPacket *> &packets);
+
+    inline optional<PacketNumber> largest_acked_packet() const {
+        return largest_acked_packet_;
+    }
+
+    // the packet number the peer is assumed to expect next, against which
+    // the packet numbers we send are truncated
+    inline PacketNumber::dtype peer_expected_packet_number() const {
+        return largest_acked_packet_ ? largest_acked_packet_->value + 1 : 0;
     }
 
 private:
 
     optional<PacketNumber> largest_acked_packet_;
 
-    using SentPackets = std::map<PacketNumber, unique_ptr<SentPacket> >;
-
-    SentPackets sent_packets_;
+    SentPacketHistory sent_packets_;
 
     size_t ack_eliciting_outstanding_ = 0;
 
+    // the largest ECN counts reported by the peer
+    EcnCounts ecn_counts_ = {0, 0, 0};
+
+    // the packets sent with ECT(0) and ECT(1); |ce| is unused
+    EcnCounts ecn_sent_ = {0, 0, 0};
+
     Instant time_of_last_sent_ack_eliciting_packet_ = Instant::infinite();;
 
     // The time at which the next packet in that packet number space will be
@@ -80,27 +127,174 @@ private:
 
 };
 
+// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-sending-probe-packets
+// Sends the ack-eliciting packets LossRecovery asks for when the PTO
+// expires. Implemented by the connection, which sends the packets
+// through LossRecovery::on_packet_sent() as usual, before returning.
+class ProbeSender {
+
+public:
+
+    virtual ~ProbeSender() = default;
+
+    // Send a packet of new data in |space|, if there is any and the
+    // flow control allows; return whether a packet was sent.
+    virtual bool send_new_data_probe(PNSpace space) = 0;
+
+    // Send the frames of |packet|, still unacknowledged, again in a new
+    // packet of |space|. The frames that are no longer needed, e.g.
+    // stream data acknowledged in another packet, may be left out.
+    virtual void send_retransmission_probe(PNSpace space,
+                                           const SentPacket &packet) = 0;
+
+    // send a packet with only a PING frame in |space|
+    virtual void send_ping_probe(PNSpace space) = 0;
+
+    // The client has nothing in flight, but the server may be blocked by
+    // the anti-amplification limit. Send a Handshake packet if there are
+    // the Handshake keys, as it proves the address ownership, or else
+    // an Initial packet padded to earn the server more credit.
+    virtual void send_anti_deadlock_probe() = 0;
+
+};
+
 class LossRecovery {
 
 public: 
 
-    void on_packet_sent(PNSpace space, PacketNumber pn, unique_ptr<SentPacket> packet);
+    // The number of probes sent when the PTO expires. Two, so that a
+    // single loss does not wait for another PTO.
+    static constexpr size_t kMaxProbePackets = 2;
+
+    LossRecovery(AlarmManager &alarms, unique_ptr<CongestionControl> cc,
+                 bool is_server,
+                 Duration max_ack_delay = kDefaultMaxAckDelay);
+
+    // with the congestion controller named in |config|; throw
+    // std::invalid_argument if there is no such controller
+    LossRecovery(AlarmManager &alarms, const QuicConfig &config,
+                 bool is_server);
+
+    // the packets passed to on_packet_sent() should come from pool()
+    inline SentPacketPool &pool() {
+        return pool_;
+    }
+
+    // |handler| is told about the frames of the packets acknowledged or
+    // declared lost, if not null
+    inline void set_frame_handler(FrameRecordHandler *handler) {
+        frame_handler_ = handler;
+    }
+
+    // |sender| is asked for the probes when the PTO expires; without
+    // one, the PTO only backs off
+    inline void set_probe_sender(ProbeSender *sender) {
+        probe_sender_ = sender;
+    }
+
+    // The TLS handshake is confirmed; the Application space is
+    // considered for the PTO from now on.
+    void set_handshake_complete(Instant now);
+
+    void on_packet_sent(PNSpace space, PacketNumber pn, SentPacketPtr packet);
 
     void on_ack_received(PNSpace space, AckFrame &ack, Instant now);
 
+    // The sender has less to send than the window allows, because the
+    // application has nothing more or flow control blocks it. The rate
+    // samples are marked app-limited until the data now in flight is
+    // acknowledged, so that they do not lower a bandwidth estimate.
+    inline void on_app_limited() {
+        sampler_.on_app_limited(cc_->bytes_in_flight());
+    }
+
+    // the ECN codepoint the packets should be sent with, Not-ECT once
+    // ECN validation has failed
+    inline EcnCodepoint ecn_codepoint() const {
+        return ecn_failed_ ? EcnCodepoint::NotEct : cc_->ecn_codepoint();
+    }
+
+    // in bytes per second, for Pacer::set_rate()
+    inline uint64_t pacing_rate() const {
+        return cc_->pacing_rate(rtt_time_);
+    }
+
+    inline CongestionControlInfo cc_info() const {
+        return cc_->info(rtt_time_);
+    }
+
+    // in bytes
+    inline size_t congestion_window() const {
+        return cc_->congestion_window();
+    }
+
+    inline size_t bytes_in_flight() const {
+        return cc_->bytes_in_flight();
+    }
+
+    inline const RttTime &rtt_time() const {
+        return rtt_time_;
+    }
+
+    // Record the RTT samples of the connection into |histogram| as well,
+    // if not null; see RttTime::set_histogram(). |histogram| must outlive
+    // this LossRecovery, or be unset first.
+    inline void set_rtt_histogram(RttHistogram *histogram) {
+        rtt_time_.set_histogram(histogram);
+    }
+
+    // the number of bytes used to encode |pn| in the packet header
+    inline size_t packet_number_length(PNSpace space, PacketNumber pn) {
+        return PacketNumber::encoded_length(
+            pn.value, spaces_[space].peer_expected_packet_number());
+    }
+
+    // the number of PTOs since the last ACK
+    inline size_t pto_count() const {
+        return pto_count_;
+    }
+
     // disallow copy and assignment
     LossRecovery (const LossRecovery&) = delete;
     LossRecovery& operator= (const LossRecovery&) = delete;
 
-    LossRecovery (LossRecovery&&) = default;
-    LossRecovery& operator= (LossRecovery&&) = default;
+    // the sent packets point to |pool_|
+    LossRecovery (LossRecovery&&) = delete;
+    LossRecovery& operator= (LossRecovery&&) = delete;
 
 private:
 
+    // declared first, so that it is destroyed after all the packets
+    SentPacketPool pool_;
+
+    FrameRecordHandler *frame_handler_ = nullptr;
+
+    ProbeSender *probe_sender_ = nullptr;
+
+    // the packets sent from now on are PTO probes
+    bool sending_probes_ = false;
+
+    // the candidates for send_retransmission_probe()
+    std::vector<SentPacket *> probe_packets_;
+
+    // reused by every ACK, so that processing one does not allocate
+    std::vector<SentPacketPtr> acked_packets_;
+    std::vector<SentPacketPtr> lost_packets_;
+
+    void dispatch_frames(std::vector<SentPacketPtr> &packets, bool acked);
+
+    bool is_server_;
+
     bool is_handshake_complete_;
 
+    // a Handshake or 1-RTT packet has been acknowledged, so the server
+    // has validated the client's address
+    bool has_received_handshake_ack_;
+
     RttTime rtt_time_;
 
+    DeliveryRateSampler sampler_;
+
     LossRecoverySpaces spaces_;
 
     // The number of times a PTO has been sent without receiving an ack
@@ -109,10 +303,20 @@ private:
 
     unique_ptr<CongestionControl> cc_;
 
-    static bool includes_ack_eliciting(std::vector<unique_ptr<SentPacket>> &acked_packet);
+    // ECN validation has failed in some space; the ECN counts are
+    // ignored from then on
+    bool ecn_failed_ = false;
+
+    void process_ecn(LossRecoverySpace &recovery_space, AckFrame &ack,
+                     Instant now);
+
+    static bool includes_ack_eliciting(std::vector<SentPacketPtr> &acked_packet);
 
     bool peer_completed_address_validation();
 
+    // SendOneOrTwoAckElicitingPackets
+    void send_probes(PNSpace space);
+
     void set_loss_detection_alarm(Instant now);
 
     void on_loss_detection_timeout(Instant now);
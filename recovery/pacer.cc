@@ -0,0 +1,82 @@
+//
+// Created by Chengke Wong on 2020/5/30.
+//
+
+#include "recovery/pacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+Pacer::Pacer(AlarmManager &alarms, Alarm::Delegte on_can_send,
+             size_t burst_bytes)
+    : rate_(0),
+      burst_(burst_bytes),
+      credit_(burst_bytes),
+      last_refill_(Instant::zero()),
+      on_can_send_(std::move(on_can_send)),
+      alarm_(alarms.new_alarm([this](Instant now) {
+          on_alarm(now);
+      }))
+{}
+
+void Pacer::set_rate(Instant now, uint64_t rate) {
+    // the credit so far accrued at the old rate
+    refill(now);
+    rate_ = rate;
+    if (alarm_->is_set()) {
+        alarm_->set(next_send_time(now));
+    }
+}
+
+void Pacer::set_burst(size_t burst_bytes) {
+    burst_ = burst_bytes;
+    credit_ = std::min(credit_, burst_);
+}
+
+bool Pacer::can_send(Instant now) {
+    refill(now);
+    if (rate_ == 0 || credit_ >= kMaxDatagramSize) {
+        return true;
+    }
+    if (!alarm_->is_set()) {
+        alarm_->set(next_send_time(now));
+    }
+    return false;
+}
+
+void Pacer::on_packet_sent(Instant now, size_t sent_bytes) {
+    refill(now);
+    credit_ -= sent_bytes;
+}
+
+Instant Pacer::next_send_time(Instant now) const {
+    if (rate_ == 0) {
+        return now;
+    }
+    double credit = std::min(burst_, credit_ +
+        (now - last_refill_).to_microseconds() * 1e-6 * rate_);
+    if (credit >= kMaxDatagramSize) {
+        return now;
+    }
+    return now + Duration::from_microseconds(static_cast<int64_t>(
+        std::ceil((kMaxDatagramSize - credit) * 1e6 / rate_)));
+}
+
+void Pacer::refill(Instant now) {
+    if (now <= last_refill_) {
+        return;
+    }
+    if (rate_ == 0) {
+        credit_ = burst_;
+    } else {
+        credit_ = std::min(burst_, credit_ +
+            (now - last_refill_).to_microseconds() * 1e-6 * rate_);
+    }
+    last_refill_ = now;
+}
+
+void Pacer::on_alarm(Instant now) {
+    if (on_can_send_) {
+        on_can_send_(now);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// Created by Chengke Wong on 2020/5/30.
+//
+
+#ifndef RECOVERY_PACER_H
+#define RECOVERY_PACER_H
+
+#include "common/config.h"
+#include "util/alarm.h"
+#include "util/instant.h"
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-pacing
+// Spaces the packets of a connection out at the rate of its congestion
+// controller, see CongestionControl::pacing_rate(), instead of sending a
+// newly opened window in one line-rate burst.
+//
+// The pacer is a token bucket in bytes: credit accrues at the pacing
+// rate up to the burst allowance, and a packet may be sent while there
+// is credit for a full datagram. The allowance lets the sender batch a
+// few datagrams, e.g. for GSO, and caps the burst after an idle period.
+//
+//     if (pacer.can_send(now)) {
+//         ... send a packet of |size| bytes ...
+//         pacer.on_packet_sent(now, size);
+//     }
+//     // otherwise |on_can_send| is called when the credit is back
+//
+// The rate is updated with set_rate(), typically after every ACK.
+class Pacer {
+
+public:
+
+    // enough for one GSO batch
+    static constexpr size_t kDefaultBurstPackets = 10;
+
+    Pacer(AlarmManager &alarms, Alarm::Delegte on_can_send = nullptr,
+          size_t burst_bytes = kDefaultBurstPackets * kMaxDatagramSize);
+
+    // |rate| is in bytes per second, 0 to send without pacing
+    void set_rate(Instant now, uint64_t rate);
+
+    void set_burst(size_t burst_bytes);
+
+    // return whether a packet may be sent at |now|; if not, the alarm is
+    // set for next_send_time()
+    bool can_send(Instant now);
+
+    void on_packet_sent(Instant now, size_t sent_bytes);
+
+    // the earliest time a datagram may be sent, not before |now|
+    Instant next_send_time(Instant now) const;
+
+    inline uint64_t rate() const {
+        return rate_;
+    }
+
+    // disallow copy and assignment
+    Pacer (const Pacer&) = delete;
+    Pacer& operator= (const Pacer&) = delete;
+
+private:
+
+    // accrue the credit up to |now|
+    void refill(Instant now);
+
+    void on_alarm(Instant now);
+
+    uint64_t rate_;
+
+    double burst_;
+
+    // in bytes, negative after a packet larger than the credit
+    double credit_;
+
+    Instant last_refill_;
+
+    Alarm::Delegte on_can_send_;
+
+    unique_ptr<Alarm> alarm_;
+
+};
+
+#endif //RECOVERY_PACER_H
@@ -0,0 +1,1202 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#include <deque>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "recovery/cc_bbr.h"
+#include "recovery/cc_copa.h"
+#include "recovery/cc_cubic.h"
+#include "recovery/cc_prague.h"
+#include "recovery/cc_registry.h"
+#include "recovery/cc_reno.h"
+#include "recovery/delivery_rate.h"
+#include "recovery/hystart.h"
+#include "recovery/loss_recovery.h"
+#include "recovery/pacer.h"
+#include "recovery/rtt_histogram.h"
+#include "recovery/sent_packet_history.h"
+
+class RecoveryTest : public ::testing::Test {
+protected:
+    RecoveryTest() = default;
+
+    ~RecoveryTest() override = default;
+
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+    }
+
+    SentPacketPtr make_packet(Instant time_sent) {
+        return pool.new_packet(time_sent, 1200, true, true);
+    }
+
+    std::vector<SentPacketPtr> detect_acked(LossRecoverySpace &space,
+                                            AckFrame &ack) {
+        std::vector<SentPacketPtr> acked;
+        space.detect_and_remove_acked_packets(ack, acked);
+        return acked;
+    }
+
+    std::vector<SentPacketPtr> detect_lost(LossRecoverySpace &space,
+                                           Duration loss_delay,
+                                           Instant now) {
+        std::vector<SentPacketPtr> lost;
+        space.detect_and_remove_lost_packets(loss_delay, now, lost);
+        return lost;
+    }
+
+    // an ACK frame of |ranges| given as [first, last] pairs, newest first
+    AckFrame make_ack(std::vector<std::pair<uint64_t, uint64_t>> ranges) {
+        AckFrame ack;
+        ack.is_ECN = false;
+        ack.largest_ack = ranges.front().second;
+        ack.ack_delay = 0;
+        for (auto &range : ranges) {
+            ack.ranges.emplace_back(range.first,
+                                    range.second - range.first + 1);
+        }
+        return ack;
+    }
+
+    // Send a window of packets at |now| and acknowledge all of them one
+    // RTT later, two packets per ACK, |rounds| times.
+    void run_rounds(CongestionControl &cc, RttTime &rtt, Duration round_trip,
+                    size_t rounds) {
+        std::vector<SentPacketPtr> packets;
+        std::vector<SentPacketPtr> acked;
+        for (size_t round = 0; round < rounds; round++) {
+            while (cc.bytes_in_flight() + kMaxDatagramSize
+                   <= cc.congestion_window()) {
+                SentPacketPtr packet = pool.new_packet(
+                    now, kMaxDatagramSize, true, true);
+                cc.on_packet_sent(packet);
+                packets.push_back(std::move(packet));
+            }
+            now = now + round_trip;
+            rtt.update_rtt(round_trip, Duration::zero(), now);
+            for (size_t i = 0; i < packets.size(); i += 2) {
+                acked.push_back(std::move(packets[i]));
+                if (i + 1 < packets.size()) {
+                    acked.push_back(std::move(packets[i + 1]));
+                }
+                cc.on_packet_acked(now, rtt, acked);
+                acked.clear();
+            }
+            packets.clear();
+        }
+    }
+
+    // Send a window of packets, acknowledge them one by one |round_trip|
+    // later and mark the last |marked| of them CE.
+    void run_ecn_round(CongestionControl &cc, RttTime &rtt,
+                       Duration round_trip, size_t marked) {
+        std::vector<SentPacketPtr> packets;
+        std::vector<SentPacketPtr> acked;
+        now = now + Duration::from_milliseconds(1);
+        while (cc.bytes_in_flight() + kMaxDatagramSize
+               <= cc.congestion_window()) {
+            SentPacketPtr packet = pool.new_packet(
+                now, kMaxDatagramSize, true, true);
+            cc.on_packet_sent(packet);
+            packets.push_back(std::move(packet));
+        }
+        now = now + round_trip;
+        rtt.update_rtt(round_trip, Duration::zero(), now);
+        for (size_t i = 0; i < packets.size(); i++) {
+            bool ce = i + marked >= packets.size();
+            cc.on_ecn_counts(now, EcnCounts{0, ce ? 0u : 1u, ce ? 1u : 0u},
+                             packets[i]->time_sent);
+            acked.push_back(std::move(packets[i]));
+            cc.on_packet_acked(now, rtt, acked);
+            acked.clear();
+        }
+    }
+
+    // what run_bottleneck() saw in its last second
+    struct BottleneckStats {
+        Duration max_rtt;
+        size_t delivered;
+    };
+
+    // The packets are paced and queue at a bottleneck that transmits one
+    // every |transmission|; each is acknowledged one |propagation| after
+    // it leaves the link. Feed |sampler|, if any, and the rate samples to
+    // |cc|.
+    BottleneckStats run_bottleneck(CongestionControl &cc, RttTime &rtt,
+                                   Duration propagation,
+                                   Duration transmission, Duration duration,
+                                   DeliveryRateSampler *sampler = nullptr) {
+        std::deque<std::pair<Instant, SentPacketPtr>> in_flight;
+        std::vector<SentPacketPtr> acked;
+        Instant link_free = now;
+        Instant next_send = now;
+        Instant end = now + duration;
+        BottleneckStats stats{Duration::zero(), 0};
+        while (now < end) {
+            Instant send_time = Instant::infinite();
+            if (cc.bytes_in_flight() + kMaxDatagramSize
+                <= cc.congestion_window()) {
+                send_time = std::max(now, next_send);
+            }
+            Instant ack_time = in_flight.empty()
+                ? Instant::infinite() : in_flight.front().first;
+            now = std::min(send_time, ack_time);
+
+            if (send_time <= ack_time) {
+                SentPacketPtr packet = pool.new_packet(now, kMaxDatagramSize,
+                                                       true, true);
+                if (sampler) {
+                    sampler->on_packet_sent(*packet, cc.bytes_in_flight());
+                }
+                cc.on_packet_sent(packet);
+                uint64_t pacing_rate = cc.pacing_rate(rtt);
+                if (pacing_rate > 0) {
+                    next_send = now + Duration::from_microseconds(
+                        static_cast<int64_t>(
+                            kMaxDatagramSize * 1000000 / pacing_rate));
+                }
+                link_free = std::max(link_free, now) + transmission;
+                in_flight.emplace_back(link_free + propagation,
+                                       std::move(packet));
+                continue;
+            }
+
+            acked.push_back(std::move(in_flight.front().second));
+            in_flight.pop_front();
+            Duration sample = now - acked.back()->time_sent;
+            rtt.update_rtt(sample, Duration::zero(), now);
+            if (sampler) {
+                sampler->on_packet_acked(now, *acked.back());
+                RateSample rs;
+                sampler->generate_rate_sample(rtt.min_rtt(), rs);
+                cc.on_rate_sample(now, rs);
+            }
+            cc.on_packet_acked(now, rtt, acked);
+            acked.clear();
+            if (now > end - Duration::from_seconds(1)) {
+                stats.max_rtt = std::max(stats.max_rtt, sample);
+                stats.delivered += 1;
+            }
+        }
+        return stats;
+    }
+
+    void lose_packet(CongestionControl &cc) {
+        std::vector<SentPacketPtr> lost;
+        lost.push_back(pool.new_packet(now, kMaxDatagramSize, true, true));
+        cc.on_packet_sent(lost.back());
+        now = now + Duration::from_milliseconds(1);
+        cc.on_packet_lost(now, lost);
+    }
+
+    // declared first, so that it outlives the packets of the tests
+    SentPacketPool pool;
+
+    Instant now = Instant(1000000);
+};
+
+TEST_F(RecoveryTest, SentPacketHistory) {
+    SentPacketHistory history;
+    for (uint64_t pn = 0; pn < 1000; pn++) {
+        history.insert(pn, make_packet(now));
+    }
+    // a skipped packet number
+    history.insert(1001, make_packet(now));
+    EXPECT_EQ(history.size(), 1001);
+    EXPECT_EQ(history.find(1000), nullptr);
+    EXPECT_NE(history.find(1001), nullptr);
+
+    EXPECT_TRUE(history.remove(5));
+    EXPECT_FALSE(history.remove(5));
+    EXPECT_EQ(history.first_packet_number(), 0);
+
+    // removing the head drops the tombstones behind it
+    for (uint64_t pn = 0; pn < 5; pn++) {
+        EXPECT_TRUE(history.remove(pn));
+    }
+    EXPECT_EQ(history.first_packet_number(), 6);
+    EXPECT_EQ(history.size(), 995);
+
+    // wrap around the ring buffer
+    for (uint64_t pn = 6; pn < 1000; pn++) {
+        EXPECT_TRUE(history.remove(pn));
+        history.insert(pn + 1002, make_packet(now));
+    }
+    EXPECT_EQ(history.first_packet_number(), 1001);
+    EXPECT_EQ(history.end_packet_number(), 2002);
+    EXPECT_EQ(history.size(), 995);
+    EXPECT_NE(history.find(2001), nullptr);
+
+    while (!history.empty()) {
+        EXPECT_TRUE(history.remove(history.first_packet_number()));
+    }
+    history.insert(5000, make_packet(now));
+    EXPECT_EQ(history.first_packet_number(), 5000);
+    EXPECT_EQ(history.size(), 1);
+}
+
+TEST_F(RecoveryTest, SentPacketHistoryScan) {
+    SentPacketHistory history;
+    for (uint64_t pn = 0; pn < 300; pn++) {
+        history.insert(pn, make_packet(now));
+    }
+    for (uint64_t pn = 1; pn < 250; pn++) {
+        history.remove(pn);
+    }
+    EXPECT_EQ(history.next_packet_number(0), 0);
+    EXPECT_EQ(history.next_packet_number(1), 250);
+    EXPECT_EQ(history.next_packet_number(299), 299);
+    EXPECT_EQ(history.next_packet_number(300), 300);
+
+    // wrap around the ring buffer
+    history.remove(0);
+    for (uint64_t pn = 300; pn < 500; pn += 7) {
+        history.insert(pn, make_packet(now));
+    }
+    for (uint64_t pn = 250; pn < 300; pn++) {
+        history.remove(pn);
+    }
+    EXPECT_EQ(history.first_packet_number(), 300);
+    uint64_t count = 0;
+    for (uint64_t pn = history.next_packet_number(0);
+         pn < history.end_packet_number();
+         pn = history.next_packet_number(pn + 1)) {
+        EXPECT_EQ(pn % 7, 300 % 7);
+        count += 1;
+    }
+    EXPECT_EQ(count, history.size());
+}
+
+TEST_F(RecoveryTest, AckRanges) {
+    LossRecoverySpace space;
+    for (uint64_t pn = 0; pn < 20000; pn++) {
+        space.on_packet_sent(pn, make_packet(now + Duration::from_microseconds(pn)));
+    }
+
+    AckFrame ack = make_ack({{10, 10000}, {0, 5}});
+    auto acked = detect_acked(space, ack);
+    ASSERT_EQ(acked.size(), 9997);
+    // in packet number order
+    EXPECT_EQ(acked.front()->time_sent, now);
+    EXPECT_EQ(acked.back()->time_sent, now + Duration::from_microseconds(10000));
+
+    // the old ranges are repeated in the next ACK
+    ack = make_ack({{10, 10005}, {0, 5}});
+    EXPECT_EQ(detect_acked(space, ack).size(), 5);
+    ack = make_ack({{10, 10005}, {0, 9}});
+    EXPECT_EQ(detect_acked(space, ack).size(), 4);
+}
+
+TEST_F(RecoveryTest, DetectLostPackets) {
+    LossRecoverySpace space;
+    for (uint64_t pn = 0; pn < 10; pn++) {
+        space.on_packet_sent(pn, make_packet(now));
+    }
+
+    // 2, 3 and 6 are missing
+    AckFrame ack = make_ack({{7, 8}, {4, 5}, {0, 1}});
+    EXPECT_EQ(detect_acked(space, ack).size(), 6);
+    EXPECT_TRUE(space.update_largest_acked_packet(ack));
+
+    Duration loss_delay = Duration::from_milliseconds(10);
+    auto lost = detect_lost(space, loss_delay, now);
+    // 2 and 3 are 3 packets behind the largest acknowledged one
+    ASSERT_EQ(lost.size(), 2);
+    // 6 is not lost yet, and 9 was sent after the largest acknowledged
+    EXPECT_EQ(space.loss_time(), now + loss_delay);
+
+    lost = detect_lost(space, loss_delay, now + loss_delay);
+    EXPECT_EQ(lost.size(), 1);
+    EXPECT_TRUE(space.loss_time().is_infinite());
+}
+
+class RecordingHandler : public FrameRecordHandler {
+public:
+    void on_stream_acked(const StreamRecord &record) override {
+        acked.push_back(record.offset);
+    }
+
+    void on_stream_lost(const StreamRecord &record) override {
+        lost.push_back(record.offset);
+    }
+
+    void on_crypto_acked(const CryptoRecord &record) override {
+        acked.push_back(record.offset);
+    }
+
+    void on_crypto_lost(const CryptoRecord &record) override {
+        lost.push_back(record.offset);
+    }
+
+    void on_control_frame_acked(const FrameRecord &record) override {
+        acked.push_back(record.control.value);
+    }
+
+    void on_control_frame_lost(const FrameRecord &record) override {
+        lost.push_back(record.control.value);
+    }
+
+    std::vector<uint64_t> acked;
+    std::vector<uint64_t> lost;
+};
+
+TEST_F(RecoveryTest, FrameRecords) {
+    SentPacketPtr packet = make_packet(now);
+    pool.add_frame(*packet, FrameRecord::stream_frame(4, 100, 1000, true));
+    pool.add_frame(*packet, FrameRecord::crypto_frame(
+        PNSpace::Handshake, 200, 500));
+    pool.add_frame(*packet, FrameRecord::control_frame(
+        FRAME_TYPE_MAX_STREAM_DATA, 4, 300));
+    EXPECT_EQ(pool.frames_in_use(), 3);
+
+    RecordingHandler handler;
+    dispatch_frames(*packet, true, handler);
+    EXPECT_EQ(handler.acked, (std::vector<uint64_t>{300, 200, 100}));
+    dispatch_frames(*packet, false, handler);
+    EXPECT_EQ(handler.lost, handler.acked);
+
+    // the records go back to the pool along with the packet
+    packet.reset();
+    EXPECT_EQ(pool.packets_in_use(), 0);
+    EXPECT_EQ(pool.frames_in_use(), 0);
+}
+
+TEST_F(RecoveryTest, SlabReuse) {
+    Slab<uint64_t, 4> slab;
+    std::vector<uint64_t *> objects;
+    for (uint64_t i = 0; i < 10; i++) {
+        objects.push_back(slab.allocate(i));
+    }
+    EXPECT_EQ(slab.in_use(), 10);
+    EXPECT_EQ(slab.capacity(), 12);
+    for (uint64_t i = 0; i < 10; i++) {
+        EXPECT_EQ(*objects[i], i);
+    }
+
+    // the freed objects are handed out again before the slab grows
+    for (uint64_t *object : objects) {
+        slab.deallocate(object);
+    }
+    objects.clear();
+    for (uint64_t i = 0; i < 12; i++) {
+        objects.push_back(slab.allocate(i));
+    }
+    EXPECT_EQ(slab.capacity(), 12);
+    EXPECT_EQ(slab.in_use(), 12);
+    for (uint64_t *object : objects) {
+        slab.deallocate(object);
+    }
+}
+
+TEST_F(RecoveryTest, RenoPersistentCongestion) {
+    CcReno reno;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration round_trip = Duration::from_milliseconds(100);
+
+    // Lose two packets sent |span| apart, with none acknowledged since.
+    auto lose_span = [&](Duration span) {
+        std::vector<SentPacketPtr> lost;
+        lost.push_back(make_packet(now));
+        reno.on_packet_sent(lost.back());
+        now = now + span;
+        lost.push_back(make_packet(now));
+        reno.on_packet_sent(lost.back());
+        now = now + Duration::from_milliseconds(1);
+        reno.on_packet_lost(now, lost);
+    };
+
+    // no RTT sample yet
+    lose_span(Duration::from_seconds(2));
+    EXPECT_GT(reno.congestion_window(), kMaxDatagramSize * 2);
+
+    run_rounds(reno, rtt, round_trip, 5);
+    size_t window = reno.congestion_window();
+
+    // within three PTOs, a loss only halves the window
+    lose_span(round_trip * 2);
+    EXPECT_EQ(reno.congestion_window(), window / 2);
+
+    lose_span(Duration::from_seconds(2));
+    EXPECT_EQ(reno.congestion_window(), kMaxDatagramSize * 2);
+    EXPECT_EQ(reno.bytes_in_flight(), 0);
+
+    // and slow start begins anew, at once
+    EXPECT_STREQ(reno.state_name(), "slow_start");
+    run_rounds(reno, rtt, round_trip, 1);
+    EXPECT_GT(reno.congestion_window(), kMaxDatagramSize * 2);
+}
+
+TEST_F(RecoveryTest, CubicDecrease) {
+    CcCubic cc;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration round_trip = Duration::from_milliseconds(100);
+
+    // slow start
+    run_rounds(cc, rtt, round_trip, 5);
+    size_t window = cc.congestion_window();
+    EXPECT_GT(window, kMaxDatagramSize * 100);
+
+    lose_packet(cc);
+    EXPECT_EQ(cc.congestion_window(), static_cast<size_t>(window * 0.7));
+
+    // a packet sent before the recovery period started
+    std::vector<SentPacketPtr> lost;
+    lost.push_back(pool.new_packet(now - Duration::from_milliseconds(2),
+                                   kMaxDatagramSize, true, true));
+    cc.on_packet_sent(lost.back());
+    cc.on_packet_lost(now, lost);
+    EXPECT_EQ(cc.congestion_window(), static_cast<size_t>(window * 0.7));
+    EXPECT_EQ(cc.bytes_in_flight(), 0);
+}
+
+TEST_F(RecoveryTest, CubicCwndValidation) {
+    CcCubic cc;
+    RttTime rtt(kDefaultMaxAckDelay);
+    rtt.update_rtt(Duration::from_milliseconds(100), Duration::zero(), now);
+    size_t window = cc.congestion_window();
+
+    // an app-limited sender with a quarter of the window in flight
+    std::vector<SentPacketPtr> acked;
+    RateSample rs;
+    rs.tx_in_flight = window / 4;
+    for (int i = 0; i < 20; i++) {
+        acked.push_back(make_packet(now));
+        cc.on_packet_sent(acked.back());
+        now = now + Duration::from_milliseconds(100);
+        cc.on_rate_sample(now, rs);
+        cc.on_packet_acked(now, rtt, acked);
+        acked.clear();
+    }
+    EXPECT_EQ(cc.congestion_window(), window);
+
+    // half of it in flight validates the window
+    rs.tx_in_flight = window / 2;
+    acked.push_back(make_packet(now));
+    cc.on_packet_sent(acked.back());
+    now = now + Duration::from_milliseconds(100);
+    cc.on_rate_sample(now, rs);
+    cc.on_packet_acked(now, rtt, acked);
+    EXPECT_GT(cc.congestion_window(), window);
+}
+
+// Prague's additive increase and Copa's velocity do not inflate an
+// unused window either.
+TEST_F(RecoveryTest, PragueCopaCwndValidation) {
+    CcPrague prague;
+    CcCopa copa;
+    for (CongestionControl *cc : {static_cast<CongestionControl *>(&prague),
+                                  static_cast<CongestionControl *>(&copa)}) {
+        RttTime rtt(kDefaultMaxAckDelay);
+        rtt.update_rtt(Duration::from_milliseconds(100), Duration::zero(),
+                       now);
+        size_t window = cc->congestion_window();
+
+        std::vector<SentPacketPtr> acked;
+        RateSample rs;
+        rs.tx_in_flight = window / 4;
+        for (int i = 0; i < 20; i++) {
+            acked.push_back(make_packet(now));
+            cc->on_packet_sent(acked.back());
+            now = now + Duration::from_milliseconds(100);
+            cc->on_rate_sample(now, rs);
+            cc->on_packet_acked(now, rtt, acked);
+            acked.clear();
+        }
+        EXPECT_EQ(cc->congestion_window(), window) << cc->name();
+        EXPECT_STREQ(cc->state_name(), "application_limited");
+
+        rs.tx_in_flight = window / 2;
+        acked.push_back(make_packet(now));
+        cc->on_packet_sent(acked.back());
+        now = now + Duration::from_milliseconds(100);
+        cc->on_rate_sample(now, rs);
+        cc->on_packet_acked(now, rtt, acked);
+        EXPECT_GT(cc->congestion_window(), window) << cc->name();
+    }
+}
+
+TEST_F(RecoveryTest, CubicGrowth) {
+    CcCubic cc;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration round_trip = Duration::from_milliseconds(100);
+
+    // grow to more than 1000 datagrams
+    while (cc.congestion_window() < kMaxDatagramSize * 1000) {
+        run_rounds(cc, rtt, round_trip, 1);
+    }
+    lose_packet(cc);
+    size_t w_max = static_cast<size_t>(cc.congestion_window() / 0.7);
+
+    // K = cbrt(W_max * (1 - beta) / C) is about 10 seconds, i.e. 100
+    // rounds. Reno would need more than 600.
+    run_rounds(cc, rtt, round_trip, 85);
+    EXPECT_LT(cc.congestion_window(), w_max);
+    EXPECT_GT(cc.congestion_window(), w_max * 0.95);
+
+    // the plateau around W_max
+    run_rounds(cc, rtt, round_trip, 10);
+    EXPECT_GT(cc.congestion_window(), w_max * 0.97);
+    EXPECT_LT(cc.congestion_window(), w_max * 1.03);
+
+    // and then the convex region: C * (t - K)^3 is about 70 datagrams
+    // after another 5.5 seconds
+    run_rounds(cc, rtt, round_trip, 60);
+    EXPECT_GT(cc.congestion_window(), w_max * 1.04);
+    EXPECT_LT(cc.congestion_window(), w_max * 1.1);
+}
+
+TEST_F(RecoveryTest, CubicRenoFriendly) {
+    CcCubic cubic;
+    CcReno reno;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration round_trip = Duration::from_milliseconds(1);
+
+    // With a short RTT and a small window, CUBIC grows no slower than
+    // Reno would, only from a higher start.
+    run_rounds(cubic, rtt, round_trip, 3);
+    run_rounds(reno, rtt, round_trip, 3);
+    lose_packet(cubic);
+    lose_packet(reno);
+    size_t cubic_window = cubic.congestion_window();
+    size_t reno_window = reno.congestion_window();
+
+    run_rounds(cubic, rtt, round_trip, 20);
+    run_rounds(reno, rtt, round_trip, 20);
+    size_t reno_growth = reno.congestion_window() - reno_window;
+    size_t cubic_growth = cubic.congestion_window() - cubic_window;
+    // alpha = 0.53 datagrams per RTT before W_max is reached, 1 after
+    EXPECT_GE(cubic_growth, reno_growth / 2);
+    EXPECT_GE(cubic.congestion_window(), reno.congestion_window());
+}
+
+TEST_F(RecoveryTest, HyStart) {
+    HyStart hystart;
+    Duration base_rtt = Duration::from_milliseconds(100);
+
+    // one round of |acks| ACKs with |rtt|; the first ACK acknowledges a
+    // packet sent after the previous round started
+    auto round = [&](Duration rtt, size_t acks) {
+        Instant round_start = now;
+        for (size_t i = 0; i < acks; i++) {
+            now = now + Duration::from_milliseconds(1);
+            hystart.on_ack(now, i == 0 ? round_start : round_start - rtt, rtt);
+        }
+    };
+
+    round(base_rtt, 10);
+    round(base_rtt, 10);
+    EXPECT_FALSE(hystart.in_css());
+    EXPECT_EQ(hystart.window_increase(kMaxDatagramSize * 2),
+              kMaxDatagramSize * 2);
+    // at most kBurstLimit datagrams per ACK
+    EXPECT_EQ(hystart.window_increase(kMaxDatagramSize * 100),
+              kMaxDatagramSize * HyStart::kBurstLimit);
+
+    // below the threshold of max(4 ms, 100 ms / 8)
+    round(base_rtt + Duration::from_milliseconds(12), 10);
+    EXPECT_FALSE(hystart.in_css());
+
+    // the delay goes up; not before kNRttSample samples
+    Duration high_rtt = base_rtt + Duration::from_milliseconds(30);
+    round(high_rtt, HyStart::kNRttSample - 1);
+    EXPECT_FALSE(hystart.in_css());
+    round(high_rtt + Duration::from_milliseconds(20), 10);
+    EXPECT_TRUE(hystart.in_css());
+    EXPECT_EQ(hystart.window_increase(kMaxDatagramSize * 4), kMaxDatagramSize);
+
+    // a lower RTT in CSS: back to slow start
+    round(high_rtt, 10);
+    EXPECT_FALSE(hystart.in_css());
+
+    round(high_rtt + Duration::from_milliseconds(20), 10);
+    EXPECT_TRUE(hystart.in_css());
+    for (size_t i = 0; i < HyStart::kCssRounds; i++) {
+        EXPECT_FALSE(hystart.should_exit_slow_start());
+        round(high_rtt + Duration::from_milliseconds(20), 10);
+    }
+    EXPECT_TRUE(hystart.should_exit_slow_start());
+}
+
+TEST_F(RecoveryTest, DeliveryRate) {
+    DeliveryRateSampler sampler;
+    std::vector<SentPacketPtr> packets;
+    size_t bytes_in_flight = 0;
+    Duration min_rtt = Duration::from_milliseconds(10);
+    RateSample rs;
+
+    // A packet every millisecond, each acknowledged 10 ms after it was
+    // sent: 1200 bytes per millisecond once the pipe is full.
+    for (int t = 0; t < 40; t++) {
+        Instant time = now + Duration::from_milliseconds(t);
+        if (t >= 10) {
+            SentPacket &packet = *packets[t - 10];
+            sampler.on_packet_acked(time, packet);
+            bytes_in_flight -= packet.sent_bytes;
+            EXPECT_TRUE(sampler.generate_rate_sample(min_rtt, rs));
+            EXPECT_EQ(rs.rtt, min_rtt);
+            if (t < 20) {
+                // the first packets were sent into an empty pipe
+                EXPECT_LT(rs.delivery_rate, 1200000);
+            } else {
+                EXPECT_EQ(rs.delivery_rate, 1200000);
+                EXPECT_EQ(rs.tx_in_flight, 10 * 1200);
+            }
+        }
+        packets.push_back(make_packet(time));
+        sampler.on_packet_sent(*packets.back(), bytes_in_flight);
+        bytes_in_flight += packets.back()->sent_bytes;
+    }
+    EXPECT_EQ(sampler.delivered(), 30 * 1200);
+
+    // one sample per ACK, however many packets it acknowledges
+    sampler.on_packet_acked(now + Duration::from_milliseconds(40),
+                            *packets[30]);
+    sampler.on_packet_acked(now + Duration::from_milliseconds(40),
+                            *packets[31]);
+    EXPECT_TRUE(sampler.generate_rate_sample(min_rtt, rs));
+    EXPECT_EQ(rs.newly_acked, 2 * 1200);
+    EXPECT_EQ(rs.tx_in_flight, 10 * 1200);
+    EXPECT_FALSE(sampler.generate_rate_sample(min_rtt, rs));
+}
+
+TEST_F(RecoveryTest, BbrModel) {
+    CcBbr bbr;
+    RttTime rtt(kDefaultMaxAckDelay);
+    DeliveryRateSampler sampler;
+    Duration propagation = Duration::from_milliseconds(20);
+    // a bottleneck of 12.8 MB/s
+    Duration transmission = Duration::from_microseconds(100);
+    BottleneckStats stats = run_bottleneck(
+        bbr, rtt, propagation, transmission, Duration::from_seconds(3),
+        &sampler);
+
+    EXPECT_GE(bbr.state(), CcBbr::State::ProbeBwDown);
+    EXPECT_LE(bbr.state(), CcBbr::State::ProbeBwUp);
+    EXPECT_GT(bbr.max_bandwidth(), 12800000 * 0.95);
+    EXPECT_LT(bbr.max_bandwidth(), 12800000 * 1.05);
+    EXPECT_LT(bbr.min_rtt(), propagation + Duration::from_milliseconds(1));
+    // no standing queue after Startup
+    EXPECT_LT(stats.max_rtt, propagation + Duration::from_milliseconds(10));
+}
+
+TEST_F(RecoveryTest, StandingRtt) {
+    RttTime rtt(kDefaultMaxAckDelay);
+    EXPECT_TRUE(rtt.standing_rtt().is_infinite());
+
+    Duration ms = Duration::from_milliseconds(1);
+    rtt.update_rtt(ms * 40, Duration::zero(), now);
+    EXPECT_EQ(rtt.standing_rtt(), ms * 40);
+
+    // the minimum over the last smoothed_rtt / 2
+    now = now + ms * 5;
+    rtt.update_rtt(ms * 30, Duration::zero(), now);
+    now = now + ms * 5;
+    rtt.update_rtt(ms * 50, Duration::zero(), now);
+    EXPECT_EQ(rtt.standing_rtt(), ms * 30);
+
+    now = now + ms * 30;
+    rtt.update_rtt(ms * 45, Duration::zero(), now);
+    EXPECT_EQ(rtt.standing_rtt(), ms * 45);
+    EXPECT_EQ(rtt.min_rtt(), ms * 30);
+}
+
+TEST_F(RecoveryTest, WindowedFilter) {
+    Duration ms = Duration::from_milliseconds(1);
+    WindowedFilter<Duration, std::less_equal<Duration>> min_filter(
+        ms * 100, Duration::infinite(), Instant::zero());
+    EXPECT_TRUE(min_filter.best().is_infinite());
+
+    min_filter.update(ms * 20, now);
+    min_filter.update(ms * 30, now + ms * 30);
+    min_filter.update(ms * 40, now + ms * 60);
+    EXPECT_EQ(min_filter.best(), ms * 20);
+
+    // The minimum expires; the best sample in the window takes over.
+    min_filter.update(ms * 50, now + ms * 110);
+    EXPECT_EQ(min_filter.best(), ms * 30);
+    min_filter.update(ms * 10, now + ms * 120);
+    EXPECT_EQ(min_filter.best(), ms * 10);
+
+    // a maximum over the last 4 round trips; the 7 is dropped, as the
+    // filter keeps only three samples
+    WindowedFilter<uint64_t, std::greater_equal<uint64_t>,
+                   uint64_t, uint64_t> max_filter(4, 0, 0);
+    uint64_t samples[] = {5, 9, 7, 6, 3, 2, 2, 1};
+    uint64_t expected[] = {5, 9, 9, 9, 9, 9, 6, 6};
+    for (uint64_t round = 0; round < 8; round++) {
+        max_filter.update(samples[round], round);
+        EXPECT_EQ(max_filter.best(), expected[round]) << round;
+    }
+}
+
+TEST_F(RecoveryTest, MinRttExpiry) {
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration ms = Duration::from_milliseconds(1);
+    rtt.update_rtt(ms * 20, Duration::zero(), now);
+
+    // The path becomes longer; the old minimum goes after the window.
+    for (int i = 1; i <= 12; i++) {
+        now = now + Duration::from_seconds(1);
+        rtt.update_rtt(ms * 80, Duration::zero(), now);
+    }
+    EXPECT_EQ(rtt.min_rtt(), ms * 80);
+}
+
+TEST_F(RecoveryTest, RttHistogram) {
+    for (uint64_t us : {0, 1, 15, 16, 31, 32, 33, 1000, 123456789}) {
+        size_t index = RttHistogram::bucket_index(us);
+        EXPECT_LE(RttHistogram::bucket_lower_bound(index), us) << us;
+        EXPECT_GT(RttHistogram::bucket_lower_bound(index + 1), us) << us;
+    }
+    // within 1 / 16 of the value
+    EXPECT_EQ(RttHistogram::bucket_lower_bound(
+        RttHistogram::bucket_index(1000)), 992);
+    EXPECT_EQ(RttHistogram::bucket_index(uint64_t(1) << 40),
+              RttHistogram::kNumBuckets - 1);
+
+    RttHistogram histogram;
+    RttTime rtt(kDefaultMaxAckDelay);
+    rtt.set_histogram(&histogram);
+    EXPECT_EQ(histogram.percentile(0.5), Duration::zero());
+
+    Duration ms = Duration::from_milliseconds(1);
+    for (int i = 1; i <= 100; i++) {
+        rtt.update_rtt(ms * i, Duration::zero(), now);
+    }
+    EXPECT_EQ(histogram.count(), 100u);
+    Duration p50 = histogram.percentile(0.5);
+    EXPECT_GT(p50, ms * 50);
+    EXPECT_LE(p50, ms * 50 + (ms * 50 >> 4));
+    Duration p99 = histogram.percentile(0.99);
+    EXPECT_GT(p99, ms * 99);
+    EXPECT_LE(p99, ms * 99 + (ms * 99 >> 4));
+}
+
+TEST_F(RecoveryTest, CopaModel) {
+    CcCopa copa;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration propagation = Duration::from_milliseconds(20);
+    // a bottleneck of 12.8 MB/s with an unlimited queue
+    Duration transmission = Duration::from_microseconds(100);
+    BottleneckStats stats = run_bottleneck(
+        copa, rtt, propagation, transmission, Duration::from_seconds(5));
+
+    EXPECT_FALSE(copa.competitive_mode());
+    // a queue of a few milliseconds at most, at nearly the link rate
+    EXPECT_LT(stats.max_rtt, propagation + Duration::from_milliseconds(5));
+    EXPECT_GT(stats.delivered, 10000 * 0.8);
+}
+
+TEST_F(RecoveryTest, CopaCompetitive) {
+    CcCopa copa;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration base = Duration::from_milliseconds(20);
+    rtt.update_rtt(base, Duration::zero(), now);
+
+    // a queue of 20 ms that never drains, as left by loss-based flows
+    run_rounds(copa, rtt, base * 2, 4);
+    EXPECT_FALSE(copa.competitive_mode());
+    run_rounds(copa, rtt, base * 2, 4);
+    EXPECT_TRUE(copa.competitive_mode());
+
+    // 1 / delta grows by one every RTT without loss and halves on loss
+    double delta = copa.delta();
+    EXPECT_LT(delta, 0.5);
+    run_rounds(copa, rtt, base * 2, 1);
+    EXPECT_DOUBLE_EQ(1 / copa.delta(), 1 / delta + 1);
+    delta = copa.delta();
+    lose_packet(copa);
+    EXPECT_DOUBLE_EQ(copa.delta(), delta * 2);
+    lose_packet(copa);
+    EXPECT_DOUBLE_EQ(copa.delta(), delta * 2);
+
+    // back to the default mode once the queue drains
+    run_rounds(copa, rtt, base, 2);
+    EXPECT_FALSE(copa.competitive_mode());
+    EXPECT_DOUBLE_EQ(copa.delta(), 0.5);
+}
+
+TEST_F(RecoveryTest, EcnCounts) {
+    LossRecoverySpace space;
+    AckFrame ack = make_ack({{0, 9}});
+    ack.is_ECN = true;
+    ack.ECT0_count = 0;
+    ack.ECT1_count = 8;
+    ack.ECN_CE_count = 2;
+    EcnCounts newly = space.update_ecn_counts(ack);
+    EXPECT_EQ(newly.ect1, 8u);
+    EXPECT_EQ(newly.ce, 2u);
+
+    ack.ECT1_count = 12;
+    ack.ECN_CE_count = 3;
+    newly = space.update_ecn_counts(ack);
+    EXPECT_EQ(newly.ect1, 4u);
+    EXPECT_EQ(newly.ce, 1u);
+
+    // an ACK frame arriving out of order
+    ack.ECT1_count = 10;
+    ack.ECN_CE_count = 2;
+    newly = space.update_ecn_counts(ack);
+    EXPECT_EQ(newly.ect1, 0u);
+    EXPECT_EQ(newly.ce, 0u);
+}
+
+TEST_F(RecoveryTest, EcnValidation) {
+    LossRecoverySpace space;
+    for (uint64_t pn = 0; pn < 10; pn++) {
+        SentPacketPtr packet = make_packet(now);
+        packet->ecn = EcnCodepoint::Ect0;
+        space.on_ecn_packet_sent(packet->ecn);
+        space.on_packet_sent(pn, std::move(packet));
+    }
+
+    // two of the first four marked CE
+    AckFrame ack = make_ack({{0, 3}});
+    ack.is_ECN = true;
+    ack.ECT0_count = 2;
+    ack.ECT1_count = 0;
+    ack.ECN_CE_count = 2;
+    std::vector<SentPacketPtr> acked = detect_acked(space, ack);
+    EcnCounts newly;
+    EXPECT_TRUE(space.validate_ecn_counts(ack, acked, newly));
+    EXPECT_EQ(newly.ect0, 2u);
+    EXPECT_EQ(newly.ce, 2u);
+
+    // a mark lost on the path: two packets acknowledged, one counted
+    ack = make_ack({{0, 5}});
+    ack.is_ECN = true;
+    ack.ECT0_count = 3;
+    ack.ECT1_count = 0;
+    ack.ECN_CE_count = 2;
+    acked = detect_acked(space, ack);
+    EXPECT_FALSE(space.validate_ecn_counts(ack, acked, newly));
+
+    // ECT(0) rewritten into ECT(1)
+    ack = make_ack({{0, 7}});
+    ack.is_ECN = true;
+    ack.ECT0_count = 4;
+    ack.ECT1_count = 1;
+    ack.ECN_CE_count = 2;
+    acked = detect_acked(space, ack);
+    EXPECT_FALSE(space.validate_ecn_counts(ack, acked, newly));
+
+    // no counts at all
+    ack = make_ack({{0, 9}});
+    ack.is_ECN = false;
+    acked = detect_acked(space, ack);
+    EXPECT_FALSE(space.validate_ecn_counts(ack, acked, newly));
+}
+
+TEST_F(RecoveryTest, CubicEcn) {
+    CcCubic cc;
+    RttTime rtt(kDefaultMaxAckDelay);
+    EXPECT_EQ(cc.ecn_codepoint(), EcnCodepoint::Ect0);
+    run_rounds(cc, rtt, Duration::from_milliseconds(100), 5);
+    size_t window = cc.congestion_window();
+
+    // no reaction to ECT counts alone
+    cc.on_ecn_counts(now, EcnCounts{10, 0, 0}, now);
+    EXPECT_EQ(cc.congestion_window(), window);
+
+    now = now + Duration::from_milliseconds(1);
+    cc.on_ecn_counts(now, EcnCounts{8, 0, 2},
+                     now - Duration::from_microseconds(500));
+    EXPECT_EQ(cc.congestion_window(), static_cast<size_t>(window * 0.7));
+
+    // a mark on a packet sent before the recovery period started
+    cc.on_ecn_counts(now, EcnCounts{0, 0, 1},
+                     now - Duration::from_microseconds(500));
+    EXPECT_EQ(cc.congestion_window(), static_cast<size_t>(window * 0.7));
+}
+
+TEST_F(RecoveryTest, PragueReduction) {
+    CcPrague prague;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration base = Duration::from_milliseconds(20);
+    rtt.update_rtt(base, Duration::zero(), now);
+    EXPECT_EQ(prague.ecn_codepoint(), EcnCodepoint::Ect1);
+
+    // slow start ends with a halving on the first mark, at a window
+    // grown by all but the marked packet
+    run_rounds(prague, rtt, base, 2);
+    size_t window = prague.congestion_window();
+    run_ecn_round(prague, rtt, base, 1);
+    EXPECT_EQ(prague.congestion_window(), (window * 2 - kMaxDatagramSize) / 2);
+
+    // a loss of a packet sent after the reduction halves it again
+    window = prague.congestion_window();
+    now = now + Duration::from_milliseconds(1);
+    lose_packet(prague);
+    EXPECT_EQ(prague.congestion_window(), window / 2);
+
+    // alpha follows the fraction of marks per round trip
+    for (int i = 0; i < 100; i++) {
+        run_ecn_round(prague, rtt, base, 1);
+    }
+    double fraction = static_cast<double>(kMaxDatagramSize)
+        / prague.congestion_window();
+    EXPECT_LT(prague.alpha(), fraction * 2);
+    EXPECT_GT(prague.alpha(), fraction / 2);
+
+    // the reduction is proportional to alpha
+    window = prague.congestion_window();
+    double alpha = prague.alpha();
+    run_ecn_round(prague, rtt, base, 1);
+    EXPECT_NEAR(prague.congestion_window(), window * (1 - alpha / 2),
+                kMaxDatagramSize * 2);
+    EXPECT_FALSE(prague.classic_fallback());
+}
+
+TEST_F(RecoveryTest, PragueClassicFallback) {
+    CcPrague prague;
+    RttTime rtt(kDefaultMaxAckDelay);
+    Duration base = Duration::from_milliseconds(20);
+    rtt.update_rtt(base, Duration::zero(), now);
+
+    // marks at a queue of 10 ms, as a classic AQM does
+    for (int i = 0; i < 10; i++) {
+        run_ecn_round(prague, rtt, base + Duration::from_milliseconds(10), 1);
+    }
+    EXPECT_TRUE(prague.classic_fallback());
+    for (int i = 0; i < 10; i++) {
+        run_ecn_round(prague, rtt, base + Duration::from_milliseconds(10), 0);
+    }
+    size_t window = prague.congestion_window();
+    run_ecn_round(prague, rtt, base + Duration::from_milliseconds(10), 1);
+    EXPECT_NEAR(prague.congestion_window(), window / 2, kMaxDatagramSize);
+
+    // and back to scalable once marks come at a shallow queue
+    for (int i = 0; i < 20; i++) {
+        run_ecn_round(prague, rtt, base, 1);
+    }
+    EXPECT_FALSE(prague.classic_fallback());
+}
+
+TEST_F(RecoveryTest, Pacer) {
+    AlarmManager alarms;
+    size_t can_send = 0;
+    Pacer pacer(alarms, [&](Instant) { can_send += 1; },
+                4 * kMaxDatagramSize);
+
+    // no pacing without a rate
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(pacer.can_send(now));
+        pacer.on_packet_sent(now, kMaxDatagramSize);
+    }
+
+    // a datagram every millisecond, after a burst of the allowance
+    pacer.set_rate(now, kMaxDatagramSize * 1000);
+    now = now + Duration::from_seconds(1);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(pacer.can_send(now));
+        pacer.on_packet_sent(now, kMaxDatagramSize);
+    }
+    EXPECT_FALSE(pacer.can_send(now));
+    EXPECT_EQ(alarms.next_deadline(), now + Duration::from_milliseconds(1));
+
+    now = now + Duration::from_microseconds(500);
+    alarms.fire(now);
+    EXPECT_EQ(can_send, 0u);
+    EXPECT_FALSE(pacer.can_send(now));
+
+    now = now + Duration::from_microseconds(500);
+    alarms.fire(now);
+    EXPECT_EQ(can_send, 1u);
+    EXPECT_TRUE(pacer.can_send(now));
+    pacer.on_packet_sent(now, kMaxDatagramSize);
+    EXPECT_EQ(pacer.next_send_time(now), now + Duration::from_milliseconds(1));
+
+    // a faster rate moves the alarm
+    EXPECT_FALSE(pacer.can_send(now));
+    pacer.set_rate(now, kMaxDatagramSize * 2000);
+    EXPECT_EQ(alarms.next_deadline(), now + Duration::from_microseconds(500));
+}
+
+// Sends the probes through the LossRecovery and records what was asked
+// for: 'n' new data, the offset of a retransmitted stream frame, 'p' PING
+// and 'd' anti-deadlock.
+class RecordingProbeSender : public ProbeSender {
+public:
+    RecordingProbeSender(LossRecovery &recovery, Instant &now)
+        : recovery(recovery), now(now) {}
+
+    bool send_new_data_probe(PNSpace space) override {
+        if (new_data == 0) {
+            return false;
+        }
+        new_data -= 1;
+        send(space, FRAME_TYPE_STREAM);
+        probes.push_back('n');
+        return true;
+    }
+
+    void send_retransmission_probe(PNSpace space,
+                                   const SentPacket &packet) override {
+        send(space, FRAME_TYPE_STREAM);
+        probes.push_back(packet.frames->stream.offset);
+    }
+
+    void send_ping_probe(PNSpace space) override {
+        send(space, FRAME_TYPE_PING);
+        probes.push_back('p');
+    }
+
+    void send_anti_deadlock_probe() override {
+        send(PNSpace::Initial, FRAME_TYPE_PING);
+        probes.push_back('d');
+    }
+
+    // send an ack-eliciting packet with one frame of |type| in |space|
+    void send(PNSpace space, FrameType type, uint64_t offset = 0) {
+        SentPacketPtr packet = recovery.pool().new_packet(
+            now, kMaxDatagramSize, true, true);
+        if (type == FRAME_TYPE_STREAM) {
+            recovery.pool().add_frame(
+                *packet, FrameRecord::stream_frame(0, offset, 1000, false));
+        } else {
+            recovery.pool().add_frame(
+                *packet, FrameRecord::control_frame(type));
+        }
+        SentPacket *sent = packet.get();
+        recovery.on_packet_sent(space, next_pn[static_cast<size_t>(space)]++,
+                                std::move(packet));
+        probe_flags.push_back(sent->pto);
+    }
+
+    LossRecovery &recovery;
+    Instant &now;
+    size_t new_data = 0;
+    uint64_t next_pn[kNumOfPNSpaces] = {0, 0, 0};
+    std::vector<uint64_t> probes;
+    std::vector<bool> probe_flags;
+};
+
+TEST_F(RecoveryTest, PtoProbes) {
+    AlarmManager alarms;
+    LossRecovery recovery(alarms, std::make_unique<CcReno>(), true);
+    RecordingProbeSender sender(recovery, now);
+    recovery.set_probe_sender(&sender);
+    recovery.set_handshake_complete(now);
+    EXPECT_TRUE(alarms.next_deadline().is_infinite());
+
+    sender.send(PNSpace::Application, FRAME_TYPE_PING);
+    sender.send(PNSpace::Application, FRAME_TYPE_STREAM, 1000);
+    sender.send(PNSpace::Application, FRAME_TYPE_STREAM, 2000);
+
+    // no RTT sample yet: 333ms + 4 * 166.5ms + max_ack_delay
+    Duration pto = Duration::from_milliseconds(1024);
+    EXPECT_EQ(alarms.next_deadline(), now + pto);
+
+    // new data first, then the oldest data unacknowledged
+    sender.new_data = 1;
+    now = now + pto;
+    alarms.fire(now);
+    EXPECT_EQ(sender.probes, (std::vector<uint64_t>{'n', 1000}));
+    EXPECT_EQ(recovery.pto_count(), 1u);
+    EXPECT_TRUE(sender.probe_flags.back());
+    EXPECT_EQ(alarms.next_deadline(), now + 2 * pto);
+
+    // no more new data; the PTO backs off
+    sender.probes.clear();
+    now = now + 2 * pto;
+    alarms.fire(now);
+    EXPECT_EQ(sender.probes, (std::vector<uint64_t>{1000, 2000}));
+    EXPECT_EQ(recovery.pto_count(), 2u);
+    EXPECT_EQ(alarms.next_deadline(), now + 4 * pto);
+
+    // An ACK resets the PTO; nothing left to probe for.
+    AckFrame ack = make_ack({{0, 6}});
+    recovery.on_ack_received(PNSpace::Application, ack, now);
+    EXPECT_EQ(recovery.pto_count(), 0u);
+    EXPECT_TRUE(alarms.next_deadline().is_infinite());
+
+    // PING if nothing else
+    sender.send(PNSpace::Application, FRAME_TYPE_PING);
+    sender.probes.clear();
+    alarms.fire(alarms.next_deadline());
+    EXPECT_EQ(sender.probes, (std::vector<uint64_t>{'p', 'p'}));
+}
+
+TEST_F(RecoveryTest, AntiDeadlockProbe) {
+    AlarmManager alarms;
+    LossRecovery recovery(alarms, std::make_unique<CcReno>(), false);
+    RecordingProbeSender sender(recovery, now);
+    recovery.set_probe_sender(&sender);
+
+    // The Initial is acknowledged, but the server may not have validated
+    // the address of the client yet.
+    sender.send(PNSpace::Initial, FRAME_TYPE_CRYPTO);
+    AckFrame ack = make_ack({{0, 0}});
+    now = now + Duration::from_milliseconds(50);
+    recovery.on_ack_received(PNSpace::Initial, ack, now);
+    EXPECT_FALSE(alarms.next_deadline().is_infinite());
+
+    alarms.fire(alarms.next_deadline());
+    EXPECT_EQ(sender.probes, (std::vector<uint64_t>{'d'}));
+    EXPECT_EQ(recovery.pto_count(), 1u);
+
+    // a Handshake ACK validates the address
+    sender.send(PNSpace::Handshake, FRAME_TYPE_CRYPTO);
+    ack = make_ack({{0, 0}});
+    recovery.on_ack_received(PNSpace::Handshake, ack, now);
+    ack = make_ack({{1, 1}});
+    recovery.on_ack_received(PNSpace::Initial, ack, now);
+    EXPECT_EQ(recovery.pto_count(), 0u);
+    EXPECT_TRUE(alarms.next_deadline().is_infinite());
+}
+
+TEST_F(RecoveryTest, CongestionControlRegistry) {
+    CongestionControlRegistry &registry = CongestionControlRegistry::instance();
+    for (const char *name : {"reno", "cubic", "bbr", "copa", "prague"}) {
+        unique_ptr<CongestionControl> cc = registry.create(name);
+        EXPECT_STREQ(cc->name(), name);
+    }
+    EXPECT_THROW(registry.create("vegas"), std::invalid_argument);
+
+    // a controller of the application, under a name of its own
+    EXPECT_TRUE(registry.add("copa 5ms", [] {
+        return std::make_unique<CcCopa>(Duration::from_milliseconds(5));
+    }));
+    EXPECT_FALSE(registry.add("cubic", [] {
+        return std::make_unique<CcReno>();
+    }));
+    EXPECT_TRUE(registry.contains("copa 5ms"));
+
+    // per connection, through the config
+    AlarmManager alarms;
+    QuicConfig config;
+    EXPECT_EQ(config.congestion_control, "cubic");
+    config.congestion_control = "reno";
+    LossRecovery recovery(alarms, config, true);
+    CongestionControlInfo info = recovery.cc_info();
+    EXPECT_STREQ(info.name, "reno");
+    EXPECT_STREQ(info.state, "slow_start");
+    EXPECT_EQ(info.bytes_in_flight, 0u);
+    EXPECT_EQ(info.pacing_rate, 0u);
+
+    std::ostringstream os;
+    os << info;
+    EXPECT_EQ(os.str(), "reno slow_start 0/12800 pacing 0");
+}
+
+TEST_F(RecoveryTest, CongestionControlInfo) {
+    RttTime rtt(kDefaultMaxAckDelay);
+    CcCubic cubic;
+    run_rounds(cubic, rtt, Duration::from_milliseconds(100), 2);
+    CongestionControlInfo info = cubic.info(rtt);
+    EXPECT_STREQ(info.state, "slow_start");
+    EXPECT_EQ(info.congestion_window, cubic.congestion_window());
+    // 1.25 windows per smoothed RTT
+    EXPECT_EQ(info.pacing_rate, cubic.congestion_window() * 125 / 10);
+
+    lose_packet(cubic);
+    EXPECT_STREQ(cubic.info(rtt).state, "congestion_avoidance");
+
+    CcBbr bbr;
+    EXPECT_STREQ(bbr.info(rtt).state, "startup");
+}
@@ -0,0 +1,82 @@
+//
+// Created by Chengke Wong on 2020/5/31.
+//
+
+#include "recovery/rtt_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t RttHistogram::kSubBucketBits;
+constexpr size_t RttHistogram::kSubBuckets;
+constexpr size_t RttHistogram::kMaxExponent;
+constexpr size_t RttHistogram::kNumBuckets;
+
+RttHistogram::RttHistogram()
+    : count_(0) {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RttHistogram::record(Duration rtt) {
+    int64_t us = std::max<int64_t>(rtt.to_microseconds(), 0);
+    std::atomic<uint64_t> &bucket = buckets_[bucket_index(us)];
+    // A single writer: a load and a store are enough, and cheaper than a
+    // read-modify-write.
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+}
+
+size_t RttHistogram::bucket_index(uint64_t microseconds) {
+    if (microseconds < kSubBuckets) {
+        return microseconds;
+    }
+    // the exponent of the most significant bit, at least kSubBucketBits
+    size_t exponent = 63 - __builtin_clzll(microseconds);
+    if (exponent >= kMaxExponent) {
+        return kNumBuckets - 1;
+    }
+    size_t shift = exponent - kSubBucketBits;
+    // the kSubBucketBits bits after the most significant one pick the
+    // bucket within the power of two
+    return shift * kSubBuckets + (microseconds >> shift);
+}
+
+uint64_t RttHistogram::bucket_lower_bound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    size_t shift = index / kSubBuckets - 1;
+    return static_cast<uint64_t>(index - shift * kSubBuckets) << shift;
+}
+
+Duration RttHistogram::percentile(double quantile) const {
+    uint64_t total = 0;
+    uint64_t counts[kNumBuckets];
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        counts[i] = bucket_count(i);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return Duration::zero();
+    }
+
+    // the rank of the sample at |quantile|, 1-based
+    uint64_t rank = static_cast<uint64_t>(std::ceil(
+        std::min(std::max(quantile, 0.0), 1.0) * total));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = i + 1 < kNumBuckets
+                ? bucket_lower_bound(i + 1) : bucket_lower_bound(i);
+            return Duration::from_microseconds(upper);
+        }
+    }
+    return Duration::from_microseconds(bucket_lower_bound(kNumBuckets - 1));
+}
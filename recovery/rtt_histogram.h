@@ -0,0 +1,81 @@
+//
+// Created by Chengke Wong on 2020/5/31.
+//
+
+#ifndef RECOVERY_RTT_HISTOGRAM_H
+#define RECOVERY_RTT_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "util/instant.h"
+
+// The distribution of the RTT samples of a connection, for monitoring;
+// see RttTime::set_histogram().
+//
+// The buckets are log-linear, as in HdrHistogram: each power of two of
+// microseconds is split into kSubBuckets buckets of equal width, so a
+// sample is placed within 1 / kSubBuckets of its value, from 1us up to
+// about 19 hours.
+//
+// The connection records the samples, and any other thread may read the
+// distribution at the same time without a lock. The counts are relaxed
+// atomics: a reader sees every sample eventually, but maybe not all the
+// samples of the same ACK at once.
+//
+//     RttHistogram histogram;
+//     rtt_time.set_histogram(&histogram);
+//     ...
+//     // on another thread
+//     Duration p99 = histogram.percentile(0.99);
+class RttHistogram {
+
+public:
+
+    static constexpr size_t kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+
+    // the samples of 2^kMaxExponent us or more go into the last bucket
+    static constexpr size_t kMaxExponent = 36;
+
+    static constexpr size_t kNumBuckets =
+        (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    RttHistogram();
+
+    // Only one thread may record the samples.
+    void record(Duration rtt);
+
+    // the number of samples recorded
+    inline uint64_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t bucket_count(size_t index) const {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+
+    // the smallest value of the bucket |index|, in microseconds
+    static uint64_t bucket_lower_bound(size_t index);
+
+    static size_t bucket_index(uint64_t microseconds);
+
+    // The smallest bucket bound below which a |quantile| (0 to 1) of the
+    // samples lie, i.e. a value at most one bucket above the quantile;
+    // zero without samples.
+    Duration percentile(double quantile) const;
+
+    // disallow copy and assignment
+    RttHistogram (const RttHistogram&) = delete;
+    RttHistogram& operator= (const RttHistogram&) = delete;
+
+private:
+
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+
+    std::atomic<uint64_t> count_;
+
+};
+
+#endif //RECOVERY_RTT_HISTOGRAM_H
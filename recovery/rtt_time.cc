@@ -7,13 +7,26 @@
 #include <algorithm>
 
 #include "common/config.h"
+#include "recovery/rtt_histogram.h"
 #include "util/utility.h"
 
+constexpr Duration RttTime::kMinRttWindow;
+
 // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-estimating-smoothed_rtt-and
-void RttTime::update_rtt(Duration rtt_sample, Duration ack_delay) {
+void RttTime::update_rtt(Duration rtt_sample, Duration ack_delay,
+                         Instant now) {
     latest_rtt_ = rtt_sample;
 
-    min_rtt_ = std::min(min_rtt_, rtt_sample);
+    min_rtt_.update(rtt_sample, now);
+    if (histogram_ != nullptr) {
+        histogram_->record(rtt_sample);
+    }
+
+    while (!standing_rtts_.empty() &&
+           standing_rtts_.back().rtt >= rtt_sample) {
+        standing_rtts_.pop_back();
+    }
+    standing_rtts_.push_back(RttSample{now, rtt_sample});
 
     // smoothed_rtt and rttvar are computed as follows, similar to [RFC6298].
     if (no_samples_) {
@@ -23,7 +36,7 @@ void RttTime::update_rtt(Duration rtt_sample, Duration ack_delay) {
         rttvar_ = rtt_sample >> 1;
     } else {
         ack_delay = std::min(ack_delay, max_ack_delay_);
-        if (min_rtt_ + ack_delay < rtt_sample) {
+        if (min_rtt_.best() + ack_delay < rtt_sample) {
             rtt_sample = rtt_sample - ack_delay;
         }
 
@@ -31,6 +44,11 @@ void RttTime::update_rtt(Duration rtt_sample, Duration ack_delay) {
         Duration rttvar_sample = (smoothed_rtt_ - rtt_sample).abs();
         rttvar_ = (rttvar_ * 3 + rttvar_sample) >> 2;
     }
+
+    Instant window_start = now - (smoothed_rtt_ >> 1);
+    while (standing_rtts_.front().time < window_start) {
+        standing_rtts_.pop_front();
+    }
 }
 
 Duration RttTime::loss_delay() {
@@ -44,7 +62,11 @@ Duration RttTime::loss_delay() {
     return std::max(kTimerGranularity, result);
 }
 
-Duration RttTime::pto() {
+Duration RttTime::pto() const {
+    if (no_samples_) {
+        // smoothed_rtt = kInitialRtt, rttvar = kInitialRtt / 2
+        return kInitialRtt + 4 * (kInitialRtt >> 1) + max_ack_delay_;
+    }
     return smoothed_rtt_ 
         + std::max(4 * rttvar_, kTimerGranularity) 
         + max_ack_delay_;
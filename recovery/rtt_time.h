@@ -5,31 +5,184 @@
 #ifndef RTT_TIME_H
 #define RTT_TIME_H
 
+#include <deque>
+#include <functional>
+
 #include "util/instant.h"
 
+class RttHistogram;
+
+// Kathleen Nichols' algorithm for tracking the minimum (or maximum) of a
+// signal over a sliding window, as in Linux lib/win_minmax.c. It keeps
+// the best, second best and third best samples of the window, each
+// newer than the one before, so the estimate is exact when the window
+// holds a better sample, and otherwise within a quarter of the window.
+// It takes constant time and space per sample.
+//
+// |Compare|(a, b) is true if |a| is as good as |b| or better, e.g.
+// std::less_equal for a minimum. The time may be an Instant, with a
+// Duration as the window, or a round trip count:
+//
+//     WindowedFilter<uint64_t, std::greater_equal<uint64_t>,
+//                    uint64_t, uint64_t> max_bw(10, 0, 0);
+//     max_bw.update(delivery_rate, round_count);
+template <typename T, typename Compare,
+          typename TimeT = Instant, typename TimeDeltaT = Duration>
+class WindowedFilter {
+
+public:
+
+    // |zero_value| is the estimate before the first sample, worse than
+    // any sample
+    WindowedFilter(TimeDeltaT window_length, T zero_value, TimeT zero_time)
+        : window_length_(window_length),
+          zero_value_(zero_value),
+          estimates_{Sample{zero_value, zero_time},
+                     Sample{zero_value, zero_time},
+                     Sample{zero_value, zero_time}}
+        {}
+
+    // |now| must not go backwards
+    void update(T sample, TimeT now) {
+        Compare better;
+        if (estimates_[0].sample == zero_value_ ||
+            better(sample, estimates_[0].sample) ||
+            now - estimates_[2].time > window_length_) {
+            reset(sample, now);
+            return;
+        }
+
+        if (better(sample, estimates_[1].sample)) {
+            estimates_[1] = Sample{sample, now};
+            estimates_[2] = estimates_[1];
+        } else if (better(sample, estimates_[2].sample)) {
+            estimates_[2] = Sample{sample, now};
+        }
+
+        // The best sample has expired; the second and third best move
+        // up, and the new sample takes the third place.
+        if (now - estimates_[0].time > window_length_) {
+            estimates_[0] = estimates_[1];
+            estimates_[1] = estimates_[2];
+            estimates_[2] = Sample{sample, now};
+            if (now - estimates_[0].time > window_length_) {
+                estimates_[0] = estimates_[1];
+                estimates_[1] = estimates_[2];
+            }
+            return;
+        }
+
+        // A quarter of the window has passed without a better second
+        // sample; take one from the second quarter.
+        if (estimates_[1].sample == estimates_[0].sample &&
+            now - estimates_[1].time > (window_length_ >> 2)) {
+            estimates_[1] = Sample{sample, now};
+            estimates_[2] = estimates_[1];
+            return;
+        }
+
+        // likewise for the third one after half of the window
+        if (estimates_[2].sample == estimates_[1].sample &&
+            now - estimates_[2].time > (window_length_ >> 1)) {
+            estimates_[2] = Sample{sample, now};
+        }
+    }
+
+    // forget the samples so far, and start over with |sample|
+    void reset(T sample, TimeT now) {
+        estimates_[0] = Sample{sample, now};
+        estimates_[1] = estimates_[0];
+        estimates_[2] = estimates_[0];
+    }
+
+    // the best sample of the window, |zero_value| before the first one
+    inline T best() const {
+        return estimates_[0].sample;
+    }
+
+    inline TimeDeltaT window_length() const {
+        return window_length_;
+    }
+
+    inline void set_window_length(TimeDeltaT window_length) {
+        window_length_ = window_length;
+    }
+
+private:
+
+    struct Sample {
+        T sample;
+        TimeT time;
+    };
+
+    TimeDeltaT window_length_;
+
+    T zero_value_;
+
+    // best, second best and third best, oldest first
+    Sample estimates_[3];
+
+};
+
 // Estimating the Round-Trip Time
 // This class is not for generating RTT samples
 class RttTime {
 
 public: 
 
+    // The window of min_rtt. The minimum expires, so that it follows
+    // the path when a route change makes it longer.
+    static constexpr Duration kMinRttWindow = Duration::from_seconds(10);
+
     RttTime(Duration max_ack_delay) 
         : latest_rtt_(Duration::zero()),
           max_ack_delay_(max_ack_delay),
-          min_rtt_(Duration::infinite()),
+          min_rtt_(kMinRttWindow, Duration::infinite(), Instant::zero()),
           smoothed_rtt_(Duration::zero()),
           rttvar_(Duration::zero()),
-          no_samples_(true)
+          no_samples_(true),
+          histogram_(nullptr)
         {}
 
-    // |ack_delay| is carried in the ACK frame
-    void update_rtt(Duration rtt_sample, Duration ack_delay);
+    // |ack_delay| is carried in the ACK frame; |now| is the time the
+    // sample is taken
+    void update_rtt(Duration rtt_sample, Duration ack_delay, Instant now);
 
     // Time Threshold for loss detection
     // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-time-threshold
     Duration loss_delay();
 
-    Duration pto();
+    Duration pto() const;
+
+    inline Duration latest_rtt() const {
+        return latest_rtt_;
+    }
+
+    // the minimum RTT sample over the last kMinRttWindow, infinite
+    // before the first sample
+    inline Duration min_rtt() const {
+        return min_rtt_.best();
+    }
+
+    inline Duration smoothed_rtt() const {
+        return smoothed_rtt_;
+    }
+
+    // the minimum RTT sample over the last smoothed_rtt / 2, infinite
+    // before the first sample. Unlike smoothed_rtt, it filters out the
+    // noise of ACK compression and delayed ACKs without lagging behind a
+    // growing queue.
+    // https://www.usenix.org/conference/nsdi18/presentation/arun
+    inline Duration standing_rtt() const {
+        return standing_rtts_.empty()
+            ? Duration::infinite() : standing_rtts_.front().rtt;
+    }
+
+    // Record the RTT samples into |histogram| as well, if not null; it
+    // must outlive this object.
+    inline void set_histogram(RttHistogram *histogram) {
+        histogram_ = histogram;
+    }
 
     RttTime (RttTime&&) = default;
     RttTime& operator= (RttTime&&) = default;
@@ -49,11 +202,11 @@ private:
     //
     // min_rtt is set to the latest_rtt on the first RTT sample, 
     // and to the lesser of min_rtt and latest_rtt on subsequent 
-    // samples.
+    // samples, within kMinRttWindow.
     // 
     // min_rtt is used by loss detection to reject implausibly 
     // small rtt samples.
-    Duration min_rtt_;
+    WindowedFilter<Duration, std::less_equal<Duration>> min_rtt_;
 
     // an exponentially-weighted moving average of an endpoint's 
     // RTT samples
@@ -65,6 +218,17 @@ private:
 
     bool no_samples_;
 
+    struct RttSample {
+        Instant time;
+        Duration rtt;
+    };
+
+    // the samples of the standing RTT window that may still become its
+    // minimum: increasing in both time and RTT
+    std::deque<RttSample> standing_rtts_;
+
+    RttHistogram *histogram_;
+
 };
 
 #endif
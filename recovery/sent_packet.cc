@@ -0,0 +1,45 @@
+//
+// Created by Chengke Wong on 2020/5/23.
+//
+
+#include "recovery/sent_packet.h"
+
+void SentPacketPool::release(SentPacket *packet) {
+    FrameRecord *record = packet->frames;
+    while (record != nullptr) {
+        FrameRecord *next = record->next;
+        records_.deallocate(record);
+        record = next;
+    }
+    packets_.deallocate(packet);
+}
+
+void dispatch_frames(const SentPacket &packet, bool acked,
+                     FrameRecordHandler &handler) {
+    for (const FrameRecord *record = packet.frames; record != nullptr;
+         record = record->next) {
+        switch (record->type) {
+            case FRAME_TYPE_STREAM:
+                if (acked) {
+                    handler.on_stream_acked(record->stream);
+                } else {
+                    handler.on_stream_lost(record->stream);
+                }
+                break;
+            case FRAME_TYPE_CRYPTO:
+                if (acked) {
+                    handler.on_crypto_acked(record->crypto);
+                } else {
+                    handler.on_crypto_lost(record->crypto);
+                }
+                break;
+            default:
+                if (acked) {
+                    handler.on_control_frame_acked(*record);
+                } else {
+                    handler.on_control_frame_lost(*record);
+                }
+                break;
+        }
+    }
+}
@@ -5,14 +5,51 @@
 #ifndef SENT_PACKET_H
 #define SENT_PACKET_H
 
+#include "common/quic_types.h"
 #include "util/instant.h"
-#include "recovery/recovery_token.h"
+#include "util/slab.h"
+#include "recovery/frame_record.h"
+
+class SentPacketPool;
+
+// The state of the connection when a packet was sent, for estimating the
+// delivery rate when it is acknowledged; see DeliveryRateSampler.
+struct DeliveryState {
+    // the bytes acknowledged before the packet was sent
+    uint64_t delivered;
+    // the time |delivered| was last updated
+    Instant delivered_time;
+    // the send time of the packet most recently acknowledged at the time
+    Instant first_sent_time;
+    // the bytes declared lost before the packet was sent
+    uint64_t lost;
+    // the bytes in flight when the packet was sent, including itself
+    size_t tx_in_flight;
+    bool is_app_limited;
+};
 
 // https://quicwg.org/base-drafts/draft-ietf-quic-recovery.html#name-sent-packet-fields
 // record the information about a packet that was sent
 struct SentPacket {
 
-    RecoverTokens frames;
+    SentPacket(SentPacketPool *pool, Instant time_sent, size_t sent_bytes,
+               bool ack_eliciting, bool in_flight)
+        : frames(nullptr),
+          delivery{0, time_sent, time_sent, 0, 0, false},
+          time_sent(time_sent),
+          sent_bytes(sent_bytes),
+          ack_eliciting(ack_eliciting),
+          pto(false),
+          in_flight(in_flight),
+          ecn(EcnCodepoint::NotEct),
+          pool(pool)
+        {}
+
+    // the frames sent in the packet, most recent first; see
+    // SentPacketPool::add_frame()
+    FrameRecord *frames;
+
+    DeliveryState delivery;
 
     Instant time_sent;
 
@@ -36,6 +73,79 @@ struct SentPacket {
     // keys.
     bool in_flight;
 
+    // the ECN codepoint of the IP header; see LossRecovery::on_packet_sent()
+    EcnCodepoint ecn;
+
+    // where the packet and its frames go back to
+    SentPacketPool *pool;
+
+};
+
+struct SentPacketDeleter {
+    void operator()(SentPacket *packet) const;
+};
+
+using SentPacketPtr = unique_ptr<SentPacket, SentPacketDeleter>;
+
+// The SentPackets and FrameRecords of a connection. Both come from slabs,
+// so once the pool has grown to the number of packets in flight, sending,
+// acknowledging and losing packets no longer touch the heap.
+//
+//     SentPacketPtr packet = pool.new_packet(now, size, true, true);
+//     pool.add_frame(*packet, FrameRecord::stream_frame(4, 0, 1000, false));
+//     loss_recovery.on_packet_sent(space, pn, std::move(packet));
+//
+// The pool must outlive its packets.
+class SentPacketPool {
+
+public:
+
+    SentPacketPool() = default;
+
+    inline SentPacketPtr new_packet(Instant time_sent, size_t sent_bytes,
+                                    bool ack_eliciting, bool in_flight) {
+        return SentPacketPtr(packets_.allocate(
+            this, time_sent, sent_bytes, ack_eliciting, in_flight));
+    }
+
+    inline void add_frame(SentPacket &packet, const FrameRecord &record) {
+        DCHECK(packet.pool == this);
+        FrameRecord *copy = records_.allocate(record);
+        copy->next = packet.frames;
+        packet.frames = copy;
+    }
+
+    // free |packet| along with its frames; called by SentPacketDeleter
+    void release(SentPacket *packet);
+
+    // the number of packets not released yet
+    inline size_t packets_in_use() const {
+        return packets_.in_use();
+    }
+
+    inline size_t frames_in_use() const {
+        return records_.in_use();
+    }
+
+    // disallow copy and assignment; the packets point to the pool
+    SentPacketPool (const SentPacketPool&) = delete;
+    SentPacketPool& operator=(const SentPacketPool&) = delete;
+
+private:
+
+    Slab<SentPacket> packets_;
+
+    Slab<FrameRecord> records_;
+
 };
 
+inline void SentPacketDeleter::operator()(SentPacket *packet) const {
+    packet->pool->release(packet);
+}
+
+// Hand the frames of |packet| to |handler| as acknowledged (|acked|) or
+// lost.
+void dispatch_frames(const SentPacket &packet, bool acked,
+                     FrameRecordHandler &handler);
+
 #endif
@@ -0,0 +1,82 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#include "recovery/sent_packet_history.h"
+
+#include <algorithm>
+
+void SentPacketHistory::insert(PacketNumber pn,
+                               SentPacketPtr packet) {
+    DCHECK(pn.value >= end_packet_number_);
+
+    if (empty()) {
+        // Only tombstones are left; start over at |pn|.
+        head_ = 0;
+        first_packet_number_ = pn.value;
+        end_packet_number_ = pn.value;
+    }
+
+    while (pn.value - first_packet_number_ >= slots_.size()) {
+        grow();
+    }
+
+    slot(pn.value) = std::move(packet);
+    set_occupied(slot_index(pn.value), true);
+    end_packet_number_ = pn.value + 1;
+    size_ += 1;
+}
+
+SentPacketPtr SentPacketHistory::remove(PacketNumber pn) {
+    if (pn.value < first_packet_number_ || pn.value >= end_packet_number_) {
+        return nullptr;
+    }
+
+    SentPacketPtr packet = std::move(slot(pn.value));
+    if (!packet) {
+        return nullptr;
+    }
+    size_ -= 1;
+    set_occupied(slot_index(pn.value), false);
+
+    // drop the tombstones at the head
+    while (first_packet_number_ < end_packet_number_ &&
+           !slot(first_packet_number_)) {
+        head_ = (head_ + 1) & (slots_.size() - 1);
+        first_packet_number_ += 1;
+    }
+
+    return packet;
+}
+
+SentPacketHistory::dtype
+SentPacketHistory::next_packet_number(dtype pn) const {
+    pn = std::max(pn, first_packet_number_);
+    while (pn < end_packet_number_) {
+        // The capacity is a multiple of 64, so the slots covered by one
+        // word of the bitmap never wrap around.
+        size_t index = slot_index(pn);
+        uint64_t bits = occupied_[index / 64] >> (index % 64);
+        if (bits != 0) {
+            return std::min<dtype>(pn + __builtin_ctzll(bits),
+                                   end_packet_number_);
+        }
+        pn += 64 - index % 64;
+    }
+    return end_packet_number_;
+}
+
+void SentPacketHistory::grow() {
+    std::vector<SentPacketPtr> slots(slots_.size() * 2);
+    std::vector<uint64_t> occupied(slots.size() / 64);
+    for (dtype pn = first_packet_number_; pn < end_packet_number_; pn++) {
+        size_t index = pn - first_packet_number_;
+        if (slot(pn)) {
+            occupied[index / 64] |= uint64_t(1) << (index % 64);
+        }
+        slots[index] = std::move(slot(pn));
+    }
+    slots_ = std::move(slots);
+    occupied_ = std::move(occupied);
+    head_ = 0;
+}
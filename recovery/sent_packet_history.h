@@ -0,0 +1,133 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#ifndef RECOVERY_SENT_PACKET_HISTORY_H
+#define RECOVERY_SENT_PACKET_HISTORY_H
+
+#include <vector>
+
+#include "common/quic_types.h"
+#include "recovery/sent_packet.h"
+
+// The packets sent in one packet number space that are neither
+// acknowledged nor declared lost, indexed by packet number.
+//
+// Packet numbers only increase, so the packets are kept in a ring buffer
+// in send order: slot i holds packet first_packet_number() + i. A packet
+// that is acknowledged or lost leaves a tombstone (an empty slot) behind,
+// and the tombstones at the head are dropped as soon as the oldest packet
+// is gone. Lookup is O(1), scanning is in packet number order over
+// contiguous memory, and no node is allocated per packet.
+//
+// Skipped packet numbers are tombstones from the start.
+//
+// A bitmap of the occupied slots lets the scans jump over 64 tombstones
+// at a time (see next_packet_number()), so walking a range costs about
+// the number of packets in it rather than its span.
+class SentPacketHistory {
+
+public:
+
+    using dtype = PacketNumber::dtype;
+
+    SentPacketHistory()
+        : slots_(kInitialCapacity),
+          occupied_(kInitialCapacity / 64),
+          head_(0),
+          first_packet_number_(0),
+          end_packet_number_(0),
+          size_(0)
+        {}
+
+    // |pn| must be larger than any packet number inserted before.
+    void insert(PacketNumber pn, SentPacketPtr packet);
+
+    // return nullptr if |pn| is not in the history
+    inline SentPacket *find(PacketNumber pn) const {
+        if (pn.value < first_packet_number_ ||
+            pn.value >= end_packet_number_) {
+            return nullptr;
+        }
+        return slot(pn.value).get();
+    }
+
+    // Take |pn| out of the history; return nullptr if it is not there.
+    SentPacketPtr remove(PacketNumber pn);
+
+    // return the smallest packet number in the history that is not less
+    // than |pn|, or end_packet_number() if there is none
+    dtype next_packet_number(dtype pn) const;
+
+    // the number of packets, not counting the tombstones
+    inline size_t size() const {
+        return size_;
+    }
+
+    inline bool empty() const {
+        return size_ == 0;
+    }
+
+    // All the packets are in [first_packet_number(), end_packet_number()).
+    // The first one is never a tombstone.
+    inline dtype first_packet_number() const {
+        return first_packet_number_;
+    }
+
+    inline dtype end_packet_number() const {
+        return end_packet_number_;
+    }
+
+    // disallow copy and assignment
+    SentPacketHistory (const SentPacketHistory&) = delete;
+    SentPacketHistory& operator=(const SentPacketHistory&) = delete;
+
+    SentPacketHistory (SentPacketHistory&&) = default;
+    SentPacketHistory& operator=(SentPacketHistory&&) = default;
+
+private:
+
+    // a power of 2, so that the index wraps around with a mask
+    static constexpr size_t kInitialCapacity = 64;
+
+    inline size_t slot_index(dtype pn) const {
+        return (head_ + (pn - first_packet_number_)) & (slots_.size() - 1);
+    }
+
+    inline SentPacketPtr &slot(dtype pn) {
+        return slots_[slot_index(pn)];
+    }
+
+    inline const SentPacketPtr &slot(dtype pn) const {
+        return slots_[slot_index(pn)];
+    }
+
+    inline void set_occupied(size_t index, bool occupied) {
+        uint64_t bit = uint64_t(1) << (index % 64);
+        if (occupied) {
+            occupied_[index / 64] |= bit;
+        } else {
+            occupied_[index / 64] &= ~bit;
+        }
+    }
+
+    // double the capacity, keeping the packets in order
+    void grow();
+
+    std::vector<SentPacketPtr> slots_;
+
+    // bit i is set iff slots_[i] holds a packet
+    std::vector<uint64_t> occupied_;
+
+    // the slot of first_packet_number_
+    size_t head_;
+
+    dtype first_packet_number_;
+
+    dtype end_packet_number_;
+
+    size_t size_;
+
+};
+
+#endif //RECOVERY_SENT_PACKET_HISTORY_H
@@ -0,0 +1,99 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#include "sim/dumbbell.h"
+
+Dumbbell::Dumbbell(Simulator &sim, const LinkConfig &forward,
+                   const LinkConfig &reverse)
+    : sim_(sim),
+      forward_(sim, forward, [this](Instant now, Datagram &datagram) {
+          if (recording_delays_) {
+              queueing_delays_[datagram.flow]->record(datagram.queueing_delay);
+          }
+          receivers_[datagram.flow]->on_datagram(now, datagram);
+      }),
+      reverse_(sim, reverse, [this](Instant now, Datagram &datagram) {
+          senders_[datagram.flow]->on_datagram(now, datagram);
+      }),
+      recording_delays_(false),
+      interval_(Duration::zero()),
+      sampling_start_(sim.now()),
+      last_dropped_(0),
+      sample_alarm_(sim.alarms().new_alarm([this](Instant now) {
+          take_sample(now);
+      }))
+{}
+
+LinkConfig Dumbbell::reverse_of(const LinkConfig &forward) {
+    LinkConfig reverse;
+    reverse.bandwidth = forward.bandwidth * 10;
+    reverse.propagation_delay = forward.propagation_delay;
+    reverse.buffer = forward.buffer * 10;
+    reverse.seed = forward.seed + 1;
+    return reverse;
+}
+
+size_t Dumbbell::add_flow(const QuicConfig &config, Duration start_delay) {
+    size_t flow = senders_.size();
+    senders_.push_back(std::make_unique<SimSender>(
+        sim_, config, flow, forward_, start_delay));
+    receivers_.push_back(std::make_unique<SimReceiver>(
+        sim_, flow, reverse_, config.max_ack_delay));
+    queueing_delays_.push_back(std::make_unique<RttHistogram>());
+    last_acked_.push_back(0);
+    last_lost_.push_back(0);
+    return flow;
+}
+
+void Dumbbell::sample_every(Duration interval) {
+    interval_ = interval;
+    sampling_start_ = sim_.now();
+    forward_.take_max_queueing_delay();
+    sample_alarm_->set(sim_.now() + interval);
+}
+
+void Dumbbell::take_sample(Instant now) {
+    const LinkStats &stats = forward_.stats();
+    uint64_t dropped = stats.datagrams_dropped + stats.datagrams_lost;
+    Duration queueing_delay = forward_.take_max_queueing_delay();
+    double seconds = interval_.to_microseconds() * 1e-6;
+
+    for (size_t flow = 0; flow < senders_.size(); flow++) {
+        SimSender &sender = *senders_[flow];
+        LossRecovery &recovery = sender.recovery();
+        timeline_.push_back(TimelineSample{
+            now, flow,
+            static_cast<uint64_t>(
+                (sender.bytes_acked() - last_acked_[flow]) / seconds),
+            recovery.congestion_window(),
+            recovery.pacing_rate(),
+            recovery.rtt_time().smoothed_rtt(),
+            sender.bytes_lost() - last_lost_[flow],
+            queueing_delay,
+            dropped - last_dropped_,
+        });
+        last_acked_[flow] = sender.bytes_acked();
+        last_lost_[flow] = sender.bytes_lost();
+    }
+    last_dropped_ = dropped;
+
+    sample_alarm_->set(now + interval_);
+}
+
+void Dumbbell::write_csv(std::ostream &os) const {
+    os << "time_ms,flow,cc,goodput_mbps,cwnd,pacing_mbps,srtt_ms,"
+          "lost_bytes,queueing_delay_ms,dropped\n";
+    for (auto &sample : timeline_) {
+        os << (sample.time - sampling_start_).to_milliseconds() << ","
+           << sample.flow << ","
+           << senders_[sample.flow]->config().congestion_control << ","
+           << sample.goodput * 8e-6 << ","
+           << sample.congestion_window << ","
+           << sample.pacing_rate * 8e-6 << ","
+           << sample.smoothed_rtt.to_microseconds() * 1e-3 << ","
+           << sample.bytes_lost << ","
+           << sample.queueing_delay.to_microseconds() * 1e-3 << ","
+           << sample.datagrams_dropped << "\n";
+    }
+}
@@ -0,0 +1,137 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#ifndef SIM_DUMBBELL_H
+#define SIM_DUMBBELL_H
+
+#include <ostream>
+#include <vector>
+
+#include "recovery/rtt_histogram.h"
+#include "sim/endpoint.h"
+#include "sim/link.h"
+#include "sim/simulator.h"
+
+// One row of a timeline: a flow over one sampling interval.
+struct TimelineSample {
+    Instant time;
+    size_t flow;
+    // the stream bytes acknowledged in the interval, per second
+    uint64_t goodput;
+    size_t congestion_window;
+    uint64_t pacing_rate;
+    Duration smoothed_rtt;
+    // the stream bytes declared lost in the interval
+    uint64_t bytes_lost;
+    // of the bottleneck, shared by the flows: the largest queueing delay
+    // in the interval, and the datagrams dropped or lost in it
+    Duration queueing_delay;
+    uint64_t datagrams_dropped;
+};
+
+// Flows sharing one bottleneck: the senders send through the forward
+// link, and the receivers acknowledge through the reverse one.
+//
+//     Simulator sim;
+//     Dumbbell dumbbell(sim, bottleneck, reverse);
+//     dumbbell.add_flow(cubic_config);
+//     dumbbell.add_flow(bbr_config, Duration::from_seconds(5));
+//     dumbbell.sample_every(Duration::from_milliseconds(100));
+//     sim.run_for(Duration::from_seconds(30));
+//     dumbbell.write_csv(std::cout);
+class Dumbbell {
+
+public:
+
+    Dumbbell(Simulator &sim, const LinkConfig &forward,
+             const LinkConfig &reverse);
+
+    // a reverse link for |forward|: the same delay, and ten times the
+    // bandwidth and the buffer, so that the ACKs never queue for long
+    static LinkConfig reverse_of(const LinkConfig &forward);
+
+    // return the index of the new flow, which starts |start_delay| after
+    // now
+    size_t add_flow(const QuicConfig &config,
+                    Duration start_delay = Duration::zero());
+
+    // record a TimelineSample of every flow each |interval|, from now on
+    void sample_every(Duration interval);
+
+    // from now on, record the time each datagram of a flow waits at the
+    // bottleneck in queueing_delays()
+    inline void record_queueing_delays() {
+        recording_delays_ = true;
+    }
+
+    inline const RttHistogram &queueing_delays(size_t flow) const {
+        return *queueing_delays_[flow];
+    }
+
+    inline size_t flows() const {
+        return senders_.size();
+    }
+
+    inline SimSender &sender(size_t flow) {
+        return *senders_[flow];
+    }
+
+    inline SimReceiver &receiver(size_t flow) {
+        return *receivers_[flow];
+    }
+
+    inline Link &forward() {
+        return forward_;
+    }
+
+    inline Link &reverse() {
+        return reverse_;
+    }
+
+    inline const std::vector<TimelineSample> &timeline() const {
+        return timeline_;
+    }
+
+    // one line per sample, with a header line; the times are in
+    // milliseconds since the sampling started, the rates in Mbps
+    void write_csv(std::ostream &os) const;
+
+    // disallow copy and assignment; the alarms refer to |this|
+    Dumbbell (const Dumbbell&) = delete;
+    Dumbbell& operator= (const Dumbbell&) = delete;
+
+private:
+
+    void take_sample(Instant now);
+
+    Simulator &sim_;
+
+    Link forward_;
+
+    Link reverse_;
+
+    std::vector<unique_ptr<SimSender>> senders_;
+
+    std::vector<unique_ptr<SimReceiver>> receivers_;
+
+    bool recording_delays_;
+
+    std::vector<unique_ptr<RttHistogram>> queueing_delays_;
+
+    Duration interval_;
+
+    Instant sampling_start_;
+
+    // the counters at the last sample
+    std::vector<uint64_t> last_acked_;
+    std::vector<uint64_t> last_lost_;
+    uint64_t last_dropped_;
+
+    std::vector<TimelineSample> timeline_;
+
+    unique_ptr<Alarm> sample_alarm_;
+
+};
+
+#endif //SIM_DUMBBELL_H
@@ -0,0 +1,153 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#include "sim/endpoint.h"
+
+#include "util/string_reader.h"
+#include "util/string_writer.h"
+
+SimSender::SimSender(Simulator &sim, const QuicConfig &config, size_t flow,
+                     Link &link, Duration start_delay)
+    : sim_(sim),
+      config_(config),
+      flow_(flow),
+      link_(link),
+      recovery_(sim.alarms(), config_, true),
+      pacer_(sim.alarms(), [this](Instant now) {
+          send_packets(now);
+      }),
+      next_pn_(0),
+      stream_offset_(0),
+      bytes_acked_(0),
+      bytes_lost_(0),
+      probes_sent_(0),
+      start_alarm_(sim.alarms().new_alarm([this](Instant now) {
+          recovery_.set_handshake_complete(now);
+          send_packets(now);
+      }))
+{
+    recovery_.set_frame_handler(this);
+    recovery_.set_probe_sender(this);
+    recovery_.set_rtt_histogram(&rtt_histogram_);
+    start_alarm_->set(sim.now() + start_delay);
+}
+
+void SimSender::on_datagram(Instant now, Datagram &datagram) {
+    if (!datagram.ack) {
+        return;
+    }
+    recovery_.on_ack_received(PNSpace::Application, *datagram.ack, now);
+    pacer_.set_rate(now, recovery_.pacing_rate());
+    send_packets(now);
+}
+
+void SimSender::send_packets(Instant now) {
+    if (start_alarm_->is_set()) {
+        return;
+    }
+    while (recovery_.bytes_in_flight() + kMaxDatagramSize
+           <= recovery_.congestion_window()) {
+        if (!pacer_.can_send(now)) {
+            // the pacer calls back when there is credit again
+            return;
+        }
+        send_packet(now);
+    }
+}
+
+void SimSender::send_packet(Instant now) {
+    size_t payload = kMaxDatagramSize - kSimPacketOverhead;
+    SentPacketPtr packet = recovery_.pool().new_packet(
+        now, kMaxDatagramSize, true, true);
+    recovery_.pool().add_frame(*packet, FrameRecord::stream_frame(
+        0, stream_offset_, static_cast<uint32_t>(payload), false));
+    stream_offset_ += payload;
+
+    PacketNumber pn(next_pn_++);
+    EcnCodepoint ecn = recovery_.ecn_codepoint();
+    recovery_.on_packet_sent(PNSpace::Application, pn, std::move(packet));
+    pacer_.on_packet_sent(now, kMaxDatagramSize);
+    link_.send(Datagram{flow_, kMaxDatagramSize, ecn, pn, nullptr});
+}
+
+void SimSender::on_stream_acked(const StreamRecord &record) {
+    bytes_acked_ += record.length;
+}
+
+void SimSender::on_stream_lost(const StreamRecord &record) {
+    bytes_lost_ += record.length;
+}
+
+bool SimSender::send_new_data_probe(PNSpace space) {
+    probes_sent_ += 1;
+    send_packet(sim_.now());
+    return true;
+}
+
+void SimSender::send_retransmission_probe(PNSpace space,
+                                          const SentPacket &packet) {
+    send_new_data_probe(space);
+}
+
+void SimSender::send_ping_probe(PNSpace space) {
+    send_new_data_probe(space);
+}
+
+SimReceiver::SimReceiver(Simulator &sim, size_t flow, Link &ack_link,
+                         Duration max_ack_delay)
+    : flow_(flow),
+      ack_link_(ack_link),
+      tracker_(PNSpace::Application, sim.alarms(), max_ack_delay,
+               [this](Instant now) {
+          send_ack(now);
+      }),
+      ecn_counts_{0, 0, 0},
+      bytes_received_(0),
+      acks_sent_(0),
+      ack_buffer_(kMaxDatagramSize)
+{}
+
+void SimReceiver::on_datagram(Instant now, Datagram &datagram) {
+    if (!tracker_.on_packet_received(datagram.pn, true, now)) {
+        return;
+    }
+    bytes_received_ += datagram.size;
+    if (datagram.ecn == EcnCodepoint::Ect0) {
+        ecn_counts_.ect0 += 1;
+    } else if (datagram.ecn == EcnCodepoint::Ect1) {
+        ecn_counts_.ect1 += 1;
+    } else if (datagram.ecn == EcnCodepoint::Ce) {
+        ecn_counts_.ce += 1;
+    }
+
+    if (tracker_.ack_required()) {
+        send_ack(now);
+    }
+}
+
+void SimReceiver::send_ack(Instant now) {
+    StringWriter writer(ack_buffer_);
+    size_t length = tracker_.write_ack_frame(writer, now);
+    if (length == 0) {
+        return;
+    }
+
+    StringReader reader(ack_buffer_.data(), length);
+    reader.read_with_variant_length();
+    unique_ptr<AckFrame> ack(AckFrame::from_reader(reader, false));
+    // as if the frame were of type 0x03, with the ECN counts
+    ack->is_ECN = true;
+    ack->ECT0_count = ecn_counts_.ect0;
+    ack->ECT1_count = ecn_counts_.ect1;
+    ack->ECN_CE_count = ecn_counts_.ce;
+
+    length += StringWriter::variant_length_size(ecn_counts_.ect0)
+        + StringWriter::variant_length_size(ecn_counts_.ect1)
+        + StringWriter::variant_length_size(ecn_counts_.ce);
+
+    acks_sent_ += 1;
+    ack_link_.send(Datagram{flow_, length + kSimPacketOverhead,
+                            EcnCodepoint::NotEct, PacketNumber(acks_sent_),
+                            std::move(ack)});
+}
@@ -0,0 +1,176 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#ifndef SIM_ENDPOINT_H
+#define SIM_ENDPOINT_H
+
+#include "common/config.h"
+#include "recovery/loss_recovery.h"
+#include "recovery/pacer.h"
+#include "recovery/rtt_histogram.h"
+#include "sim/link.h"
+#include "transport/received_packet_tracker.h"
+#include "util/string_raw.h"
+
+// The short header and the AEAD tag around the frames of a packet.
+constexpr size_t kSimPacketOverhead = 1 + kDefaultCidLength + 4 + 16;
+
+// The sending side of a bulk transfer: it always has data, and sends
+// whenever the congestion window and the pacer allow. The packets go
+// through a LossRecovery with the congestion controller of the config,
+// in the Application space of a connection whose handshake is done.
+//
+// Every packet carries new stream data; the data of a packet declared
+// lost is counted, not retransmitted, since only its amount matters to
+// the congestion controller.
+class SimSender : public FrameRecordHandler, public ProbeSender {
+
+public:
+
+    // the flow starts |start_delay| after now
+    SimSender(Simulator &sim, const QuicConfig &config, size_t flow,
+              Link &link, Duration start_delay = Duration::zero());
+
+    // an ACK from the receiver
+    void on_datagram(Instant now, Datagram &datagram);
+
+    inline LossRecovery &recovery() {
+        return recovery_;
+    }
+
+    inline const QuicConfig &config() const {
+        return config_;
+    }
+
+    // the stream bytes acknowledged so far
+    inline uint64_t bytes_acked() const {
+        return bytes_acked_;
+    }
+
+    // the stream bytes declared lost so far
+    inline uint64_t bytes_lost() const {
+        return bytes_lost_;
+    }
+
+    inline uint64_t packets_sent() const {
+        return next_pn_;
+    }
+
+    inline uint64_t probes_sent() const {
+        return probes_sent_;
+    }
+
+    // every RTT sample of the flow
+    inline const RttHistogram &rtt_histogram() const {
+        return rtt_histogram_;
+    }
+
+    void on_stream_acked(const StreamRecord &record) override;
+
+    void on_stream_lost(const StreamRecord &record) override;
+
+    void on_crypto_acked(const CryptoRecord &record) override {}
+
+    void on_crypto_lost(const CryptoRecord &record) override {}
+
+    void on_control_frame_acked(const FrameRecord &record) override {}
+
+    void on_control_frame_lost(const FrameRecord &record) override {}
+
+    // there is always new data, so the other probes are never asked for
+    bool send_new_data_probe(PNSpace space) override;
+
+    void send_retransmission_probe(PNSpace space,
+                                   const SentPacket &packet) override;
+
+    void send_ping_probe(PNSpace space) override;
+
+    void send_anti_deadlock_probe() override {}
+
+    // disallow copy and assignment; the alarms refer to |this|
+    SimSender (const SimSender&) = delete;
+    SimSender& operator= (const SimSender&) = delete;
+
+private:
+
+    // send as long as the window and the pacer allow
+    void send_packets(Instant now);
+
+    void send_packet(Instant now);
+
+    Simulator &sim_;
+
+    QuicConfig config_;
+
+    size_t flow_;
+
+    Link &link_;
+
+    // declared before |recovery_|, which records into it
+    RttHistogram rtt_histogram_;
+
+    LossRecovery recovery_;
+
+    Pacer pacer_;
+
+    PacketNumber::dtype next_pn_;
+
+    uint64_t stream_offset_;
+
+    uint64_t bytes_acked_;
+
+    uint64_t bytes_lost_;
+
+    uint64_t probes_sent_;
+
+    unique_ptr<Alarm> start_alarm_;
+
+};
+
+// The receiving side: it acknowledges the packets as a connection would,
+// with a ReceivedPacketTracker, and reports the ECN counts.
+class SimReceiver {
+
+public:
+
+    SimReceiver(Simulator &sim, size_t flow, Link &ack_link,
+                Duration max_ack_delay = kDefaultMaxAckDelay);
+
+    // a data packet from the sender
+    void on_datagram(Instant now, Datagram &datagram);
+
+    inline uint64_t bytes_received() const {
+        return bytes_received_;
+    }
+
+    inline uint64_t acks_sent() const {
+        return acks_sent_;
+    }
+
+    // disallow copy and assignment; the alarm refers to |this|
+    SimReceiver (const SimReceiver&) = delete;
+    SimReceiver& operator= (const SimReceiver&) = delete;
+
+private:
+
+    void send_ack(Instant now);
+
+    size_t flow_;
+
+    Link &ack_link_;
+
+    ReceivedPacketTracker tracker_;
+
+    EcnCounts ecn_counts_;
+
+    uint64_t bytes_received_;
+
+    uint64_t acks_sent_;
+
+    // the ACK frames are encoded and decoded, as on the wire
+    String ack_buffer_;
+
+};
+
+#endif //SIM_ENDPOINT_H
@@ -0,0 +1,112 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#include "sim/link.h"
+
+#include <algorithm>
+
+Link::Link(Simulator &sim, const LinkConfig &config, Receiver receiver)
+    : sim_(sim),
+      config_(config),
+      receiver_(std::move(receiver)),
+      link_free_(sim.now()),
+      link_free_remainder_(0),
+      max_queueing_delay_(Duration::zero()),
+      in_burst_(false),
+      random_(config.seed),
+      uniform_(0.0, 1.0),
+      alarm_(sim.alarms().new_alarm([this](Instant now) {
+          deliver(now);
+      }))
+{}
+
+Duration Link::queueing_delay() const {
+    return std::max(link_free_ - sim_.now(), Duration::zero());
+}
+
+Duration Link::take_max_queueing_delay() {
+    Duration delay = max_queueing_delay_;
+    max_queueing_delay_ = Duration::zero();
+    return delay;
+}
+
+bool Link::lose() {
+    if (in_burst_) {
+        in_burst_ = uniform_(random_) >= config_.burst_end;
+    } else {
+        in_burst_ = config_.burst_start > 0 &&
+            uniform_(random_) < config_.burst_start;
+    }
+    if (in_burst_) {
+        return true;
+    }
+    return config_.random_loss > 0 && uniform_(random_) < config_.random_loss;
+}
+
+void Link::send(Datagram datagram) {
+    Instant now = sim_.now();
+    stats_.datagrams_sent += 1;
+
+    if (lose()) {
+        stats_.datagrams_lost += 1;
+        return;
+    }
+
+    if (link_free_ < now) {
+        // idle
+        link_free_ = now;
+        link_free_remainder_ = 0;
+    }
+    Duration delay = link_free_ - now;
+    uint64_t queued = (delay.to_microseconds() * config_.bandwidth
+                       + link_free_remainder_) / 1000000;
+    if (queued + datagram.size > config_.buffer) {
+        stats_.datagrams_dropped += 1;
+        return;
+    }
+
+    Duration threshold = datagram.ecn == EcnCodepoint::Ect1
+        ? config_.l4s_ce_threshold : config_.ce_threshold;
+    if (delay > threshold) {
+        if (datagram.ecn == EcnCodepoint::NotEct) {
+            stats_.datagrams_dropped += 1;
+            return;
+        }
+        datagram.ecn = EcnCodepoint::Ce;
+        stats_.datagrams_marked += 1;
+    }
+    max_queueing_delay_ = std::max(max_queueing_delay_, delay);
+    datagram.queueing_delay = delay;
+
+    uint64_t transmission = datagram.size * 1000000 + link_free_remainder_;
+    link_free_ = link_free_ + Duration::from_microseconds(
+        static_cast<int64_t>(transmission / config_.bandwidth));
+    link_free_remainder_ = transmission % config_.bandwidth;
+
+    Instant arrival = link_free_ + config_.propagation_delay;
+    if (config_.reorder > 0 && uniform_(random_) < config_.reorder) {
+        arrival = arrival + config_.reorder_delay;
+        stats_.datagrams_reordered += 1;
+    }
+
+    // Equal arrival times keep the send order.
+    in_flight_.emplace(arrival, std::move(datagram));
+    if (!alarm_->is_set() || arrival < alarm_->deadline()) {
+        alarm_->set(arrival);
+    }
+}
+
+void Link::deliver(Instant now) {
+    while (!in_flight_.empty() && in_flight_.begin()->first <= now) {
+        // The receiver may send on another link, or on this one.
+        Datagram datagram = std::move(in_flight_.begin()->second);
+        in_flight_.erase(in_flight_.begin());
+        stats_.datagrams_delivered += 1;
+        stats_.bytes_delivered += datagram.size;
+        receiver_(now, datagram);
+    }
+    if (!in_flight_.empty()) {
+        alarm_->set(in_flight_.begin()->first);
+    }
+}
@@ -0,0 +1,164 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#ifndef SIM_LINK_H
+#define SIM_LINK_H
+
+#include <functional>
+#include <map>
+#include <random>
+
+#include "common/frame.h"
+#include "common/quic_types.h"
+#include "sim/simulator.h"
+
+// A datagram on a simulated link. It is not encoded: a data packet is
+// its packet number, and an ACK carries the decoded frame.
+struct Datagram {
+    Datagram(size_t flow, size_t size, EcnCodepoint ecn, PacketNumber pn,
+             unique_ptr<AckFrame> ack)
+        : flow(flow), size(size), ecn(ecn), pn(pn), ack(std::move(ack)),
+          queueing_delay(Duration::zero()) {}
+
+    // the flow the datagram belongs to, for routing at the far end
+    size_t flow;
+
+    // on the wire, in bytes
+    size_t size;
+
+    EcnCodepoint ecn;
+
+    PacketNumber pn;
+
+    // null for a data packet
+    unique_ptr<AckFrame> ack;
+
+    // the time it waited in the queue of the last link it crossed
+    Duration queueing_delay;
+};
+
+struct LinkConfig {
+    // in bytes per second
+    uint64_t bandwidth = 1250000;
+
+    // one way
+    Duration propagation_delay = Duration::from_milliseconds(10);
+
+    // the bytes that may wait in the queue; the datagrams that do not
+    // fit are dropped at the tail
+    size_t buffer = 64 * 1024;
+
+    // the probability that a datagram is lost, independently of others
+    double random_loss = 0;
+
+    // Bursty loss, a Gilbert-Elliott model: every datagram, the link goes
+    // from the good to the bad state with |burst_start|, and back with
+    // |burst_end|. All the datagrams are lost in the bad state, so the
+    // bursts are 1 / |burst_end| datagrams long on average.
+    double burst_start = 0;
+    double burst_end = 1;
+
+    // the probability that a datagram is held back by |reorder_delay|
+    // after it leaves the queue, so that later ones overtake it
+    double reorder = 0;
+    Duration reorder_delay = Duration::from_milliseconds(1);
+
+    // A step AQM: the datagrams that find more queueing delay than this
+    // are marked CE if they are ECN-capable, and dropped otherwise.
+    // Infinite to never mark.
+    Duration ce_threshold = Duration::infinite();
+
+    // The threshold of the ECT(1) datagrams instead, as in an L4S AQM,
+    // which keeps them in a queue of their own. Usually much shorter.
+    Duration l4s_ce_threshold = Duration::infinite();
+
+    // of the random number generator, so that a run can be repeated
+    uint32_t seed = 1;
+};
+
+// What a link has done with the datagrams so far.
+struct LinkStats {
+    uint64_t datagrams_sent = 0;
+    uint64_t datagrams_delivered = 0;
+    uint64_t bytes_delivered = 0;
+    // dropped at the tail of the queue, or by the AQM
+    uint64_t datagrams_dropped = 0;
+    // lost at random or in a burst
+    uint64_t datagrams_lost = 0;
+    uint64_t datagrams_reordered = 0;
+    uint64_t datagrams_marked = 0;
+};
+
+// One direction of a bottleneck link: a FIFO queue drained at the
+// bandwidth, followed by the propagation delay. The losses happen before
+// the queue, so that a lost datagram takes no bandwidth.
+class Link {
+
+public:
+
+    using Receiver = std::function<void(Instant now, Datagram &datagram)>;
+
+    Link(Simulator &sim, const LinkConfig &config, Receiver receiver);
+
+    // Put |datagram| on the link at the current time of the simulator.
+    void send(Datagram datagram);
+
+    // the time a datagram sent now would wait before being transmitted
+    Duration queueing_delay() const;
+
+    // the largest queueing delay seen by a datagram since the last call
+    Duration take_max_queueing_delay();
+
+    inline const LinkStats &stats() const {
+        return stats_;
+    }
+
+    inline const LinkConfig &config() const {
+        return config_;
+    }
+
+    // disallow copy and assignment; the alarm refers to |this|
+    Link (const Link&) = delete;
+    Link& operator= (const Link&) = delete;
+
+private:
+
+    // the datagram is lost at random or in a burst
+    bool lose();
+
+    void deliver(Instant now);
+
+    Simulator &sim_;
+
+    LinkConfig config_;
+
+    Receiver receiver_;
+
+    LinkStats stats_;
+
+    // The time the link finishes transmitting the datagrams queued, in
+    // whole microseconds, and the fraction of a microsecond past it in
+    // units of 1 / |bandwidth| microsecond. Carrying the fraction keeps
+    // the transmission times exact on average, however short they are.
+    Instant link_free_;
+    uint64_t link_free_remainder_;
+
+    Duration max_queueing_delay_;
+
+    // Gilbert-Elliott state
+    bool in_burst_;
+
+    std::minstd_rand random_;
+
+    std::uniform_real_distribution<double> uniform_;
+
+    // by arrival time at the far end; the datagrams held back for
+    // reordering are out of send order
+    std::multimap<Instant, Datagram> in_flight_;
+
+    unique_ptr<Alarm> alarm_;
+
+};
+
+#endif //SIM_LINK_H
@@ -0,0 +1,147 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+// Runs bulk flows over a simulated bottleneck and prints their timelines
+// as CSV: goodput, window, pacing rate, smoothed RTT and losses of each
+// flow, and the queueing delay and drops of the bottleneck, every
+// sampling interval. A summary per flow follows as comment lines, with
+// the percentiles of the queueing delay its datagrams met.
+//
+// The flows start one second apart. The reverse link, which carries the
+// ACKs, has the same delay and is never the bottleneck.
+//
+// usage: quic_sim [cc,cc,...] [rate in Mbps] [RTT in ms] [buffer in BDP]
+//                 [seconds] [random loss in %] [mean loss burst]
+//                 [reordering in %] [CE threshold in ms] [interval in ms]
+//
+//     quic_sim cubic,bbr 50 40 1 30 > timeline.csv
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "recovery/cc_registry.h"
+#include "sim/dumbbell.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char **argv) {
+    std::string controllers = kDefaultCongestionControl;
+    double rate_mbps = 50;
+    int64_t rtt_ms = 40;
+    double buffer_bdp = 1;
+    int64_t seconds = 30;
+    double random_loss = 0;
+    double mean_burst = 0;
+    double reorder = 0;
+    double ce_threshold_ms = 0;
+    int64_t interval_ms = 100;
+    if (argc > 1) {
+        controllers = argv[1];
+    }
+    if (argc > 2) {
+        rate_mbps = strtod(argv[2], nullptr);
+    }
+    if (argc > 3) {
+        rtt_ms = strtoll(argv[3], nullptr, 10);
+    }
+    if (argc > 4) {
+        buffer_bdp = strtod(argv[4], nullptr);
+    }
+    if (argc > 5) {
+        seconds = strtoll(argv[5], nullptr, 10);
+    }
+    if (argc > 6) {
+        random_loss = strtod(argv[6], nullptr) / 100;
+    }
+    if (argc > 7) {
+        mean_burst = strtod(argv[7], nullptr);
+    }
+    if (argc > 8) {
+        reorder = strtod(argv[8], nullptr) / 100;
+    }
+    if (argc > 9) {
+        ce_threshold_ms = strtod(argv[9], nullptr);
+    }
+    if (argc > 10) {
+        interval_ms = strtoll(argv[10], nullptr, 10);
+    }
+
+    Duration one_way = Duration::from_microseconds(rtt_ms * 1000 / 2);
+    LinkConfig forward;
+    forward.bandwidth = static_cast<uint64_t>(rate_mbps * 1e6 / 8);
+    forward.propagation_delay = one_way;
+    forward.buffer = std::max<size_t>(kMaxDatagramSize, static_cast<size_t>(
+        buffer_bdp * forward.bandwidth * rtt_ms / 1000));
+    if (mean_burst >= 1) {
+        // |random_loss| of the datagrams are lost, in bursts of
+        // |mean_burst| on average
+        forward.burst_end = 1 / mean_burst;
+        forward.burst_start = random_loss * forward.burst_end
+            / (1 - random_loss);
+    } else {
+        forward.random_loss = random_loss;
+    }
+    forward.reorder = reorder;
+    if (ce_threshold_ms > 0) {
+        forward.ce_threshold = Duration::from_microseconds(
+            static_cast<int64_t>(ce_threshold_ms * 1000));
+        forward.l4s_ce_threshold = forward.ce_threshold;
+    }
+
+    Simulator sim;
+    Dumbbell dumbbell(sim, forward, Dumbbell::reverse_of(forward));
+
+    std::istringstream names(controllers);
+    std::string name;
+    for (int i = 0; std::getline(names, name, ','); i++) {
+        if (!CongestionControlRegistry::instance().contains(name)) {
+            fprintf(stderr, "unknown congestion control: %s\n", name.c_str());
+            return 1;
+        }
+        QuicConfig config;
+        config.congestion_control = name;
+        dumbbell.add_flow(config, Duration::from_seconds(i));
+    }
+
+    dumbbell.sample_every(Duration::from_milliseconds(interval_ms));
+    dumbbell.record_queueing_delays();
+    sim.run_for(Duration::from_seconds(seconds));
+    dumbbell.write_csv(std::cout);
+
+    printf("# %.0f Mbps, %ld ms RTT, buffer of %.2f BDP, %.2f%% loss,"
+           " %.2f%% reordering; %lu events\n",
+           rate_mbps, static_cast<long>(rtt_ms), buffer_bdp,
+           random_loss * 100, reorder * 100,
+           static_cast<unsigned long>(sim.steps()));
+    for (size_t flow = 0; flow < dumbbell.flows(); flow++) {
+        SimSender &sender = dumbbell.sender(flow);
+        const RttHistogram &delays = dumbbell.queueing_delays(flow);
+        const RttHistogram &rtts = sender.rtt_histogram();
+        printf("# flow %lu %-8s goodput %7.2f Mbps, lost %lu bytes,"
+               " %lu probes, queueing delay p50 %.1f ms, p99 %.1f ms,"
+               " RTT p50 %.1f ms, p99 %.1f ms\n",
+               static_cast<unsigned long>(flow),
+               sender.config().congestion_control.c_str(),
+               sender.bytes_acked() * 8e-6 / seconds,
+               static_cast<unsigned long>(sender.bytes_lost()),
+               static_cast<unsigned long>(sender.probes_sent()),
+               delays.percentile(0.5).to_microseconds() * 1e-3,
+               delays.percentile(0.99).to_microseconds() * 1e-3,
+               rtts.percentile(0.5).to_microseconds() * 1e-3,
+               rtts.percentile(0.99).to_microseconds() * 1e-3);
+    }
+    const LinkStats &stats = dumbbell.forward().stats();
+    printf("# bottleneck: %lu datagrams, %lu dropped, %lu lost,"
+           " %lu reordered, %lu marked\n",
+           static_cast<unsigned long>(stats.datagrams_sent),
+           static_cast<unsigned long>(stats.datagrams_dropped),
+           static_cast<unsigned long>(stats.datagrams_lost),
+           static_cast<unsigned long>(stats.datagrams_reordered),
+           static_cast<unsigned long>(stats.datagrams_marked));
+    return 0;
+}
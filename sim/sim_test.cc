@@ -0,0 +1,297 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#include <algorithm>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "sim/dumbbell.h"
+#include "sim/link.h"
+#include "sim/simulator.h"
+
+class SimTest : public ::testing::Test {
+protected:
+    SimTest() = default;
+
+    ~SimTest() override = default;
+
+    void SetUp() override {
+        // 1000 datagrams of 1250 bytes per second
+        config.bandwidth = 1250000;
+        config.propagation_delay = Duration::from_milliseconds(10);
+        config.buffer = 10 * kDatagramSize;
+    }
+
+    void TearDown() override {
+    }
+
+    Datagram make_datagram(PacketNumber pn) {
+        return Datagram{0, kDatagramSize, EcnCodepoint::Ect0, pn, nullptr};
+    }
+
+    // record the datagrams a link delivers, with their arrival times
+    void on_datagram(Instant now, Datagram &datagram) {
+        arrivals.push_back(now);
+        received.push_back(datagram.pn.value);
+        ecn.push_back(datagram.ecn);
+    }
+
+    static constexpr size_t kDatagramSize = 1250;
+
+    LinkConfig config;
+
+    std::vector<Instant> arrivals;
+    std::vector<PacketNumber::dtype> received;
+    std::vector<EcnCodepoint> ecn;
+};
+
+constexpr size_t SimTest::kDatagramSize;
+
+TEST_F(SimTest, VirtualClock) {
+    Simulator sim;
+    Instant start = sim.now();
+    std::vector<int64_t> fired;
+    unique_ptr<Alarm> alarm = sim.alarms().new_alarm([&](Instant now) {
+        fired.push_back((now - start).to_milliseconds());
+        if (fired.size() < 3) {
+            alarm->set(now + Duration::from_seconds(100));
+        }
+    });
+    alarm->set(start + Duration::from_seconds(100));
+
+    sim.run_for(Duration::from_seconds(250));
+    EXPECT_EQ(fired, (std::vector<int64_t>{100000, 200000}));
+    EXPECT_EQ(sim.now(), start + Duration::from_seconds(250));
+
+    sim.run_until(Instant::infinite());
+    EXPECT_EQ(fired.size(), 3u);
+    EXPECT_EQ(sim.now(), start + Duration::from_seconds(300));
+}
+
+TEST_F(SimTest, LinkQueue) {
+    Simulator sim;
+    Link link(sim, config, [this](Instant now, Datagram &datagram) {
+        on_datagram(now, datagram);
+    });
+    Instant start = sim.now();
+
+    // one datagram every millisecond, after the propagation delay; the
+    // buffer holds 10, including the one being transmitted
+    for (PacketNumber::dtype pn = 0; pn < 12; pn++) {
+        link.send(make_datagram(pn));
+    }
+    EXPECT_EQ(link.stats().datagrams_dropped, 2u);
+    EXPECT_EQ(link.queueing_delay(), Duration::from_milliseconds(10));
+
+    sim.run_until(Instant::infinite());
+    ASSERT_EQ(received.size(), 10u);
+    EXPECT_EQ(arrivals.front(), start + Duration::from_milliseconds(11));
+    EXPECT_EQ(arrivals.back(), start + Duration::from_milliseconds(20));
+    EXPECT_EQ(link.take_max_queueing_delay(), Duration::from_milliseconds(9));
+    EXPECT_EQ(link.stats().bytes_delivered, 10 * kDatagramSize);
+}
+
+// The transmission times are a fraction of a microsecond at these rates;
+// the link must not round them away.
+TEST_F(SimTest, LinkRate) {
+    for (uint64_t bandwidth : {125000000ul, 1250000000ul}) {
+        Simulator sim;
+        config.bandwidth = bandwidth;
+        config.buffer = bandwidth;
+        Link link(sim, config, [](Instant now, Datagram &datagram) {});
+
+        // a second of 1200-byte datagrams at once
+        for (PacketNumber::dtype pn = 0; pn < bandwidth / 1200; pn++) {
+            link.send(Datagram{0, 1200, EcnCodepoint::NotEct,
+                               PacketNumber(pn), nullptr});
+        }
+        EXPECT_EQ(link.stats().datagrams_dropped, 0u);
+
+        sim.run_for(config.propagation_delay
+                    + Duration::from_milliseconds(100));
+        EXPECT_NEAR(link.stats().bytes_delivered, bandwidth / 10, 1200)
+            << bandwidth;
+        sim.run_for(Duration::from_milliseconds(400));
+        EXPECT_NEAR(link.stats().bytes_delivered, bandwidth / 2, 1200)
+            << bandwidth;
+    }
+}
+
+TEST_F(SimTest, LinkLoss) {
+    Simulator sim;
+    config.buffer = 1000000;
+    config.random_loss = 0.1;
+    Link random_link(sim, config, nullptr);
+
+    config.random_loss = 0;
+    // 10% of the datagrams, in bursts of 5
+    config.burst_end = 0.2;
+    config.burst_start = 0.1 * 0.2 / 0.9;
+    Link bursty_link(sim, config, nullptr);
+
+    size_t losses = 0;
+    size_t bursts = 0;
+    for (PacketNumber::dtype pn = 0; pn < 10000; pn++) {
+        random_link.send(make_datagram(pn));
+        uint64_t lost = bursty_link.stats().datagrams_lost;
+        bursty_link.send(make_datagram(pn));
+        if (bursty_link.stats().datagrams_lost > lost) {
+            bursts += losses == 0;
+            losses += 1;
+        } else {
+            losses = 0;
+        }
+    }
+    EXPECT_NEAR(random_link.stats().datagrams_lost, 1000, 150);
+    EXPECT_NEAR(bursty_link.stats().datagrams_lost, 1000, 300);
+    EXPECT_NEAR(bursty_link.stats().datagrams_lost / double(bursts), 5, 1);
+}
+
+TEST_F(SimTest, LinkReorderAndMark) {
+    Simulator sim;
+    config.reorder = 0.5;
+    config.reorder_delay = Duration::from_milliseconds(3);
+    config.ce_threshold = Duration::from_microseconds(4500);
+    Link link(sim, config, [this](Instant now, Datagram &datagram) {
+        on_datagram(now, datagram);
+    });
+
+    for (PacketNumber::dtype pn = 0; pn < 10; pn++) {
+        link.send(make_datagram(pn));
+    }
+    sim.run_until(Instant::infinite());
+
+    ASSERT_EQ(received.size(), 10u);
+    EXPECT_GT(link.stats().datagrams_reordered, 0u);
+    EXPECT_FALSE(std::is_sorted(received.begin(), received.end()));
+    EXPECT_TRUE(std::is_sorted(arrivals.begin(), arrivals.end()));
+
+    // the datagrams that waited more than 4.5 ms
+    EXPECT_EQ(link.stats().datagrams_marked, 5u);
+    for (size_t i = 0; i < received.size(); i++) {
+        EXPECT_EQ(ecn[i] == EcnCodepoint::Ce, received[i] >= 5) << i;
+    }
+}
+
+TEST_F(SimTest, StepAqm) {
+    Simulator sim;
+    config.ce_threshold = Duration::from_microseconds(4500);
+    config.l4s_ce_threshold = Duration::from_microseconds(1500);
+    Link link(sim, config, [this](Instant now, Datagram &datagram) {
+        on_datagram(now, datagram);
+    });
+
+    // ECT(1), ECT(0) and Not-ECT in turn, one every millisecond of queue
+    const EcnCodepoint codepoints[] = {
+        EcnCodepoint::Ect1, EcnCodepoint::Ect0, EcnCodepoint::NotEct};
+    for (PacketNumber::dtype pn = 0; pn < 9; pn++) {
+        Datagram datagram = make_datagram(pn);
+        datagram.ecn = codepoints[pn % 3];
+        link.send(std::move(datagram));
+    }
+    sim.run_until(Instant::infinite());
+
+    // ECT(1) is marked from 2 ms of queue on; ECT(0) from 5 ms, and
+    // Not-ECT is dropped instead
+    EXPECT_EQ(received, (std::vector<PacketNumber::dtype>{
+        0, 1, 2, 3, 4, 6, 7}));
+    EXPECT_EQ(ecn, (std::vector<EcnCodepoint>{
+        EcnCodepoint::Ect1, EcnCodepoint::Ect0, EcnCodepoint::NotEct,
+        EcnCodepoint::Ce, EcnCodepoint::Ect0, EcnCodepoint::Ce,
+        EcnCodepoint::Ce}));
+    EXPECT_EQ(link.stats().datagrams_marked, 3u);
+    EXPECT_EQ(link.stats().datagrams_dropped, 2u);
+}
+
+// A flow fills the bottleneck, and recovers from the losses.
+TEST_F(SimTest, BulkFlow) {
+    Simulator sim;
+    // 10 Mbps, 40 ms RTT, a BDP of buffer
+    config.bandwidth = 1250000;
+    config.propagation_delay = Duration::from_milliseconds(20);
+    config.buffer = 50000;
+    LinkConfig reverse = config;
+    reverse.bandwidth *= 10;
+
+    Dumbbell dumbbell(sim, config, reverse);
+    QuicConfig quic_config;
+    quic_config.congestion_control = "reno";
+    dumbbell.add_flow(quic_config);
+    dumbbell.sample_every(Duration::from_seconds(1));
+    dumbbell.record_queueing_delays();
+    sim.run_for(Duration::from_seconds(20));
+
+    SimSender &sender = dumbbell.sender(0);
+    double goodput = sender.bytes_acked() / 20.0;
+    EXPECT_GT(goodput, 0.8 * config.bandwidth);
+    EXPECT_GT(sender.bytes_lost(), 0u);
+    // the datagrams dropped at the end are not declared lost yet
+    EXPECT_LE(sender.bytes_lost() / (kMaxDatagramSize - kSimPacketOverhead),
+              dumbbell.forward().stats().datagrams_dropped);
+    EXPECT_GT(dumbbell.receiver(0).acks_sent(), 0u);
+
+    ASSERT_EQ(dumbbell.timeline().size(), 20u);
+    const TimelineSample &last = dumbbell.timeline().back();
+    EXPECT_GT(last.goodput, 0.7 * config.bandwidth);
+    EXPECT_GT(last.smoothed_rtt, Duration::from_milliseconds(40));
+    EXPECT_LE(last.queueing_delay, Duration::from_milliseconds(41));
+    // a full buffer holds 40 ms of datagrams
+    const RttHistogram &delays = dumbbell.queueing_delays(0);
+    EXPECT_GT(delays.count(), 10000u);
+    EXPECT_GT(delays.percentile(0.99), Duration::from_milliseconds(30));
+    EXPECT_LE(delays.percentile(0.5), Duration::from_milliseconds(41));
+    // and the RTT samples of the connection add the 40 ms of propagation
+    const RttHistogram &rtts = sender.rtt_histogram();
+    EXPECT_GT(rtts.count(), 1000u);
+    EXPECT_GT(rtts.percentile(0.99), Duration::from_milliseconds(70));
+    EXPECT_LT(rtts.percentile(0.99), Duration::from_milliseconds(90));
+
+    std::ostringstream csv;
+    dumbbell.write_csv(csv);
+    EXPECT_EQ(csv.str().substr(0, 8), "time_ms,");
+    EXPECT_NE(csv.str().find("\n20000,0,reno,"), std::string::npos);
+}
+
+// BBR sends ECT(1) and keeps an L4S queue short from the CE marks alone.
+TEST_F(SimTest, BbrEcn) {
+    Simulator sim;
+    config.bandwidth = 6250000;
+    config.propagation_delay = Duration::from_milliseconds(20);
+    config.buffer = 250000;
+    config.l4s_ce_threshold = Duration::from_milliseconds(2);
+
+    Dumbbell dumbbell(sim, config, Dumbbell::reverse_of(config));
+    QuicConfig quic_config;
+    quic_config.congestion_control = "bbr";
+    dumbbell.add_flow(quic_config);
+    sim.run_for(Duration::from_seconds(2));
+    dumbbell.record_queueing_delays();
+    sim.run_for(Duration::from_seconds(8));
+
+    EXPECT_GT(dumbbell.forward().stats().datagrams_marked, 0u);
+    EXPECT_EQ(dumbbell.forward().stats().datagrams_dropped, 0u);
+    EXPECT_GT(dumbbell.sender(0).bytes_acked(), 0.7 * 10 * config.bandwidth);
+    // the whole buffer is 40 ms
+    EXPECT_LT(dumbbell.queueing_delays(0).percentile(0.99),
+              Duration::from_milliseconds(20));
+}
+
+// The same seeds give the same run; random loss costs the flows
+// throughput, but does not stall them.
+TEST_F(SimTest, Repeatable) {
+    auto run = [this](const char *cc, double loss) {
+        Simulator sim;
+        config.random_loss = loss;
+        Dumbbell dumbbell(sim, config, config);
+        QuicConfig quic_config;
+        quic_config.congestion_control = cc;
+        dumbbell.add_flow(quic_config);
+        sim.run_for(Duration::from_seconds(10));
+        return dumbbell.sender(0).bytes_acked();
+    };
+    for (const char *cc : {"reno", "cubic", "bbr", "copa", "prague"}) {
+        EXPECT_EQ(run(cc, 0.01), run(cc, 0.01)) << cc;
+        EXPECT_GT(run(cc, 0.01), 0.1 * 10 * config.bandwidth) << cc;
+    }
+}
@@ -0,0 +1,26 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#include "sim/simulator.h"
+
+Simulator::Simulator(Instant start)
+    : now_(start),
+      steps_(0)
+{}
+
+void Simulator::run_until(Instant end) {
+    for (Instant deadline = alarms_.next_deadline();
+         !deadline.is_infinite() && deadline <= end;
+         deadline = alarms_.next_deadline()) {
+        // An alarm set in the past fires now; the clock never goes back.
+        if (deadline > now_) {
+            now_ = deadline;
+        }
+        alarms_.fire(now_);
+        steps_ += 1;
+    }
+    if (!end.is_infinite() && end > now_) {
+        now_ = end;
+    }
+}
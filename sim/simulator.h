@@ -0,0 +1,66 @@
+//
+// Created by Chengke Wong on 2020/6/1.
+//
+
+#ifndef SIM_SIMULATOR_H
+#define SIM_SIMULATOR_H
+
+#include <cstdint>
+
+#include "util/alarm.h"
+#include "util/instant.h"
+
+// A discrete-event simulation on a virtual clock. Everything in the tree
+// already takes the time as an Instant and schedules its timers on an
+// AlarmManager, so the simulator is the clock and the alarms together:
+// the events are the alarms, fired in time order, and the clock jumps
+// from one deadline to the next. A simulated minute takes as long as its
+// events take to run.
+//
+//     Simulator sim;
+//     LossRecovery recovery(sim.alarms(), config, true);
+//     ...
+//     sim.run_for(Duration::from_seconds(10));
+class Simulator {
+
+public:
+
+    explicit Simulator(Instant start = Instant(1000000));
+
+    inline Instant now() const {
+        return now_;
+    }
+
+    inline AlarmManager &alarms() {
+        return alarms_;
+    }
+
+    // Fire the alarms in time order up to |end|, including the ones set
+    // on the way; the clock is at |end| afterwards. With an infinite
+    // |end|, run until no alarm is left.
+    void run_until(Instant end);
+
+    inline void run_for(Duration length) {
+        run_until(now_ + length);
+    }
+
+    // the number of distinct times the clock has stopped at
+    inline uint64_t steps() const {
+        return steps_;
+    }
+
+    // disallow copy and assignment; the alarms refer to the manager
+    Simulator (const Simulator&) = delete;
+    Simulator& operator= (const Simulator&) = delete;
+
+private:
+
+    AlarmManager alarms_;
+
+    Instant now_;
+
+    uint64_t steps_;
+
+};
+
+#endif //SIM_SIMULATOR_H
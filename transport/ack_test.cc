@@ -0,0 +1,165 @@
+//
+// Created by Chengke Wong on 2020/5/16.
+//
+
+#include "gtest/gtest.h"
+#include "common/frame.h"
+#include "transport/received_packet_tracker.h"
+
+class AckTest : public ::testing::Test {
+protected:
+    AckTest() = default;
+
+    ~AckTest() override = default;
+
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+    }
+
+    void receive(PNSpace space, uint64_t begin, uint64_t end) {
+        for (uint64_t pn = begin; pn < end; pn++) {
+            EXPECT_TRUE(trackers[space].on_packet_received(pn, true, now));
+        }
+    }
+
+    // write the ACK frame of |space| into a buffer of |size| bytes and
+    // parse it back
+    unique_ptr<AckFrame> generate_ack(PNSpace space, size_t size = 1200) {
+        String buffer(size);
+        StringWriter writer(buffer);
+        size_t length = trackers[space].write_ack_frame(writer, now);
+        if (length == 0) {
+            return nullptr;
+        }
+        EXPECT_EQ(length, writer.position());
+
+        StringReader reader(buffer.data(), length);
+        EXPECT_EQ(reader.read_with_variant_length(), FRAME_TYPE_ACK);
+        unique_ptr<AckFrame> frame(AckFrame::from_reader(reader, false));
+        EXPECT_TRUE(reader.empty());
+        return frame;
+    }
+
+    Instant now = Instant(1000000);
+    AlarmManager alarms;
+    ReceivedPacketTrackers trackers{alarms, kDefaultMaxAckDelay};
+};
+
+TEST_F(AckTest, Duplicate) {
+    ReceivedPacketTracker &tracker = trackers[PNSpace::Application];
+    receive(PNSpace::Application, 0, 3);
+    receive(PNSpace::Application, 5, 6);
+    EXPECT_FALSE(tracker.on_packet_received(1, true, now));
+    EXPECT_FALSE(tracker.on_packet_received(5, true, now));
+    EXPECT_TRUE(tracker.on_packet_received(4, true, now));
+    EXPECT_TRUE(tracker.on_packet_received(3, true, now));
+    EXPECT_FALSE(tracker.on_packet_received(4, true, now));
+    EXPECT_EQ(tracker.largest_received().value().value, 5);
+    EXPECT_EQ(tracker.expected_packet_number(), 6);
+}
+
+TEST_F(AckTest, Ranges) {
+    receive(PNSpace::Application, 0, 3);
+    receive(PNSpace::Application, 5, 6);
+    receive(PNSpace::Application, 8, 12);
+
+    unique_ptr<AckFrame> ack = generate_ack(PNSpace::Application);
+    ASSERT_TRUE(ack);
+    EXPECT_EQ(ack->largest_ack.value, 11);
+    ASSERT_EQ(ack->ranges.size(), 3);
+    EXPECT_EQ(ack->ranges[0].start, 8);
+    EXPECT_EQ(ack->ranges[0].length, 4);
+    EXPECT_EQ(ack->ranges[1].start, 5);
+    EXPECT_EQ(ack->ranges[1].length, 1);
+    EXPECT_EQ(ack->ranges[2].start, 0);
+    EXPECT_EQ(ack->ranges[2].length, 3);
+}
+
+TEST_F(AckTest, TruncateOldRanges) {
+    for (uint64_t pn = 0; pn < 200; pn += 2) {
+        receive(PNSpace::Application, pn, pn + 1);
+    }
+
+    unique_ptr<AckFrame> ack = generate_ack(PNSpace::Application);
+    ASSERT_TRUE(ack);
+    EXPECT_EQ(ack->ranges.size(), ReceivedPacketTracker::kMaxAckRanges + 1);
+    EXPECT_EQ(ack->largest_ack.value, 198);
+
+    receive(PNSpace::Application, 200, 201);
+    ack = generate_ack(PNSpace::Application, 20);
+    ASSERT_TRUE(ack);
+    EXPECT_LT(ack->ranges.size(), 10);
+    EXPECT_EQ(ack->ranges[0].start, 200);
+}
+
+TEST_F(AckTest, DelayedAck) {
+    ReceivedPacketTracker &tracker = trackers[PNSpace::Application];
+
+    receive(PNSpace::Application, 0, 1);
+    EXPECT_TRUE(tracker.ack_pending());
+    EXPECT_FALSE(tracker.ack_required());
+    EXPECT_EQ(alarms.next_deadline(), now + kDefaultMaxAckDelay);
+
+    // the second ack-eliciting packet triggers an ACK
+    receive(PNSpace::Application, 1, 2);
+    EXPECT_TRUE(tracker.ack_required());
+    EXPECT_TRUE(alarms.next_deadline().is_infinite());
+
+    EXPECT_TRUE(generate_ack(PNSpace::Application));
+    EXPECT_FALSE(tracker.ack_pending());
+    EXPECT_FALSE(tracker.ack_required());
+
+    // max_ack_delay expires
+    receive(PNSpace::Application, 2, 3);
+    EXPECT_FALSE(tracker.ack_required());
+    alarms.fire(now + kDefaultMaxAckDelay);
+    EXPECT_TRUE(tracker.ack_required());
+}
+
+TEST_F(AckTest, ImmediateAck) {
+    ReceivedPacketTracker &tracker = trackers[PNSpace::Application];
+
+    receive(PNSpace::Application, 0, 2);
+    EXPECT_TRUE(generate_ack(PNSpace::Application));
+
+    // a gap
+    receive(PNSpace::Application, 3, 4);
+    EXPECT_TRUE(tracker.ack_required());
+    EXPECT_TRUE(generate_ack(PNSpace::Application));
+
+    // reordering
+    receive(PNSpace::Application, 2, 3);
+    EXPECT_TRUE(tracker.ack_required());
+    EXPECT_TRUE(generate_ack(PNSpace::Application));
+
+    // non-ack-eliciting packets are never acknowledged on their own
+    EXPECT_TRUE(tracker.on_packet_received(4, false, now));
+    EXPECT_TRUE(tracker.ack_pending());
+    EXPECT_FALSE(tracker.ack_required());
+
+    // Handshake packets are acknowledged immediately
+    receive(PNSpace::Handshake, 0, 1);
+    EXPECT_TRUE(trackers[PNSpace::Handshake].ack_required());
+}
+
+// The peer has acknowledged an ACK that covered every packet.
+TEST_F(AckTest, DropAllRanges) {
+    ReceivedPacketTracker &tracker = trackers[PNSpace::Application];
+    receive(PNSpace::Application, 0, 300);
+    EXPECT_TRUE(generate_ack(PNSpace::Application));
+
+    tracker.drop_below(300);
+    EXPECT_FALSE(generate_ack(PNSpace::Application));
+    EXPECT_EQ(tracker.largest_received().value().value, 299);
+    ASSERT_EQ(tracker.expected_packet_number(), 300);
+    // 300 truncated to one byte
+    EXPECT_EQ(PacketNumber::decode(tracker.expected_packet_number(),
+                                   0x2c, 1), 300);
+
+    // a gap after the dropped ranges still asks for an immediate ACK
+    receive(PNSpace::Application, 301, 302);
+    EXPECT_TRUE(tracker.ack_required());
+    EXPECT_EQ(tracker.largest_received().value().value, 301);
+}
@@ -0,0 +1,97 @@
+//
+// Created by Chengke Wong on 2020/5/20.
+//
+
+#include "transport/datagram_iterator.h"
+
+#include <algorithm>
+
+#include "common/quic_types.h"
+#include "util/string_reader.h"
+
+size_t DatagramIterator::packet_size(StringRef &dcid) const {
+    StringRef rest = datagram_.sub_string(position_);
+    StringReader reader(rest.data(), rest.size());
+
+    uint8_t first_byte = reader.read_u8();
+
+    if ((first_byte & 0x80) == 0) {
+        // A short header packet is always the last one. Its Destination
+        // Connection ID has the same length as the one in the first
+        // packet (i.e. ours).
+        size_t length = std::min(first_dcid_.size(), rest.size() - 1);
+        dcid = rest.sub_string(1, 1 + length);
+        return rest.size();
+    }
+
+    Version version = reader.read_u32();
+
+    uint8_t dcid_length = reader.read_u8();
+    if (dcid_length > 20) {
+        throw error_discard_packet("the CID is longer than 20 bytes");
+    }
+    dcid = StringRef(reader.peek_data(), dcid_length);
+    reader.skip(dcid_length);
+
+    uint8_t scid_length = reader.read_u8();
+    if (scid_length > 20) {
+        throw error_discard_packet("the CID is longer than 20 bytes");
+    }
+    reader.skip(scid_length);
+
+    PacketType type = static_cast<PacketType>((first_byte & 0x30) >> 4);
+
+    // Version Negotiation and Retry packets have no Length field.
+    if (version == 0 || type == PacketType::Retry) {
+        return rest.size();
+    }
+
+    if (type == PacketType::Initial) {
+        uint64_t token_length = reader.read_with_variant_length();
+        reader.skip(token_length);
+    }
+
+    uint64_t length = reader.read_with_variant_length();
+    if (length > reader.remaining()) {
+        throw error_discard_packet("the Length field exceeds the datagram");
+    }
+
+    return reader.position() + length;
+}
+
+bool DatagramIterator::next(StringRef &packet) {
+    if (position_ >= datagram_.size()) {
+        return false;
+    }
+
+    bool is_first = position_ == 0;
+
+    if (!is_first && (datagram_[position_] & 0x40) == 0) {
+        // not a QUIC packet; most likely padding
+        position_ = datagram_.size();
+        return false;
+    }
+
+    StringRef dcid;
+    size_t size;
+    try {
+        size = packet_size(dcid);
+    } catch (const std::exception &e) {
+        position_ = datagram_.size();
+        if (is_first) {
+            throw error_discard_packet(e.what());
+        }
+        return false;
+    }
+
+    if (is_first) {
+        first_dcid_ = dcid;
+    } else if (!(dcid == first_dcid_)) {
+        position_ = datagram_.size();
+        return false;
+    }
+
+    packet = datagram_.sub_string(position_, position_ + size);
+    position_ += size;
+    return true;
+}
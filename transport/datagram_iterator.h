@@ -0,0 +1,69 @@
+//
+// Created by Chengke Wong on 2020/5/20.
+//
+
+#ifndef TRANSPORT_DATAGRAM_ITERATOR_H
+#define TRANSPORT_DATAGRAM_ITERATOR_H
+
+#include "util/string_raw.h"
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-coalescing-packets
+// Walks the QUIC packets coalesced in a single UDP datagram, e.g. an
+// Initial, a Handshake and a 1-RTT packet sent together by the server.
+//
+// Long header packets are delimited by their Length field, and a short
+// header packet takes up the rest of the datagram. Only the fields
+// needed to find the end of each packet are looked at, and the packets
+// are returned as views into the datagram; nothing is copied or
+// allocated.
+//
+//     DatagramIterator iter(datagram);
+//     StringRef packet;
+//     while (iter.next(packet)) {
+//         ...
+//     }
+class DatagramIterator {
+
+public:
+
+    explicit DatagramIterator(StringRef datagram)
+        : datagram_(datagram),
+          position_(0),
+          first_dcid_(StringRef::empty_string())
+        {}
+
+    // Store the next packet into |packet|. Return false when there are no
+    // more packets. Trailing bytes that do not start a packet (e.g. zero
+    // padding added after the last packet) and packets whose Destination
+    // Connection ID differs from the first one are ignored.
+    //
+    // throw error_discard_packet if the first packet is malformed. A
+    // malformed packet after the first one ends the iteration; the
+    // packets returned so far are still valid.
+    bool next(StringRef &packet);
+
+    inline size_t position() const {
+        return position_;
+    }
+
+    // disallow copy and assignment
+    DatagramIterator (const DatagramIterator&) = delete;
+    DatagramIterator& operator=(const DatagramIterator&) = delete;
+
+private:
+
+    // return the size of the packet starting at |position_|, and set
+    // |dcid| to its Destination Connection ID
+    size_t packet_size(StringRef &dcid) const;
+
+    StringRef datagram_;
+
+    size_t position_;
+
+    // the Destination Connection ID of the first packet; its length is
+    // also the length of our CIDs in short headers
+    StringRef first_dcid_;
+
+};
+
+#endif //TRANSPORT_DATAGRAM_ITERATOR_H
@@ -21,6 +21,7 @@ public:
 enum class QuicError : uint8_t {
     INTERNAL_ERROR = 0x1,
     FRAME_ENCODING_ERROR = 0x7,
+    PROTOCOL_VIOLATION = 0xa,
 };
 
 class quic_error : public std::exception {
@@ -29,6 +30,10 @@ public:
     explicit quic_error(QuicError error) 
         : std::exception(), error_(error) {}
 
+    inline QuicError error() const {
+        return error_;
+    }
+
 private:
 
     QuicError error_;
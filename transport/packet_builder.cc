@@ -0,0 +1,170 @@
+//
+// Created by Chengke Wong on 2020/5/21.
+//
+
+#include "transport/packet_builder.h"
+
+#include <algorithm>
+
+#include "crypto/aead.h"
+#include "crypto/hp.h"
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-long-header-packets
+//
+//   Long Header Packet {
+//     Header Form (1) = 1,
+//     Fixed Bit (1) = 1,
+//     Long Packet Type (2),
+//     Reserved Bits (2),         [protected]
+//     Packet Number Length (2),  [protected]
+//     Version (32),
+//     Destination Connection ID Length (8),
+//     Destination Connection ID (0..160),
+//     Source Connection ID Length (8),
+//     Source Connection ID (0..160),
+//     Token Length (i),          [Initial only]
+//     Token (..),                [Initial only]
+//     Length (i),
+//     Packet Number (8..32),     [protected]
+//     Packet Payload (..),
+//   }
+StringWriter &PacketBuilder::begin_long_packet(PacketType type,
+                                               Version version,
+                                               const Cid &dcid,
+                                               const Cid &scid,
+                                               StringRef token,
+                                               PacketNumber pn,
+                                               size_t pn_length) {
+    DCHECK(!payload_);
+    DCHECK(!has_short_packet_);
+    DCHECK(type == PacketType::Initial || type == PacketType::ZeroRTT ||
+           type == PacketType::Handshake);
+    DCHECK(pn_length >= 1 && pn_length <= 4);
+
+    StringWriter header(buffer_.sub_string(position_));
+    header.write_u8(0xc0 | (static_cast<uint8_t>(type) << 4) |
+                    (pn_length - 1));
+    header.write_u32(version);
+    header.write_u8(dcid.size());
+    header.write(dcid.as_string_ref());
+    header.write_u8(scid.size());
+    header.write(scid.as_string_ref());
+    if (type == PacketType::Initial) {
+        header.write_with_variant_length(token.size());
+        header.write(token);
+    }
+    // filled in by finish_packet()
+    header.skip(kLengthFieldSize);
+
+    is_long_ = true;
+    return begin_payload(header, pn, pn_length);
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-short-header-packets
+StringWriter &PacketBuilder::begin_short_packet(const Cid &dcid,
+                                                PacketNumber pn,
+                                                size_t pn_length,
+                                                bool spin_bit,
+                                                bool key_phase) {
+    DCHECK(!payload_);
+    DCHECK(!has_short_packet_);
+    DCHECK(pn_length >= 1 && pn_length <= 4);
+
+    StringWriter header(buffer_.sub_string(position_));
+    header.write_u8(0x40 | (spin_bit ? 0x20 : 0) | (key_phase ? 0x04 : 0) |
+                    (pn_length - 1));
+    header.write(dcid.as_string_ref());
+
+    is_long_ = false;
+    has_short_packet_ = true;
+    return begin_payload(header, pn, pn_length);
+}
+
+StringWriter &PacketBuilder::begin_payload(StringWriter &header,
+                                           PacketNumber pn,
+                                           size_t pn_length) {
+    PacketNumber::to_writer(header, pn.value, pn_length);
+    pn_offset_ = position_ + header.position() - pn_length;
+    pn_length_ = pn_length;
+    pn_ = pn;
+
+    size_t payload_offset = position_ + header.position();
+    if (payload_offset + kTagLength > buffer_.size()) {
+        throw std::overflow_error("no room for the packet payload");
+    }
+    payload_.emplace(
+        buffer_.sub_string(payload_offset, buffer_.size() - kTagLength));
+    return payload_.value();
+}
+
+size_t PacketBuilder::finish_packet(const Cipher &cipher,
+                                    size_t pad_datagram_to) {
+    DCHECK(payload_);
+    DCHECK(crypto::get_tag_length(cipher.aead_algorithm()) == kTagLength);
+    DCHECK(cipher.iv().size() == kNonceLength);
+
+    StringWriter &payload = payload_.value();
+    size_t payload_offset = pn_offset_ + pn_length_;
+
+    // In sampling the packet ciphertext, the Packet Number field is
+    // assumed to be 4 bytes long; the tag covers the 16 bytes of the
+    // sample beyond that.
+    size_t min_length = kSampleOffset > pn_length_
+        ? kSampleOffset - pn_length_ : 0;
+    if (pad_datagram_to > payload_offset + kTagLength) {
+        min_length = std::max(min_length,
+                              pad_datagram_to - payload_offset - kTagLength);
+    }
+    min_length = std::min(min_length, payload.size());
+    if (payload.position() < min_length) {
+        // PADDING frames
+        size_t padding = min_length - payload.position();
+        memset(payload.peek_data(), 0, padding);
+        payload.skip(padding);
+    }
+
+    size_t packet_end = payload_offset + payload.position() + kTagLength;
+
+    if (is_long_) {
+        size_t length = pn_length_ + payload.position() + kTagLength;
+        DCHECK(length < (1u << 14));
+        buffer_[pn_offset_ - 2] = 0x40 | static_cast<uint8_t>(length >> 8);
+        buffer_[pn_offset_ - 1] = static_cast<uint8_t>(length);
+    }
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-tls.html#name-aead-usage
+    // The nonce, N, is formed by combining the packet protection IV with
+    // the packet number. The 62 bits of the reconstructed QUIC packet
+    // number in network byte order are left-padded with zeros to the size
+    // of the IV. The exclusive OR of the padded packet number and the IV
+    // forms the AEAD nonce.
+    uint8_t nonce[kNonceLength];
+    memcpy(nonce, cipher.iv().data(), kNonceLength);
+    for (size_t i = 0; i < 8; i++) {
+        nonce[kNonceLength - 1 - i] ^= static_cast<uint8_t>(pn_.value >> (i * 8));
+    }
+
+    // The associated data, A, for the AEAD is the contents of the QUIC
+    // header, starting from the flags byte in either the short or long
+    // header, up to and including the unprotected packet number.
+    crypto::aead_encrypt_inplace(
+        cipher.aead_algorithm(), cipher.key(),
+        buffer_.sub_string(payload_offset, packet_end),
+        StringRef(nonce, kNonceLength),
+        buffer_.sub_string(position_, payload_offset));
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-tls.html#name-header-protection-applicati
+    size_t sample_offset = pn_offset_ + kSampleOffset;
+    String mask = crypto::get_hp_mask(
+        cipher.hp_algorithm(), cipher.hp(),
+        buffer_.sub_string(sample_offset, sample_offset + kSampleLength));
+    buffer_[position_] ^= mask[0] & (is_long_ ? 0x0f : 0x1f);
+    for (size_t i = 0; i < pn_length_; i++) {
+        buffer_[pn_offset_ + i] ^= mask[1 + i];
+    }
+
+    size_t packet_size = packet_end - position_;
+    position_ = packet_end;
+    payload_ = std::experimental::nullopt;
+    return packet_size;
+}
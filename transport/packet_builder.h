@@ -0,0 +1,128 @@
+//
+// Created by Chengke Wong on 2020/5/21.
+//
+
+#ifndef TRANSPORT_PACKET_BUILDER_H
+#define TRANSPORT_PACKET_BUILDER_H
+
+#include "common/quic_types.h"
+#include "crypto/cipher.h"
+#include "util/optional.h"
+#include "util/string_writer.h"
+
+using std::experimental::optional;
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-coalescing-packets
+// Assembles the packets of one outgoing datagram in place.
+//
+// Each packet is written straight into the datagram buffer: the header
+// first, with the Length field reserved in a fixed 2-byte encoding, then
+// the frames, and the room for the AEAD tag is held back from the frame
+// writer. Nothing is moved once written; finishing a packet fills in the
+// Length, encrypts the payload in place and applies header protection.
+//
+//     PacketBuilder builder(buffer);
+//     StringWriter &writer = builder.begin_long_packet(
+//         PacketType::Initial, version, dcid, scid, token, pn, pn_length);
+//     ... write frames into |writer| ...
+//     builder.finish_packet(initial_cipher);
+//     StringWriter &writer = builder.begin_long_packet(
+//         PacketType::Handshake, ...);
+//     ...
+//     builder.finish_packet(handshake_cipher, kMinInitialDatagramSize);
+//     send(builder.datagram());
+//
+// A short header packet has no Length field, so it must be the last
+// packet of the datagram.
+class PacketBuilder {
+
+public:
+
+    // The Length field is always encoded in 2 bytes, which holds any
+    // length up to 16383.
+    static constexpr size_t kLengthFieldSize = 2;
+
+    // header protection samples 16 bytes starting 4 bytes after the
+    // start of the Packet Number field
+    static constexpr size_t kSampleOffset = 4;
+    static constexpr size_t kSampleLength = 16;
+
+    // The AEAD algorithms used by QUIC all have a 16-byte tag and a
+    // 12-byte nonce.
+    static constexpr size_t kTagLength = 16;
+    static constexpr size_t kNonceLength = 12;
+
+    // |buffer| holds the whole datagram, e.g. kMaxDatagramSize bytes
+    explicit PacketBuilder(StringRef buffer)
+        : buffer_(buffer),
+          position_(0)
+        {}
+
+    // Start an Initial, 0-RTT or Handshake packet and return the writer
+    // for its frames. |token| is only sent in Initial packets. The
+    // |pn_length| is usually LossRecovery::packet_number_length().
+    //
+    // throw std::overflow_error if the header does not fit.
+    StringWriter &begin_long_packet(PacketType type, Version version,
+                                    const Cid &dcid, const Cid &scid,
+                                    StringRef token, PacketNumber pn,
+                                    size_t pn_length);
+
+    // Start a 1-RTT packet and return the writer for its frames.
+    StringWriter &begin_short_packet(const Cid &dcid, PacketNumber pn,
+                                     size_t pn_length, bool spin_bit,
+                                     bool key_phase);
+
+    // Protect the current packet with |cipher|.
+    //
+    // If the datagram would be shorter than |pad_datagram_to| bytes, the
+    // packet is expanded with PADDING frames to fill it, e.g. to
+    // kMinInitialDatagramSize for a datagram carrying a client Initial.
+    // Packets are also padded so that header protection can take its
+    // sample.
+    //
+    // return the size of the packet
+    size_t finish_packet(const Cipher &cipher, size_t pad_datagram_to = 0);
+
+    // the packets finished so far
+    inline StringRef datagram() const {
+        return buffer_.sub_string(0, position_);
+    }
+
+    inline bool empty() const {
+        return position_ == 0;
+    }
+
+    // the number of bytes left for further packets
+    inline size_t remaining() const {
+        return buffer_.size() - position_;
+    }
+
+    // disallow copy and assignment
+    PacketBuilder (const PacketBuilder&) = delete;
+    PacketBuilder& operator=(const PacketBuilder&) = delete;
+
+private:
+
+    StringWriter &begin_payload(StringWriter &header, PacketNumber pn,
+                                size_t pn_length);
+
+    StringRef buffer_;
+
+    // the end of the finished packets
+    size_t position_;
+
+    // the packet being written
+    bool is_long_ = false;
+    bool has_short_packet_ = false;
+    size_t pn_offset_ = 0;
+    size_t pn_length_ = 0;
+    PacketNumber pn_;
+
+    // the frames of the packet being written; it stops short of the room
+    // for the AEAD tag
+    optional<StringWriter> payload_;
+
+};
+
+#endif //TRANSPORT_PACKET_BUILDER_H
@@ -23,14 +23,49 @@ static inline PacketType long_packet_type(uint8_t first_byte) {
     return static_cast<PacketType>(type);
 }
 
-PacketHeader PacketHeader::from_reader(StringReader &reader) {
+PacketHeader PacketHeader::from_reader(StringReader &reader,
+                                       size_t short_dcid_length) {
     uint8_t first_byte = reader.peek_u8();
 
     if (is_long_packet(first_byte)) {
         return long_packet_from_reader(reader);
-    } else {
+    }
+
+    ShortPacketHeader header =
+        ShortPacketHeader::from_reader(reader, short_dcid_length);
+
+    // short headers do not carry the Source Connection ID
+    PacketHeader result(Cid(), Cid(header.dcid));
+    result.type = PacketType::OneRTT;
+    // The version is implied by the connection.
+    result.version = 0;
+    // the packet takes up the rest of the datagram
+    result.length = reader.remaining();
+    result.header_length = header.header_length;
+    result.spin_bit = header.spin_bit;
+    return result;
+}
 
+ShortPacketHeader ShortPacketHeader::from_reader(StringReader &reader,
+                                                 size_t dcid_length) {
+    size_t start = reader.position();
+    uint8_t first_byte = reader.read_u8();
+    DCHECK(!is_long_packet(first_byte));
+
+    if (reader.remaining() < dcid_length) {
+        throw error_discard_packet("the packet is too short");
     }
+    StringRef dcid(reader.peek_data(), dcid_length);
+    reader.skip(dcid_length);
+
+    ShortPacketHeader result;
+    result.dcid = dcid;
+    result.header_length = reader.position() - start;
+    result.spin_bit = (first_byte & 0x20) != 0;
+    result.key_phase = false;
+    result.pkt_number_len = 0;
+    result.pkt_number = 0;
+    return result;
 }
 
 PacketHeader PacketHeader::long_packet_from_reader(StringReader &reader) {
@@ -48,14 +83,39 @@ PacketHeader PacketHeader::long_packet_from_reader(StringReader &reader) {
     Cid dcid = Cid::from_reader(reader);
     Cid scid = Cid::from_reader(reader);
 
-    PacketHeader result(std::move(scid), std::move(dcid));
+    PacketHeader result(scid, dcid);
     result.type = type;
     result.version = version;
 
-    if (type == PacketType::Initial) {
-        result.token = Token::from_reader(reader);
-        result.length = reader.read_with_variant_length();
+    if (version == 0) {
+        // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-version-negotiation-packet
+        // A Version Negotiation packet is inherently not version-specific.
+        result.type = PacketType::VersionNegotiation;
+        std::vector<Version> versions;
+        while (reader.remaining() >= sizeof(Version)) {
+            versions.push_back(reader.read_u32());
+        }
+        result.versions_ = std::move(versions);
+        result.length = 0;
         result.header_length = reader.position();
+        return result;
+    }
+
+    switch (type) {
+        case PacketType::Initial:
+            result.token = Token::from_reader(reader);
+            // fall through
+        case PacketType::ZeroRTT:
+        case PacketType::Handshake:
+            result.length = reader.read_with_variant_length();
+            result.header_length = reader.position();
+            break;
+        default:
+            // A Retry packet has no Length field and takes up the rest
+            // of the datagram.
+            result.length = reader.remaining();
+            result.header_length = reader.position();
+            break;
     }
 
     return result;
@@ -80,27 +140,33 @@ PacketHeader PacketHeader::long_packet_from_reader(StringReader &reader) {
  * nounce = sample[4..15]
  * mask   = ChaCha20(hp_key, counter, nonce, {0,0,0,0,0})
  */
-void PacketHeader::decrypt(StringRef hp, StringRef packet) {
+// Remove header protection in place and return the unprotected first
+// byte. |pn_length| is set to the length of the Packet Number field.
+static uint8_t remove_header_protection(StringRef hp, StringRef packet,
+                                        size_t header_length,
+                                        size_t &pn_length) {
     // In sampling the packet ciphertext, the Packet Number field is assumed to
     // be 4 bytes long (its maximum possible encoded length).
+    if (packet.size() < header_length + 4 + 16) {
+        throw error_discard_packet("the packet is too short to be sampled");
+    }
     StringRef sample = packet.sub_string(header_length + 4,
                                          header_length + 4 + 16);
 
     String mask = crypto::aes_128_ecb_encrypt(hp, sample);
     uint8_t first_byte = packet[0];
-    if (is_long_packet(first_byte)) {
+    bool is_long = is_long_packet(first_byte);
+    if (is_long) {
         first_byte ^= mask[0] & 0x0f;
     } else {
         first_byte ^= mask[0] & 0x1f;
     }
     packet[0] = first_byte;
 
-    int pn_length = (first_byte & 0x03) + 1;
-
-    pkt_number_len = pn_length;
+    pn_length = (first_byte & 0x03) + 1;
 
-    int pn_offset = header_length;
-    for (int i = 0; i < pn_length; i++) {
+    size_t pn_offset = header_length;
+    for (size_t i = 0; i < pn_length; i++) {
         packet[pn_offset + i] ^= mask[1 + i];
     }
 
@@ -108,15 +174,43 @@ void PacketHeader::decrypt(StringRef hp, StringRef packet) {
     // multiple packet types. These bits are protected using header protection
     // (see Section 5.4 of [QUIC-TLS]). The value included prior to protection
     // MUST be set to 0.
+    //
+    // In short headers, the reserved bits are those with a mask of 0x18.
 
-    if (first_byte & 0x0c) {
+    if (first_byte & (is_long ? 0x0c : 0x18)) {
         throw error_protocol_violation("The Reserved Bits are not zero");
     }
 
+    return first_byte;
+}
+
+void PacketHeader::decrypt(StringRef hp, StringRef packet,
+                           PacketNumber::dtype expected_pn) {
+    uint8_t first_byte = remove_header_protection(hp, packet, header_length,
+                                                  pkt_number_len);
+
+    if (type == PacketType::OneRTT) {
+        key_phase = (first_byte & 0x04) != 0;
+    }
+
     // Now the header decryption is done; we next need to recover
     // the missing data.
-    pkt_number.value = PacketNumber::from_string(
-        packet.sub_string(header_length), pn_length);
+    PacketNumber::dtype truncated = PacketNumber::from_string(
+        packet.sub_string(header_length), pkt_number_len);
+    pkt_number.value =
+        PacketNumber::decode(expected_pn, truncated, pkt_number_len);
 
 }
 
+void ShortPacketHeader::decrypt(StringRef hp, StringRef packet,
+                                PacketNumber::dtype expected_pn) {
+    uint8_t first_byte = remove_header_protection(hp, packet, header_length,
+                                                  pkt_number_len);
+
+    key_phase = (first_byte & 0x04) != 0;
+
+    PacketNumber::dtype truncated = PacketNumber::from_string(
+        packet.sub_string(header_length), pkt_number_len);
+    pkt_number.value =
+        PacketNumber::decode(expected_pn, truncated, pkt_number_len);
+}
@@ -9,22 +9,9 @@
 #include <vector>
 
 #include "util/optional.h"
+#include "common/config.h"
 #include "common/quic_types.h"
 
-// TODO
-
-enum class PacketType {
-    // Long Header Packet Types
-    Initial = 0,
-    ZeroRTT = 1,
-    Handshake = 2,
-    Retry = 3,
-    // Version Negotiation
-    VersionNegotiation = 4,
-    // Short Header Packet Types
-    OneRTT = 5,
-};
-
 using std::experimental::optional;
 
 struct PacketHeader {
@@ -44,24 +31,39 @@ struct PacketHeader {
     optional< std::vector<Version> > versions_;
 
     // [encrypted] only in long packet header
-    size_t pkt_number_len;
+    size_t pkt_number_len = 0;
 
     // [encrypted]
-    PacketNumber pkt_number;
+    PacketNumber pkt_number = 0;
 
     // only present in Initial and Retry
     optional<String> token;
 
-    PacketHeader(Cid &&scid, Cid &&dcid)
-        : scid(std::move(scid)),
-          dcid(std::move(dcid)) {}
+    // only in short packet header
+    bool spin_bit = false;
+
+    // [encrypted] only in short packet header
+    bool key_phase = false;
+
+    PacketHeader(const Cid &scid, const Cid &dcid)
+        : scid(scid),
+          dcid(dcid) {}
 
     /* The header protection algorithm uses both the header protection key
-     * and a sample of the ciphertext from the packet Payload field. */
+     * and a sample of the ciphertext from the packet Payload field.
+     *
+     * |expected_pn| is one more than the largest packet number received
+     * in the packet number space, used to recover the full packet number
+     * from the truncated one. */
 
-    void decrypt(StringRef hp, StringRef packet);
+    void decrypt(StringRef hp, StringRef packet,
+                 PacketNumber::dtype expected_pn = 0);
 
-    static PacketHeader from_reader(StringReader &reader);
+    // A short header does not carry the length of the Destination
+    // Connection ID; it is |short_dcid_length|, the length of the CIDs
+    // we issue.
+    static PacketHeader from_reader(StringReader &reader,
+                                    size_t short_dcid_length = kDefaultCidLength);
 
     static PacketHeader long_packet_from_reader(StringReader &reader);
 
@@ -71,4 +73,50 @@ struct PacketHeader {
 };
 
 
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-short-header-packets
+// The fast path for 1-RTT packets, which carry almost all the traffic.
+// Unlike PacketHeader, the Destination Connection ID is not copied: it
+// is a view into the packet, so the packet must outlive the header.
+//
+//   1-RTT Packet {
+//     Header Form (1) = 0,
+//     Fixed Bit (1) = 1,
+//     Spin Bit (1),
+//     Reserved Bits (2),        [encrypted]
+//     Key Phase (1),            [encrypted]
+//     Packet Number Length (2), [encrypted]
+//     Destination Connection ID (0..160),
+//     Packet Number (8..32),    [encrypted]
+//     Packet Payload (..),
+//   }
+struct ShortPacketHeader {
+
+    StringRef dcid;
+
+    // the first byte and the Destination Connection ID
+    size_t header_length;
+
+    bool spin_bit;
+
+    // [encrypted]
+    bool key_phase;
+
+    // [encrypted]
+    size_t pkt_number_len;
+
+    // [encrypted]
+    PacketNumber pkt_number;
+
+    // see PacketHeader::decrypt
+    void decrypt(StringRef hp, StringRef packet,
+                 PacketNumber::dtype expected_pn = 0);
+
+    static ShortPacketHeader from_reader(StringReader &reader,
+                                         size_t dcid_length);
+
+    inline size_t payload_offset() const {
+        return pkt_number_len + header_length;
+    }
+};
+
 #endif //TRANSPORT_PACKET_HEADER_H
@@ -2,9 +2,17 @@
 // Created by Chengke Wong on 2020/4/9.
 //
 
+#include <unordered_map>
+
 #include "gtest/gtest.h"
 #include "util/string_raw.h"
+#include "util/string_writer.h"
 #include "transport/packet_header.h"
+#include "transport/datagram_iterator.h"
+#include "crypto/hp.h"
+#include "crypto/aead.h"
+#include "crypto/cipher.h"
+#include "transport/packet_builder.h"
 
 class PacketTest : public ::testing::Test {
 protected:
@@ -74,6 +82,41 @@ protected:
 
     String client_hp =
         String::from_hex("a980b8b4fb7d9fbc13e814c23164253d");
+
+    // Remove the packet protection of |packet| in place and return its
+    // plaintext payload.
+    StringRef open_packet(const Cipher &cipher, StringRef packet,
+                          PacketHeader &header,
+                          PacketNumber::dtype expected_pn = 0) {
+        header.decrypt(cipher.hp(), packet, expected_pn);
+        size_t end = header.type == PacketType::OneRTT
+            ? packet.size() : header.header_length + header.length;
+        uint8_t nonce[12];
+        memcpy(nonce, cipher.iv().data(), 12);
+        for (size_t i = 0; i < 8; i++) {
+            nonce[11 - i] ^= header.pkt_number.value >> (i * 8);
+        }
+        StringRef text = packet.sub_string(header.payload_offset(), end);
+        crypto::aead_decrypt_inplace(
+            cipher.aead_algorithm(), cipher.key(), text,
+            StringRef(nonce, 12),
+            packet.sub_string(0, header.payload_offset()));
+        return text.sub_string(0, text.size() - 16);
+    }
+
+    // A 1-RTT packet with the spin bit and the key phase set and a 2-byte
+    // packet number 0x1234, protected with |client_hp|.
+    String make_short_packet() {
+        String packet = String::from_hex(
+            "65 8394c8f03e515708 1234"
+            "000102030405060708090a0b0c0d0e0f 101112131415161718191a1b");
+        String mask = crypto::aes_128_ecb_encrypt(
+            client_hp, packet.sub_string(13, 13 + 16));
+        packet[0] ^= mask[0] & 0x1f;
+        packet[9] ^= mask[1];
+        packet[10] ^= mask[2];
+        return packet;
+    }
 };
 
 TEST_F(PacketTest, DecodeHeader) {
@@ -119,3 +162,262 @@ TEST_F(PacketTest, DecryptHeader2) {
     EXPECT_EQ(header.pkt_number_len, 2);
     EXPECT_EQ(header.payload_offset(), 20);
 }
+
+TEST_F(PacketTest, CoalescedPackets) {
+    String handshake = String::from_hex(
+        "e0ff00001b0008f067a5502a4262b5 05 0102030405");
+    String one_rtt = String::from_hex("41 aabbcc");
+
+    String datagram(server_initial.size() + handshake.size() + one_rtt.size());
+    StringWriter writer(datagram);
+    writer.write(server_initial);
+    writer.write(handshake);
+    writer.write(one_rtt);
+
+    DatagramIterator iter(datagram);
+    StringRef packet;
+    ASSERT_TRUE(iter.next(packet));
+    EXPECT_EQ(packet, server_initial);
+    ASSERT_TRUE(iter.next(packet));
+    EXPECT_EQ(packet, handshake);
+    ASSERT_TRUE(iter.next(packet));
+    EXPECT_EQ(packet, one_rtt);
+    EXPECT_FALSE(iter.next(packet));
+}
+
+TEST_F(PacketTest, CoalescedPacketsPadding) {
+    String datagram(initial_packet.size() + 20);
+    memset(datagram.data(), 0, datagram.size());
+    memcpy(datagram.data(), initial_packet.data(), initial_packet.size());
+
+    DatagramIterator iter(datagram);
+    StringRef packet;
+    ASSERT_TRUE(iter.next(packet));
+    EXPECT_EQ(packet.size(), initial_packet.size());
+    EXPECT_FALSE(iter.next(packet));
+}
+
+TEST_F(PacketTest, CoalescedPacketsMismatch) {
+    // the second packet has a different Destination Connection ID
+    String datagram(server_initial.size() + initial_packet.size());
+    StringWriter writer(datagram);
+    writer.write(server_initial);
+    writer.write(initial_packet);
+
+    DatagramIterator iter(datagram);
+    StringRef packet;
+    ASSERT_TRUE(iter.next(packet));
+    EXPECT_FALSE(iter.next(packet));
+
+    // the Length field exceeds the datagram
+    StringRef truncated = initial_packet.sub_string(0, 100);
+    DatagramIterator iter2(truncated);
+    EXPECT_THROW(iter2.next(packet), error_discard_packet);
+}
+
+TEST_F(PacketTest, ShortHeader) {
+    String packet = make_short_packet();
+    StringReader reader(packet);
+    ShortPacketHeader header = ShortPacketHeader::from_reader(reader, 8);
+
+    // a view into the packet, not a copy
+    EXPECT_EQ(header.dcid.data(), packet.data() + 1);
+    EXPECT_EQ(header.dcid, String::from_hex("8394c8f03e515708"));
+    EXPECT_EQ(header.header_length, 9);
+    EXPECT_TRUE(header.spin_bit);
+
+    header.decrypt(client_hp, packet);
+    EXPECT_TRUE(header.key_phase);
+    EXPECT_EQ(header.pkt_number_len, 2);
+    EXPECT_EQ(header.pkt_number.value, 0x1234);
+    EXPECT_EQ(header.payload_offset(), 11);
+}
+
+TEST_F(PacketTest, ShortHeaderPacketHeader) {
+    String packet = make_short_packet();
+    StringReader reader(packet);
+    PacketHeader header = PacketHeader::from_reader(reader, 8);
+
+    EXPECT_EQ(header.type, PacketType::OneRTT);
+    EXPECT_EQ(header.dcid.to_hex(), "8394c8f03e515708");
+    EXPECT_EQ(header.scid.to_hex(), "");
+    EXPECT_TRUE(header.spin_bit);
+
+    header.decrypt(client_hp, packet);
+    EXPECT_TRUE(header.key_phase);
+    EXPECT_EQ(header.pkt_number.value, 0x1234);
+    EXPECT_EQ(header.payload_offset(), 11);
+}
+
+TEST_F(PacketTest, ShortHeaderReservedBits) {
+    String packet = make_short_packet();
+    // flip a reserved bit under the protection
+    packet[0] ^= 0x08;
+    StringReader reader(packet);
+    ShortPacketHeader header = ShortPacketHeader::from_reader(reader, 8);
+    EXPECT_THROW(header.decrypt(client_hp, packet), error_protocol_violation);
+
+    StringRef truncated = packet.sub_string(0, 5);
+    StringReader reader2(truncated.data(), truncated.size());
+    EXPECT_THROW(ShortPacketHeader::from_reader(reader2, 8),
+                 error_discard_packet);
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-sample-packet-number-encodi
+TEST_F(PacketTest, PacketNumberEncoding) {
+    static_assert(PacketNumber::encoded_length(0xac5c02, 0xabe8b3 + 1) == 2,
+                  "RFC example");
+    static_assert(PacketNumber::encoded_length(0xace8fe, 0xabe8b3 + 1) == 3,
+                  "RFC example");
+
+    // nothing acknowledged yet
+    EXPECT_EQ(PacketNumber::encoded_length(0, 0), 1);
+    EXPECT_EQ(PacketNumber::encoded_length(127, 0), 1);
+    EXPECT_EQ(PacketNumber::encoded_length(128, 0), 2);
+
+    // steady state: a window of a few hundred packets in flight
+    EXPECT_EQ(PacketNumber::encoded_length(1000128, 1000001), 1);
+    EXPECT_EQ(PacketNumber::encoded_length(1000300, 1000001), 2);
+    EXPECT_EQ(PacketNumber::encoded_length(1 << 30, 0), 4);
+
+    String buffer(4);
+    StringWriter writer(buffer);
+    PacketNumber::to_writer(writer, 0xac5c02, 2);
+    EXPECT_EQ(buffer.sub_string(0, 2), String::from_hex("5c02"));
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-sample-packet-number-decodi
+TEST_F(PacketTest, PacketNumberDecoding) {
+    static_assert(PacketNumber::decode(0xa82f30ea + 1, 0x9b32, 2) ==
+                  0xa82f9b32, "RFC example");
+
+    EXPECT_EQ(PacketNumber::decode(0, 5, 1), 5);
+    // wrap around the window in either direction
+    EXPECT_EQ(PacketNumber::decode(0x1fe, 0x01, 1), 0x201);
+    EXPECT_EQ(PacketNumber::decode(0x201, 0xff, 1), 0x1ff);
+    // the first window has nothing below it
+    EXPECT_EQ(PacketNumber::decode(0x10, 0xf0, 1), 0xf0);
+
+    // round trip with the minimal length
+    for (PacketNumber::dtype largest_acked : {0ul, 1000ul, 70000ul}) {
+        for (PacketNumber::dtype pn = largest_acked + 1;
+             pn < largest_acked + 40000; pn += 97) {
+            size_t length = PacketNumber::encoded_length(pn, largest_acked + 1);
+            PacketNumber::dtype truncated =
+                pn & ((PacketNumber::dtype(1) << (length * 8)) - 1);
+            // the receiver has received at least the acknowledged packets
+            EXPECT_EQ(PacketNumber::decode(largest_acked + 1, truncated,
+                                           length), pn);
+        }
+    }
+
+    String packet = String::from_hex("ff");
+    EXPECT_EQ(PacketNumber::from_string(packet, 1), 0xff);
+}
+
+TEST_F(PacketTest, Cid) {
+    String bytes = String::from_hex("8394c8f03e515708aabbccddeeff00112233445566");
+    Cid a(bytes.data(), 8);
+    Cid b(bytes.sub_string(0, 8));
+    Cid c(bytes.data(), 9);
+    Cid d(bytes.data(), 20);
+    Cid e(bytes.data() + 1, 20);
+
+    EXPECT_EQ(sizeof(Cid), 24);
+    EXPECT_EQ(a.to_hex(), "8394c8f03e515708");
+    EXPECT_TRUE(a == b);
+    EXPECT_FALSE(a == c);
+    EXPECT_FALSE(d == e);
+    EXPECT_TRUE(Cid() == Cid(bytes.data(), 0));
+    EXPECT_THROW(Cid(bytes.data(), 21), error_discard_packet);
+
+    CidHash hash(42);
+    EXPECT_EQ(hash(a), hash(b));
+    EXPECT_NE(hash(a), hash(c));
+    EXPECT_NE(hash(d), hash(e));
+    EXPECT_NE(CidHash(1)(a), CidHash(2)(a));
+
+    // a connection table lookup by the DCID of an incoming packet
+    std::unordered_map<Cid, int, CidHash> table;
+    table[a] = 1;
+    table[d] = 2;
+    StringReader reader(initial_packet);
+    PacketHeader header = PacketHeader::from_reader(reader);
+    EXPECT_EQ(table.at(header.dcid), 1);
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-tls.html#name-client-initial
+// Rebuild the client Initial of the draft from its plaintext payload.
+TEST_F(PacketTest, BuildInitial) {
+    Cid dcid(String::from_hex("8394c8f03e515708"));
+    Cipher cipher = Cipher::from_initial_secret(dcid.as_string_ref(), false);
+
+    String received = initial_packet.clone();
+    StringReader reader(received);
+    PacketHeader header = PacketHeader::from_reader(reader);
+    StringRef payload = open_packet(cipher, received, header);
+    EXPECT_EQ(payload.size(), 1162);
+
+    String buffer(kMaxDatagramSize);
+    PacketBuilder builder(buffer);
+    StringWriter &writer = builder.begin_long_packet(
+        PacketType::Initial, 0xff00001b, dcid, Cid(),
+        StringRef::empty_string(), 2, 4);
+    // the CRYPTO frame; the PADDING frames are added by the builder
+    writer.write(payload.sub_string(0, 245));
+    builder.finish_packet(cipher, kMinInitialDatagramSize);
+
+    EXPECT_EQ(builder.datagram(), initial_packet);
+}
+
+TEST_F(PacketTest, BuildCoalescedPackets) {
+    Cid dcid(String::from_hex("8394c8f03e515708"));
+    Cid scid(String::from_hex("f067a5502a4262b5"));
+    Cipher initial = Cipher::from_initial_secret(dcid.as_string_ref(), false);
+    Cipher handshake = Cipher::from_initial_secret(scid.as_string_ref(), false);
+    String data = String::from_hex("0801020304");
+
+    String buffer(kMaxDatagramSize);
+    PacketBuilder builder(buffer);
+    size_t pn_length = PacketNumber::encoded_length(7, 0);
+    builder.begin_long_packet(PacketType::Initial, 0xff00001b, dcid, scid,
+                              StringRef::empty_string(), 7, pn_length)
+        .write(data);
+    builder.finish_packet(initial);
+    builder.begin_long_packet(PacketType::Handshake, 0xff00001b, dcid, scid,
+                              StringRef::empty_string(), 300, 2)
+        .write(data);
+    builder.finish_packet(handshake);
+    // a packet with a single byte of payload is padded for the sample
+    builder.begin_short_packet(dcid, 1000, 1, true, false).write_u8(0x01);
+    size_t short_size = builder.finish_packet(handshake,
+                                              kMinInitialDatagramSize);
+
+    StringRef datagram = builder.datagram();
+    EXPECT_EQ(datagram.size(), kMinInitialDatagramSize);
+
+    DatagramIterator iter(datagram);
+    StringRef packet;
+    std::vector<PacketType> types;
+    while (iter.next(packet)) {
+        StringReader packet_reader(packet.data(), packet.size());
+        PacketHeader header = PacketHeader::from_reader(packet_reader);
+        types.push_back(header.type);
+        const Cipher &cipher =
+            header.type == PacketType::Initial ? initial : handshake;
+        // the receiver has seen the packets up to 999 in 1-RTT
+        PacketNumber::dtype expected_pn =
+            header.type == PacketType::OneRTT ? 1000 : 0;
+        StringRef payload = open_packet(cipher, packet, header, expected_pn);
+        if (header.type == PacketType::OneRTT) {
+            EXPECT_EQ(packet.size(), short_size);
+            EXPECT_TRUE(header.spin_bit);
+            EXPECT_EQ(header.pkt_number.value, 1000);
+            EXPECT_EQ(payload[0], 0x01);
+        } else {
+            EXPECT_EQ(payload, data);
+        }
+    }
+    EXPECT_EQ(types, (std::vector<PacketType>{
+        PacketType::Initial, PacketType::Handshake, PacketType::OneRTT}));
+}
@@ -0,0 +1,238 @@
+//
+// Created by Chengke Wong on 2020/5/16.
+//
+
+#include "transport/received_packet_tracker.h"
+
+#include <algorithm>
+
+#include "common/frame.h"
+
+ReceivedPacketTracker::ReceivedPacketTracker(PNSpace space,
+                                             AlarmManager &alarms,
+                                             Duration max_ack_delay,
+                                             Alarm::Delegte on_ack_required)
+    : space_(space),
+      max_ack_delay_(max_ack_delay),
+      on_ack_required_(std::move(on_ack_required)),
+      ack_alarm_(alarms.new_alarm([this](Instant now) {
+          on_ack_alarm(now);
+      }))
+{}
+
+bool ReceivedPacketTracker::is_duplicate(PacketNumber pn) const {
+    if (pn.value < forgotten_below_) {
+        return true;
+    }
+    auto iter = std::upper_bound(
+        ranges_.begin(), ranges_.end(), pn.value,
+        [](PacketNumber::dtype value, const PacketRange &range) {
+            return value < range.first;
+        });
+    if (iter == ranges_.begin()) {
+        return false;
+    }
+    iter--;
+    return pn.value <= iter->last;
+}
+
+void ReceivedPacketTracker::forget_oldest_range() {
+    forgotten_below_ = ranges_.front().last + 1;
+    ranges_.pop_front();
+}
+
+bool ReceivedPacketTracker::insert(PacketNumber::dtype pn) {
+    if (pn < forgotten_below_) {
+        return false;
+    }
+
+    // fast path: packets mostly arrive in order
+    if (ranges_.empty() || pn > ranges_.back().last + 1) {
+        ranges_.push_back(PacketRange{pn, pn});
+        if (ranges_.size() > kMaxTrackedRanges) {
+            forget_oldest_range();
+        }
+        return true;
+    }
+    if (pn == ranges_.back().last + 1) {
+        ranges_.back().last = pn;
+        return true;
+    }
+
+    if (is_duplicate(pn)) {
+        return false;
+    }
+
+    // |iter| is the first range starting after |pn|
+    auto iter = std::upper_bound(
+        ranges_.begin(), ranges_.end(), pn,
+        [](PacketNumber::dtype value, const PacketRange &range) {
+            return value < range.first;
+        });
+
+    bool joins_prev = iter != ranges_.begin() && (iter - 1)->last + 1 == pn;
+    bool joins_next = iter != ranges_.end() && iter->first == pn + 1;
+
+    if (joins_prev && joins_next) {
+        (iter - 1)->last = iter->last;
+        ranges_.erase(iter);
+    } else if (joins_prev) {
+        (iter - 1)->last = pn;
+    } else if (joins_next) {
+        iter->first = pn;
+    } else {
+        ranges_.insert(iter, PacketRange{pn, pn});
+        if (ranges_.size() > kMaxTrackedRanges) {
+            forget_oldest_range();
+        }
+    }
+    return true;
+}
+
+bool ReceivedPacketTracker::on_packet_received(PacketNumber pn,
+                                               bool ack_eliciting,
+                                               Instant now) {
+    optional<PacketNumber> largest = largest_received();
+
+    if (!insert(pn.value)) {
+        return false;
+    }
+
+    if (!largest.has_value() || pn > largest.value()) {
+        largest_received_ = pn.value;
+        largest_received_time_ = now;
+    }
+
+    ack_pending_ = true;
+
+    if (!ack_eliciting) {
+        // Non-ack-eliciting packets are only acknowledged along with
+        // ack-eliciting ones.
+        return true;
+    }
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-sending-ack-frames
+    // In order to assist loss detection at the sender, an endpoint SHOULD
+    // generate and send an ACK frame without delay when it receives an
+    // ack-eliciting packet either:
+    //   - when the received packet has a packet number less than another
+    //     ack-eliciting packet that has been received, or
+    //   - when the packet has a packet number larger than the
+    //     highest-numbered ack-eliciting packet that has been received and
+    //     there are missing packets between that packet and this packet.
+    bool reordered = largest_ack_eliciting_.has_value() &&
+        (pn.value < largest_ack_eliciting_.value() ||
+         (largest.has_value() && pn.value > largest.value().value + 1));
+
+    if (!largest_ack_eliciting_.has_value() ||
+        pn.value > largest_ack_eliciting_.value()) {
+        largest_ack_eliciting_ = pn.value;
+    }
+
+    ack_eliciting_since_last_ack_ += 1;
+
+    if (space_ != PNSpace::Application || reordered ||
+        ack_eliciting_since_last_ack_ >= kAckElicitingThreshold) {
+        ack_alarm_->cancel();
+        ack_required_ = true;
+    } else if (!ack_alarm_->is_set()) {
+        ack_alarm_->set(now + max_ack_delay_);
+    }
+
+    return true;
+}
+
+void ReceivedPacketTracker::on_ack_alarm(Instant now) {
+    ack_required_ = true;
+    if (on_ack_required_) {
+        on_ack_required_(now);
+    }
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-ack-frames
+//
+//   ACK Frame {
+//     Type (i) = 0x02..0x03,
+//     Largest Acknowledged (i),
+//     ACK Delay (i),
+//     ACK Range Count (i),
+//     First ACK Range (i),
+//     ACK Range (..) ...,
+//   }
+//
+//   ACK Range {
+//     Gap (i),
+//     ACK Range Length (i),
+//   }
+size_t ReceivedPacketTracker::write_ack_frame(StringWriter &writer,
+                                              Instant now) {
+    if (ranges_.empty()) {
+        return 0;
+    }
+
+    PacketRange newest = ranges_.back();
+
+    // The ACK delay is not meaningful for Initial and Handshake packets
+    // and the receiver ignores it there.
+    uint64_t ack_delay = 0;
+    if (space_ == PNSpace::Application && now > largest_received_time_) {
+        ack_delay = (now - largest_received_time_).to_microseconds()
+            >> kDefaultAckDelayExponent;
+    }
+
+    size_t length = 1 + StringWriter::variant_length_size(newest.last)
+        + StringWriter::variant_length_size(ack_delay)
+        + 1 /* ACK Range Count */
+        + StringWriter::variant_length_size(newest.last - newest.first);
+
+    if (length > writer.remaining()) {
+        return 0;
+    }
+
+    // Figure out how many of the older ranges fit before writing anything.
+    size_t range_count = 0;
+    auto iter = ranges_.rbegin();
+    for (auto next = iter + 1;
+         next != ranges_.rend() && range_count < kMaxAckRanges;
+         iter++, next++) {
+        uint64_t gap = iter->first - next->last - 2;
+        uint64_t range = next->last - next->first;
+        size_t range_length = StringWriter::variant_length_size(gap)
+            + StringWriter::variant_length_size(range);
+        if (length + range_length > writer.remaining()) {
+            break;
+        }
+        length += range_length;
+        range_count += 1;
+    }
+
+    writer.write_u8(FRAME_TYPE_ACK);
+    writer.write_with_variant_length(newest.last);
+    writer.write_with_variant_length(ack_delay);
+    writer.write_with_variant_length(range_count);
+    writer.write_with_variant_length(newest.last - newest.first);
+
+    iter = ranges_.rbegin();
+    for (size_t i = 0; i < range_count; i++, iter++) {
+        auto next = iter + 1;
+        writer.write_with_variant_length(iter->first - next->last - 2);
+        writer.write_with_variant_length(next->last - next->first);
+    }
+
+    ack_pending_ = false;
+    ack_required_ = false;
+    ack_eliciting_since_last_ack_ = 0;
+    ack_alarm_->cancel();
+
+    return length;
+}
+
+void ReceivedPacketTracker::drop_below(PacketNumber pn) {
+    forgotten_below_ = std::max(forgotten_below_, pn.value);
+    while (!ranges_.empty() && ranges_.front().last < pn.value) {
+        ranges_.pop_front();
+    }
+    if (!ranges_.empty() && ranges_.front().first < pn.value) {
+        ranges_.front().first = pn.value;
+    }
+}
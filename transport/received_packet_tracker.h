@@ -0,0 +1,176 @@
+//
+// Created by Chengke Wong on 2020/5/16.
+//
+
+#ifndef RECEIVED_PACKET_TRACKER_H
+#define RECEIVED_PACKET_TRACKER_H
+
+#include <deque>
+
+#include "common/config.h"
+#include "common/quic_types.h"
+#include "util/alarm.h"
+#include "util/optional.h"
+#include "util/string_writer.h"
+
+using std::experimental::optional;
+
+// Records the packet numbers received in one packet number space and
+// decides when they should be acknowledged.
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-generating-acknowledgements
+//
+// An ACK is "pending" as soon as a new packet arrives: it is cheap to
+// piggyback one on any packet we are about to send in this space. It
+// becomes "required" when we must not wait for outgoing data any longer:
+//   1. every kAckElicitingThreshold ack-eliciting packets,
+//   2. when an ack-eliciting packet arrives out of order,
+//   3. when max_ack_delay has passed since the first unacknowledged
+//      ack-eliciting packet, and
+//   4. immediately for ack-eliciting Initial and Handshake packets.
+class ReceivedPacketTracker {
+
+public:
+
+    // An ACK frame should be sent after receiving at least two
+    // ack-eliciting packets.
+    static constexpr size_t kAckElicitingThreshold = 2;
+
+    // The maximum number of ranges kept in memory. When exceeded, the
+    // oldest range is forgotten; the peer has most likely received an
+    // ACK for it long ago. Late packets below a forgotten range are
+    // treated as duplicates.
+    static constexpr size_t kMaxTrackedRanges = 64;
+
+    // The maximum number of ranges in a single ACK frame. It is below
+    // 64, so the ACK Range Count always takes one byte.
+    static constexpr size_t kMaxAckRanges = 32;
+
+    ReceivedPacketTracker(PNSpace space, AlarmManager &alarms,
+                          Duration max_ack_delay,
+                          Alarm::Delegte on_ack_required = nullptr);
+
+    // return false if |pn| has been received before, in which case the
+    // packet must be discarded without being processed.
+    bool on_packet_received(PacketNumber pn, bool ack_eliciting, Instant now);
+
+    bool is_duplicate(PacketNumber pn) const;
+
+    // An ACK frame can be piggybacked on the next packet in this space.
+    inline bool ack_pending() const {
+        return ack_pending_;
+    }
+
+    // An ACK frame should be sent right now, in a packet of its own if
+    // there is nothing else to send.
+    inline bool ack_required() const {
+        return ack_required_;
+    }
+
+    // Write an ACK frame describing the most recent ranges into |writer|.
+    // At most kMaxAckRanges ranges are written, and the older ranges
+    // are left out if the frame does not fit into |writer|.
+    //
+    // return the number of bytes written, or 0 if there is nothing to
+    // acknowledge or not even the first range fits.
+    size_t write_ack_frame(StringWriter &writer, Instant now);
+
+    // Stop acknowledging packets below |pn|, e.g. after the peer has
+    // acknowledged a packet carrying an ACK frame up to |pn|.
+    void drop_below(PacketNumber pn);
+
+    // still known after drop_below() has dropped every range
+    inline optional<PacketNumber> largest_received() const {
+        if (!largest_received_.has_value()) {
+            return {};
+        }
+        return PacketNumber(largest_received_.value());
+    }
+
+    // the packet number the peer will most likely send next, used to
+    // decode truncated packet numbers
+    inline PacketNumber::dtype expected_packet_number() const {
+        return largest_received_.has_value()
+            ? largest_received_.value() + 1 : 0;
+    }
+
+    // disallow copy and assignment; the alarm refers to |this|
+    ReceivedPacketTracker (const ReceivedPacketTracker&) = delete;
+    ReceivedPacketTracker& operator=(const ReceivedPacketTracker&) = delete;
+
+    ReceivedPacketTracker (ReceivedPacketTracker&&) = delete;
+    ReceivedPacketTracker& operator=(ReceivedPacketTracker&&) = delete;
+
+private:
+
+    // closed interval [first, last]
+    struct PacketRange {
+        PacketNumber::dtype first;
+        PacketNumber::dtype last;
+    };
+
+    // return whether |pn| was inserted, i.e. it is not a duplicate
+    bool insert(PacketNumber::dtype pn);
+
+    void forget_oldest_range();
+
+    void on_ack_alarm(Instant now);
+
+    PNSpace space_;
+
+    Duration max_ack_delay_;
+
+    // sorted by packet number, non-overlapping and non-adjacent
+    std::deque<PacketRange> ranges_;
+
+    // Packet numbers below this value are no longer tracked and are
+    // considered duplicates.
+    PacketNumber::dtype forgotten_below_ = 0;
+
+    // the largest packet number ever received; kept apart from
+    // |ranges_|, which drop_below() may empty
+    optional<PacketNumber::dtype> largest_received_;
+
+    Instant largest_received_time_ = Instant::zero();
+
+    // the largest ack-eliciting packet number ever received
+    optional<PacketNumber::dtype> largest_ack_eliciting_;
+
+    size_t ack_eliciting_since_last_ack_ = 0;
+
+    bool ack_pending_ = false;
+
+    bool ack_required_ = false;
+
+    Alarm::Delegte on_ack_required_;
+
+    unique_ptr<Alarm> ack_alarm_;
+
+};
+
+class ReceivedPacketTrackers {
+
+public:
+
+    ReceivedPacketTrackers(AlarmManager &alarms, Duration max_ack_delay,
+                           Alarm::Delegte on_ack_required = nullptr)
+        : trackers_{
+            {PNSpace::Initial, alarms, max_ack_delay, on_ack_required},
+            {PNSpace::Handshake, alarms, max_ack_delay, on_ack_required},
+            {PNSpace::Application, alarms, max_ack_delay, on_ack_required}}
+        {}
+
+    inline ReceivedPacketTracker &operator [] (PNSpace space) {
+        return trackers_[static_cast<size_t>(space)];
+    }
+
+    inline ReceivedPacketTracker &operator [] (size_t space) {
+        return trackers_[space];
+    }
+
+private:
+
+    ReceivedPacketTracker trackers_[kNumOfPNSpaces];
+
+};
+
+#endif
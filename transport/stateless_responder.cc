@@ -0,0 +1,160 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#include "transport/stateless_responder.h"
+
+#include <algorithm>
+
+#include "crypto/hkdf.h"
+#include "util/string_reader.h"
+#include "util/string_writer.h"
+
+constexpr size_t StatelessResponder::kStatelessResetTokenLength;
+constexpr size_t StatelessResponder::kMinStatelessResetSize;
+constexpr size_t StatelessResponder::kMaxStatelessResetSize;
+
+StatelessResponder::StatelessResponder(std::vector<Version> supported_versions,
+                                       StringRef static_key,
+                                       size_t cid_length,
+                                       double responses_per_second,
+                                       double burst)
+    : supported_versions_(std::move(supported_versions)),
+      static_key_(static_key.clone()),
+      cid_length_(cid_length),
+      versions_template_(4 * (supported_versions_.size() + 1)),
+      version_negotiation_limit_(responses_per_second, burst),
+      stateless_reset_limit_(responses_per_second, burst),
+      random_(std::random_device()()) {
+    StringWriter writer(versions_template_);
+    for (Version version : supported_versions_) {
+        writer.write_u32(version);
+    }
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-versions
+    // Versions that follow the pattern 0x?a?a?a?a are reserved for use in
+    // forcing version negotiation to be exercised.
+    uint32_t reserved = static_cast<uint32_t>(random_()) & 0xf0f0f0f0;
+    writer.write_u32(reserved | 0x0a0a0a0a);
+}
+
+bool StatelessResponder::is_supported(Version version) const {
+    return std::find(supported_versions_.begin(), supported_versions_.end(),
+                     version) != supported_versions_.end();
+}
+
+//   Version Negotiation Packet {
+//     Header Form (1) = 1,
+//     Unused (7),
+//     Version (32) = 0,
+//     Destination Connection ID Length (8),
+//     Destination Connection ID (0..2040),
+//     Source Connection ID Length (8),
+//     Source Connection ID (0..2040),
+//     Supported Version (32) ...,
+//   }
+size_t StatelessResponder::write_version_negotiation(StringRef datagram,
+                                                     Instant now,
+                                                     StringRef out) {
+    // A server MUST discard an Initial packet that is carried in a UDP
+    // datagram with a payload that is smaller than the smallest allowed
+    // maximum datagram size of 1200 bytes. Answering smaller datagrams
+    // would make us an amplifier.
+    if (datagram.size() < kMinInitialDatagramSize) {
+        return 0;
+    }
+
+    StringReader reader(datagram.data(), datagram.size());
+    uint8_t first_byte = reader.read_u8();
+    if (!(first_byte & 0x80)) {
+        return 0;
+    }
+
+    // Only the version-independent fields are looked at; a Connection ID
+    // of an unknown version may be up to 255 bytes long.
+    Version version = reader.read_u32();
+    // An endpoint MUST NOT send a Version Negotiation packet in response
+    // to receiving a Version Negotiation packet.
+    if (version == 0 || is_supported(version)) {
+        return 0;
+    }
+
+    uint8_t dcid_length = reader.read_u8();
+    StringRef dcid(reader.peek_data(), dcid_length);
+    reader.skip(dcid_length);
+    uint8_t scid_length = reader.read_u8();
+    StringRef scid(reader.peek_data(), scid_length);
+    reader.skip(scid_length);
+
+    if (!version_negotiation_limit_.consume(now)) {
+        return 0;
+    }
+
+    // The server MUST include the value from the Source Connection ID
+    // field of the packet it receives in the Destination Connection ID
+    // field. The value for Source Connection ID MUST be copied from the
+    // Destination Connection ID of the received packet.
+    // The server SHOULD set the most significant bit of the Unused field
+    // (0x40) to 1 so that Version Negotiation packets appear to have the
+    // Fixed Bit field.
+    StringWriter writer(out);
+    writer.write_u8(0xc0 | (static_cast<uint8_t>(random_()) & 0x3f));
+    writer.write_u32(0);
+    writer.write_u8(scid_length);
+    writer.write(scid);
+    writer.write_u8(dcid_length);
+    writer.write(dcid);
+    writer.write(versions_template_);
+    return writer.position();
+}
+
+//   Stateless Reset {
+//     Fixed Bits (2) = 1,
+//     Unpredictable Bits (38..),
+//     Stateless Reset Token (128),
+//   }
+size_t StatelessResponder::write_stateless_reset(StringRef packet,
+                                                 Instant now,
+                                                 StringRef out) {
+    if (packet.size() < 1 + cid_length_ || (packet[0] & 0x80)) {
+        return 0;
+    }
+
+    // An endpoint MUST ensure that every Stateless Reset that it sends is
+    // smaller than the packet that triggered it, unless it maintains
+    // other means to prevent looping.
+    size_t size = std::min(packet.size() - 1, kMaxStatelessResetSize);
+    size = std::min(size, out.size());
+    if (size < kMinStatelessResetSize) {
+        return 0;
+    }
+
+    if (!stateless_reset_limit_.consume(now)) {
+        return 0;
+    }
+
+    // The unpredictable bits make the reset look like a short header
+    // packet.
+    size_t random_length = size - kStatelessResetTokenLength;
+    for (size_t i = 0; i < random_length; i += 8) {
+        uint64_t bits = random_();
+        memcpy(out.data() + i, &bits, std::min<size_t>(8, random_length - i));
+    }
+    out[0] = 0x40 | (out[0] & 0x3f);
+
+    Cid cid(packet.data() + 1, cid_length_);
+    stateless_reset_token(cid, out.data() + random_length);
+    return size;
+}
+
+// https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-calculating-a-stateless-res
+// A single static key can be used across all connections to the same
+// endpoint by generating the proof using a second iteration of a
+// preimage-resistant function that takes a static key and the connection
+// ID chosen by the endpoint as input. We use HMAC-SHA256 truncated to
+// 16 bytes.
+void StatelessResponder::stateless_reset_token(const Cid &cid,
+                                               uint8_t *token) const {
+    String hash = crypto::hkdf_extract(HkdfHash::SHA_256, static_key_,
+                                       cid.as_string_ref());
+    memcpy(token, hash.data(), kStatelessResetTokenLength);
+}
@@ -0,0 +1,109 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#ifndef TRANSPORT_STATELESS_RESPONDER_H
+#define TRANSPORT_STATELESS_RESPONDER_H
+
+#include <random>
+#include <vector>
+
+#include "common/config.h"
+#include "common/quic_types.h"
+#include "util/token_bucket.h"
+
+// Answers the datagrams a server cannot route to a connection, without
+// creating any per-connection state:
+//
+//   1. a long header packet of a version we do not support gets a Version
+//      Negotiation packet, and
+//   2. a short header packet whose Destination Connection ID is unknown
+//      gets a Stateless Reset.
+//
+// It runs before a connection is looked up or created, so that scanners
+// and clients with stale connections cost a few memcpy's. Each kind of
+// response is rate limited.
+//
+//     StatelessResponder responder(versions, static_key);
+//     size_t size = responder.write_version_negotiation(datagram, now, out);
+//     if (size > 0) {
+//         send(out.sub_string(0, size));
+//     }
+class StatelessResponder {
+
+public:
+
+    // the default rate limit of each kind of response
+    static constexpr double kDefaultResponsesPerSecond = 1000;
+    static constexpr double kDefaultResponseBurst = 100;
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-stateless-reset
+    // The Stateless Reset Token is 16 bytes. The smallest Stateless Reset
+    // is 5 bytes of unpredictable bits followed by the token, and it is
+    // never larger than kMaxStatelessResetSize.
+    static constexpr size_t kStatelessResetTokenLength = 16;
+    static constexpr size_t kMinStatelessResetSize = 21;
+    static constexpr size_t kMaxStatelessResetSize = 43;
+
+    // |static_key| keys the hash that derives Stateless Reset Tokens from
+    // CIDs. It must be the same on all the servers that share the CIDs
+    // and must be kept secret.
+    StatelessResponder(std::vector<Version> supported_versions,
+                       StringRef static_key,
+                       size_t cid_length = kDefaultCidLength,
+                       double responses_per_second = kDefaultResponsesPerSecond,
+                       double burst = kDefaultResponseBurst);
+
+    bool is_supported(Version version) const;
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-version-negotiation-packet
+    // If |datagram| starts with a long header packet of an unsupported
+    // version, write a Version Negotiation packet into |out| and return
+    // its size. Return 0 if no response should be sent: the version is
+    // supported, the datagram is too small to be a client Initial, it is
+    // a Version Negotiation packet itself, or the rate limit is hit.
+    //
+    // throw std::overflow_error if |out| is too small; kMaxDatagramSize
+    // bytes are always enough.
+    size_t write_version_negotiation(StringRef datagram, Instant now,
+                                     StringRef out);
+
+    // https://quicwg.org/base-drafts/draft-ietf-quic-transport.html#name-stateless-reset
+    // Write a Stateless Reset in response to the short header |packet|,
+    // whose Destination Connection ID matches no connection, into |out|
+    // and return its size. The reset is always smaller than |packet| so
+    // that two endpoints cannot keep resetting each other. Return 0 if
+    // |packet| is too small to be answered or the rate limit is hit.
+    size_t write_stateless_reset(StringRef packet, Instant now,
+                                 StringRef out);
+
+    // The token to announce along with |cid|, and the one a Stateless
+    // Reset triggered by a packet to |cid| carries.
+    void stateless_reset_token(const Cid &cid, uint8_t *token) const;
+
+    // disallow copy and assignment
+    StatelessResponder (const StatelessResponder&) = delete;
+    StatelessResponder& operator=(const StatelessResponder&) = delete;
+
+private:
+
+    std::vector<Version> supported_versions_;
+
+    String static_key_;
+
+    size_t cid_length_;
+
+    // The Supported Version fields of our Version Negotiation packets,
+    // including a reserved version to exercise version negotiation. Only
+    // the first byte and the CIDs are written per response.
+    String versions_template_;
+
+    TokenBucket version_negotiation_limit_;
+
+    TokenBucket stateless_reset_limit_;
+
+    std::mt19937_64 random_;
+
+};
+
+#endif //TRANSPORT_STATELESS_RESPONDER_H
@@ -0,0 +1,114 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#include "gtest/gtest.h"
+#include "transport/packet_header.h"
+#include "transport/stateless_responder.h"
+#include "util/string_writer.h"
+
+class StatelessTest : public ::testing::Test {
+protected:
+    StatelessTest() = default;
+
+    ~StatelessTest() override = default;
+
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+    }
+
+    // a client Initial of |version|, padded to |size| bytes
+    String make_initial(Version version, size_t size = 1200) {
+        String datagram(size);
+        memset(datagram.data(), 0, size);
+        StringWriter writer(datagram);
+        writer.write_u8(0xc0);
+        writer.write_u32(version);
+        writer.write_u8(8);
+        writer.write(String::from_hex("8394c8f03e515708"));
+        writer.write_u8(4);
+        writer.write(String::from_hex("f067a550"));
+        return datagram;
+    }
+
+    String make_short_packet(size_t size) {
+        String packet = String::random(size);
+        packet[0] = 0x41;
+        memcpy(packet.data() + 1, cid.data(), cid.size());
+        return packet;
+    }
+
+    Instant now = Instant(1000000);
+    Cid cid = Cid(String::from_hex("0102030405060708"));
+    StatelessResponder responder{{0xff00001b}, String::from_hex("aabbcc"),
+                                 8, 10, 2};
+};
+
+TEST_F(StatelessTest, VersionNegotiation) {
+    String out(kMaxDatagramSize);
+    String initial = make_initial(0x1a2a3a4a);
+
+    size_t size = responder.write_version_negotiation(initial, now, out);
+    ASSERT_GT(size, 0);
+
+    StringReader reader(out.data(), size);
+    PacketHeader header = PacketHeader::from_reader(reader);
+    EXPECT_EQ(header.type, PacketType::VersionNegotiation);
+    EXPECT_EQ(header.dcid.to_hex(), "f067a550");
+    EXPECT_EQ(header.scid.to_hex(), "8394c8f03e515708");
+    ASSERT_EQ(header.versions_.value().size(), 2);
+    EXPECT_EQ(header.versions_.value()[0], 0xff00001b);
+    EXPECT_EQ(header.versions_.value()[1] & 0x0f0f0f0f, 0x0a0a0a0a);
+
+    // supported versions, Version Negotiation packets and small datagrams
+    // are not answered
+    String supported = make_initial(0xff00001b);
+    EXPECT_EQ(responder.write_version_negotiation(supported, now, out), 0);
+    String negotiation = make_initial(0);
+    EXPECT_EQ(responder.write_version_negotiation(negotiation, now, out), 0);
+    String small = make_initial(0x1a2a3a4a, 1000);
+    EXPECT_EQ(responder.write_version_negotiation(small, now, out), 0);
+}
+
+TEST_F(StatelessTest, StatelessReset) {
+    String out(kMaxDatagramSize);
+
+    uint8_t token[16];
+    responder.stateless_reset_token(cid, token);
+
+    String packet = make_short_packet(100);
+    size_t size = responder.write_stateless_reset(packet, now, out);
+    EXPECT_EQ(size, StatelessResponder::kMaxStatelessResetSize);
+    EXPECT_EQ(out[0] & 0xc0, 0x40);
+    EXPECT_EQ(out.sub_string(size - 16, size), StringRef(token, 16));
+
+    // always smaller than the packet that triggered it
+    String small = make_short_packet(30);
+    EXPECT_EQ(responder.write_stateless_reset(small, now, out), 29);
+    String tiny = make_short_packet(21);
+    EXPECT_EQ(responder.write_stateless_reset(tiny, now, out), 0);
+
+    // the token depends on the CID
+    uint8_t other[16];
+    responder.stateless_reset_token(Cid(String::from_hex("0102")), other);
+    EXPECT_NE(memcmp(token, other, 16), 0);
+}
+
+TEST_F(StatelessTest, RateLimit) {
+    String out(kMaxDatagramSize);
+    String packet = make_short_packet(100);
+
+    // a burst of 2, then 10 per second
+    EXPECT_GT(responder.write_stateless_reset(packet, now, out), 0);
+    EXPECT_GT(responder.write_stateless_reset(packet, now, out), 0);
+    EXPECT_EQ(responder.write_stateless_reset(packet, now, out), 0);
+    Instant later = now + Duration::from_milliseconds(100);
+    EXPECT_GT(responder.write_stateless_reset(packet, later, out), 0);
+    EXPECT_EQ(responder.write_stateless_reset(packet, later, out), 0);
+
+    // the limits are separate
+    String initial = make_initial(0x1a2a3a4a);
+    EXPECT_GT(responder.write_version_negotiation(initial, later, out), 0);
+}
@@ -0,0 +1,87 @@
+//
+// Created by Chengke Wong on 2020/5/2.
+//
+
+#include "alarm.h"
+
+#include <algorithm>
+
+Alarm::Alarm(AlarmManager &manager, Delegte delegate)
+    : manager_(manager),
+      delegate_(std::move(delegate)),
+      deadline_(Instant::infinite())
+{}
+
+Alarm::~Alarm() {
+    cancel();
+}
+
+void Alarm::set(Instant new_deadline) {
+    cancel();
+    deadline_ = new_deadline;
+    if (!deadline_.is_infinite()) {
+        manager_.register_alarm(this);
+    }
+}
+
+void Alarm::update(Instant new_deadline, Duration granularity) {
+    if (is_set() && !new_deadline.is_infinite() &&
+        (new_deadline - deadline_).abs() < granularity) {
+        return;
+    }
+    set(new_deadline);
+}
+
+void Alarm::cancel() {
+    if (is_set()) {
+        manager_.unregister_alarm(this);
+        deadline_ = Instant::infinite();
+    }
+}
+
+bool Alarm::is_set() {
+    return !deadline_.is_infinite();
+}
+
+void Alarm::fire(Instant now) {
+    deadline_ = Instant::infinite();
+    delegate_(now);
+}
+
+AlarmManager::AlarmToken AlarmManager::register_alarm(Alarm *alarm) {
+    return alarms_.insert(std::make_pair(alarm->deadline(), alarm));
+}
+
+void AlarmManager::unregister_alarm(Alarm *alarm) {
+    auto range = alarms_.equal_range(alarm->deadline());
+    for (auto iter = range.first; iter != range.second; iter++) {
+        if (iter->second == alarm) {
+            alarms_.erase(iter);
+            return;
+        }
+    }
+}
+
+void AlarmManager::fire(Instant now) {
+    while (!alarms_.empty() && alarms_.begin()->first <= now) {
+        Alarm *alarm = alarms_.begin()->second;
+        alarms_.erase(alarms_.begin());
+        // The delegate may set or cancel any alarm, including this one.
+        alarm->fire(now);
+    }
+}
+
+Instant AlarmManager::next_deadline() const {
+    if (alarms_.empty()) {
+        return Instant::infinite();
+    }
+    return alarms_.begin()->first;
+}
+
+Duration AlarmManager::time_to_next_fire(Instant now) const {
+    Instant deadline = next_deadline();
+    if (deadline.is_infinite()) {
+        return Duration::infinite();
+    }
+    return std::max(deadline - now, Duration::zero());
+}
@@ -6,22 +6,28 @@
 #define ALARM_H
 
 #include <functional>
+#include <map>
 
 #include "instant.h"
+#include "utility.h"
 
 class AlarmManager;
 
 class Alarm {
 
-public: 
+public:
 
     // |now| is the time when the alarm was fired.
     using Delegte = std::function<void(Instant now)>;
 
-    Alarm(Delegte delegate);
+    Alarm(AlarmManager &manager, Delegte delegate);
+
+    ~Alarm();
 
     void set(Instant new_deadline);
 
+    // Only reschedule the alarm if the new deadline differs from the
+    // current one by at least |granularity|.
     void update(Instant new_deadline,
         Duration granularity = Duration::from_milliseconds(1));
 
@@ -29,10 +35,15 @@ public:
 
     bool is_set();
 
-    void fire();
+    inline Instant deadline() const {
+        return deadline_;
+    }
+
+    void fire(Instant now);
 
-    Alarm (Alarm&&) = default;
-    Alarm& operator= (Alarm&&) = default;
+    // The manager keeps a pointer to the alarm, so it cannot be moved.
+    Alarm (Alarm&&) = delete;
+    Alarm& operator= (Alarm&&) = delete;
 
     // disallow copy and assignment
     Alarm (const Alarm&) = delete;
@@ -40,28 +51,39 @@ public:
 
 private:
 
+    AlarmManager &manager_;
+
     Delegte delegate_;
 
+    Instant deadline_;
+
 };
 
 class AlarmManager {
 
-public: 
+public:
 
     using AlarmMap = std::multimap<Instant, Alarm*>;
     using AlarmToken = AlarmMap::const_iterator;
 
+    AlarmManager() = default;
+
     AlarmToken register_alarm(Alarm *alarm);
 
-    void unregister_alarm(AlarmToken token);
+    void unregister_alarm(Alarm *alarm);
 
     template<typename... Args>
-    unique_ptr<Alarm> new_alarm(Args&&... args);
-        // : std::runtime_error(std::forward<Args>(args)...)
+    unique_ptr<Alarm> new_alarm(Args&&... args) {
+        return std::make_unique<Alarm>(*this, std::forward<Args>(args)...);
+    }
 
+    // fire all the alarms whose deadlines are not later than |now|
     void fire(Instant now);
 
-    Duration time_to_next_fire();
+    // return Instant::infinite() if no alarm is set
+    Instant next_deadline() const;
+
+    Duration time_to_next_fire(Instant now) const;
 
     AlarmManager (AlarmManager&&) = default;
     AlarmManager& operator= (AlarmManager&&) = default;
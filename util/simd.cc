@@ -0,0 +1,95 @@
+//
+// Created by Chengke Wong on 2020/5/17.
+//
+
+#include "simd.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+static size_t find_first_nonzero_scalar(const uint8_t *data, size_t size) {
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof word);
+        if (word != 0) {
+            break;
+        }
+    }
+
+    while (i < size && data[i] == 0) {
+        i++;
+    }
+    return i;
+}
+
+#ifdef SIMD_X86
+
+static size_t find_first_nonzero_sse2(const uint8_t *data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (data + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+        if (mask != 0xffff) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+
+    return i + find_first_nonzero_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_first_nonzero_avx2(const uint8_t *data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (data + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero));
+        if (mask != 0xffffffff) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+
+    return i + find_first_nonzero_sse2(data + i, size - i);
+}
+
+using ScanFunction = size_t (*)(const uint8_t *, size_t);
+
+static ScanFunction select_find_first_nonzero() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return find_first_nonzero_avx2;
+    }
+    return find_first_nonzero_sse2;
+}
+
+size_t find_first_nonzero(const uint8_t *data, size_t size) {
+    // The vector loop does not pay off for the common case of a
+    // handful of bytes.
+    if (size < 16) {
+        return find_first_nonzero_scalar(data, size);
+    }
+    static const ScanFunction impl = select_find_first_nonzero();
+    return impl(data, size);
+}
+
+#else
+
+size_t find_first_nonzero(const uint8_t *data, size_t size) {
+    return find_first_nonzero_scalar(data, size);
+}
+
+#endif
+
+} // namespace simd
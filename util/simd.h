@@ -0,0 +1,22 @@
+//
+// Created by Chengke Wong on 2020/5/17.
+//
+
+#ifndef UTIL_SIMD_H
+#define UTIL_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simd {
+
+// return the index of the first non-zero byte in |data|, or |size| if
+// all the bytes are zero.
+//
+// On x86 this scans 32 bytes (AVX2, picked at runtime) or 16 bytes (SSE2)
+// at a time; other platforms fall back to a word-at-a-time loop.
+size_t find_first_nonzero(const uint8_t *data, size_t size);
+
+} // namespace simd
+
+#endif //UTIL_SIMD_H
@@ -0,0 +1,92 @@
+//
+// Created by Chengke Wong on 2020/5/23.
+//
+
+#ifndef UTIL_SLAB_H
+#define UTIL_SLAB_H
+
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "util/utility.h"
+
+// A pool of fixed-size objects of type T. Memory is taken from the heap
+// kObjectsPerChunk objects at a time and is never given back until the
+// slab is destroyed; freed objects go to a free list and are reused
+// first. Once the slab has grown to the working set, allocating and
+// freeing are a few pointer moves and never call into the allocator.
+//
+// All the objects must be freed before the slab is destroyed.
+template<typename T, size_t kObjectsPerChunk = 256>
+class Slab {
+
+public:
+
+    Slab() = default;
+
+    ~Slab() {
+        DCHECK(in_use_ == 0);
+    }
+
+    template<typename... Args>
+    T *allocate(Args &&... args) {
+        if (free_list_ == nullptr) {
+            add_chunk();
+        }
+        Node *node = free_list_;
+        free_list_ = node->next;
+        in_use_ += 1;
+        return new (&node->storage) T(std::forward<Args>(args)...);
+    }
+
+    void deallocate(T *object) {
+        object->~T();
+        Node *node = reinterpret_cast<Node *>(object);
+        node->next = free_list_;
+        free_list_ = node;
+        in_use_ -= 1;
+    }
+
+    // the number of objects allocated and not freed yet
+    inline size_t in_use() const {
+        return in_use_;
+    }
+
+    // the number of objects the slab can hold without growing
+    inline size_t capacity() const {
+        return chunks_.size() * kObjectsPerChunk;
+    }
+
+    // disallow copy and assignment; the objects point into the slab
+    Slab (const Slab&) = delete;
+    Slab& operator=(const Slab&) = delete;
+
+    Slab (Slab&&) = delete;
+    Slab& operator=(Slab&&) = delete;
+
+private:
+
+    union Node {
+        Node *next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    void add_chunk() {
+        chunks_.emplace_back(new Node[kObjectsPerChunk]);
+        Node *chunk = chunks_.back().get();
+        for (size_t i = 0; i < kObjectsPerChunk; i++) {
+            chunk[i].next = free_list_;
+            free_list_ = &chunk[i];
+        }
+    }
+
+    std::vector<unique_ptr<Node[]>> chunks_;
+
+    Node *free_list_ = nullptr;
+
+    size_t in_use_ = 0;
+
+};
+
+#endif //UTIL_SLAB_H
@@ -2,6 +2,7 @@
 
 #include "string_raw.h"
 #include "string_reader.h"
+#include "simd.h"
 
 class StringTest : public ::testing::Test {
 protected:
@@ -95,3 +96,35 @@ TEST_F(StringReaderTest, Test04) {
     );
 }
 
+class SimdTest : public ::testing::Test {
+protected:
+    SimdTest() = default;
+    ~SimdTest() override = default;
+
+    void SetUp() override {
+    }
+
+    void TearDown() override {
+    };
+};
+
+TEST_F(SimdTest, FindFirstNonzero) {
+    String zeros(300);
+    memset(zeros.data(), 0, zeros.size());
+
+    for (size_t size : {0, 1, 15, 16, 17, 31, 32, 33, 64, 299}) {
+        EXPECT_EQ(simd::find_first_nonzero(zeros.data(), size), size);
+    }
+
+    // every position, starting from both aligned and unaligned addresses
+    for (size_t offset = 0; offset < 4; offset++) {
+        for (size_t i = offset; i < zeros.size(); i++) {
+            zeros[i] = 0x01;
+            EXPECT_EQ(simd::find_first_nonzero(zeros.data() + offset,
+                                               zeros.size() - offset),
+                      i - offset);
+            zeros[i] = 0x00;
+        }
+    }
+}
+
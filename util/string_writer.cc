@@ -10,6 +10,11 @@ void StringWriter::write(const String::dtype *data, size_t length) {
     if (position_ + length > size()) {
         throw std::overflow_error("StringWriter::write");
     }
+    // an empty token or CID may have no buffer at all, and memcpy()
+    // takes no null pointer even for zero bytes
+    if (length == 0) {
+        return;
+    }
 
     dtype* p = this->data() + position_;
 
@@ -35,3 +40,43 @@ void StringWriter::write_u16(uint16_t value) {
     return write((dtype*) &value, sizeof(value));
 }
 
+void StringWriter::write_u32(uint32_t value) {
+    value = htonl(value);
+    return write((dtype*) &value, sizeof(value));
+}
+
+void StringWriter::write_u64(uint64_t value) {
+    value = htonll(value);
+    return write((dtype*) &value, sizeof(value));
+}
+
+void StringWriter::write_with_variant_length(uint64_t value) {
+/*
+ * 2Bit	Length	Usable Bits	Range
+ * 00	1	6	0-63
+ * 01	2	14	0-16383
+ * 10	4	30	0-1073741823
+ * 11	8	62	0-4611686018427387903
+ */
+
+    switch (variant_length_size(value)) {
+        case 1:
+            return write_u8(value);
+        case 2:
+            return write_u16(value | 0x4000);
+        case 4:
+            return write_u32(value | 0x80000000);
+        default:
+            if (value >= (1ull << 62)) {
+                throw std::overflow_error("write_with_variant_length");
+            }
+            return write_u64(value | 0xc000000000000000);
+    }
+}
+
+void StringWriter::skip(size_t length) {
+    if (position_ + length > size()) {
+        throw std::overflow_error("StringWriter::skip");
+    }
+    position_ += length;
+}
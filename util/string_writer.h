@@ -33,6 +33,25 @@ public:
 
     void write_u8(uint8_t value);
     void write_u16(uint16_t value);
+    void write_u32(uint32_t value);
+    void write_u64(uint64_t value);
+
+    // the inverse of StringReader::read_with_variant_length(), using
+    // the shortest encoding that can hold |value|
+    void write_with_variant_length(uint64_t value);
+
+    // number of bytes taken by write_with_variant_length(|value|)
+    static inline size_t variant_length_size(uint64_t value) {
+        return value < (1ull << 6) ? 1 :
+               value < (1ull << 14) ? 2 :
+               value < (1ull << 30) ? 4 : 8;
+    }
+
+    inline dtype* peek_data() const {
+        return this->data() + position_;
+    }
+
+    void skip(size_t length);
 
     inline size_t remaining() const {
         return size() - position_;
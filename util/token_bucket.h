@@ -0,0 +1,51 @@
+//
+// Created by Chengke Wong on 2020/5/22.
+//
+
+#ifndef UTIL_TOKEN_BUCKET_H
+#define UTIL_TOKEN_BUCKET_H
+
+#include <algorithm>
+
+#include "util/instant.h"
+
+// A token bucket rate limiter: tokens accumulate at |rate| per second up
+// to |burst|, and each permitted event takes one.
+class TokenBucket {
+
+public:
+
+    TokenBucket(double rate, double burst)
+        : rate_(rate),
+          burst_(burst),
+          tokens_(burst),
+          last_update_(Instant::zero())
+        {}
+
+    // return whether the event at |now| is permitted
+    inline bool consume(Instant now) {
+        if (now > last_update_) {
+            double elapsed_us = (now - last_update_).to_microseconds();
+            tokens_ = std::min(burst_, tokens_ + elapsed_us * rate_ / 1e6);
+            last_update_ = now;
+        }
+        if (tokens_ < 1) {
+            return false;
+        }
+        tokens_ -= 1;
+        return true;
+    }
+
+private:
+
+    double rate_;
+
+    double burst_;
+
+    double tokens_;
+
+    Instant last_update_;
+
+};
+
+#endif //UTIL_TOKEN_BUCKET_H